@@ -0,0 +1,1528 @@
+// ITM benchmark and accuracy regression suite.
+//
+// Replays the reference vectors shipped with ITM (p2p.csv + pfls.csv and
+// area.csv) and a fixed set of synthetic profiles of 100 to 10,000 points,
+// checks every loss against its reference value, and reports throughput of
+// the single-link, batched and area paths. The area.csv parameter sets are
+// also run over distances in every propagation mode, directly and through a
+// loss table, against ITM_AREA_TLS_Ex. Every cell of a frequency and
+// quantile sweep must match ITM_P2P_TLS_Ex or ITM_P2P_CR_Ex exactly, also
+// where its inputs are rejected. LongleyRiceBatch must match the scalar
+// functions on every SIMD level the CPU supports. A synthetic DEM is also
+// converted to a tile store, whose profiles must match sampling the
+// raster in memory, and a link cache must hand back exactly the rows it was
+// filled with. Every receiver of a radial sweep over that DEM must match
+// ITM_P2P_TLS_Ex on its truncated profile. Exits non-zero on any drift.
+//
+//   itm_bench --data-dir third_party/itm --reference bench/synthetic_reference.csv
+//             [--check-only] [--profile] [--simd scalar|avx2|avx512]
+//             [--threads N] [--seconds S] [--write-reference]
+
+#include "Enums.h"
+#include "Errors.h"
+#include "dem_store.h"
+#include "itm.h"
+#include "itm_area.h"
+#include "itm_batch.h"
+#include "itm_best_server.h"
+#include "itm_radial.h"
+#include "itm_sweep.h"
+#include "link_cache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Reference values are stored to a fixed number of decimals; a result drifts
+// when it no longer rounds to the stored value
+const double kRoundingSlack__db = 1e-9;
+
+// Synthetic reference losses are written with this many decimals
+const int kSyntheticDecimals = 6;
+
+// Largest difference allowed between LongleyRiceBatch on SIMD lanes and the
+// scalar functions, which use different exp, log and pow approximations
+const double kLaneTolerance__db = 1e-9;
+
+// Path distances of the LongleyRiceBatch cases relative to the terrain's,
+// which move the links between the three propagation modes
+const double kLaneDistanceScales[] = {0.2, 0.5, 1, 2, 5};
+
+// Distances of the area checks, spanning the line-of-sight, diffraction and
+// troposcatter ranges of every area.csv parameter set
+const double kAreaDistances__km[] = {1,   2,   5,   10,  20,  40,  70,
+                                     100, 150, 250, 400, 700, 1000, 2000};
+
+// AreaLossTable range and sampling, and the largest difference allowed
+// between it and ITM halfway between two samples
+const double kAreaTable__km[] = {1, 2000};
+const std::size_t kAreaTableSamples = 512;
+const double kAreaTableTolerance__db = 0.25;
+
+// Frequency and quantile axes of the sweep checks. Each has invalid entries,
+// placed first so the sweep's LongleyRice runs on a later cell.
+const double kSweepFrequencies__mhz[] = {10, 30, 100, 915, 5800, 25000};
+const double kSweepTLS[][3] = {
+    {120, 50, 50}, {50, 50, 50}, {1, 99, 10}, {50, 0, 50}, {99.9, 50, 0.1}};
+const double kSweepCR[][2] = {{150, 50}, {50, 50}, {90, 10}, {50, -5},
+                              {10, 99.9}};
+
+const int kSyntheticSizes[] = {100, 300, 1000, 3000, 10000};
+const int kSyntheticLinksPerSize = 12;
+
+// Synthetic DEM: one degree square at 3 arc-second posting, written to the
+// working directory while the suite runs
+const int kDemPosts = 1201;
+const double kDemLat = 40.0;
+const double kDemLon = -111.0;
+const char kDemPath[] = "itm_bench_dem.rkdem";
+const int kDemLinks = 256;
+const double kDemSpacing__meter = 90;
+
+// Link cache, written to the working directory while the suite runs
+const char kCachePath[] = "itm_bench_links.rklink";
+
+// Radial sweep on the synthetic DEM. The transmitter sits south of the
+// nodata hole, so the north radial runs into it; the south, east and west
+// radials run off the raster before their last receiver.
+const double kRadialLat = 40.2;
+const double kRadialLon = -110.49;
+const int kRadials = 8;
+const int kRadialSteps = 500;
+
+// Largest difference allowed between the radial sweep, which serves its
+// least-squares fits from running sums, and ITM_P2P_TLS_Ex
+const double kRadialTolerance__db = 1e-6;
+
+// Best-server scenario on the synthetic DEM: a 4 x 4 grid of sites serving a
+// 24 x 24 grid of receivers
+const int kServerGrid = 4;
+const int kReceiverGrid = 24;
+const double kSensitivity__dbm = -95;
+
+struct Options {
+  std::string data_dir = ".";
+  std::string reference = "synthetic_reference.csv";
+  bool check_only = false;
+  bool profile = false;
+  bool write_reference = false;
+  int simd = -1;
+  int n_threads = 0;
+  double seconds = 0.5;
+};
+
+struct CsvRow {
+  std::vector<std::string> fields;
+
+  double number(std::size_t i) const { return std::atof(fields[i].c_str()); }
+
+  // Half a unit in the last decimal place the field was written with
+  double rounding(std::size_t i) const {
+    const std::string &f = fields[i];
+    const std::size_t dot = f.find('.');
+    const int decimals = dot == std::string::npos ? 0 : int(f.size() - dot - 1);
+    return 0.5 * std::pow(10.0, -decimals) + kRoundingSlack__db;
+  }
+};
+
+std::vector<CsvRow> read_csv(const std::string &path, bool header) {
+  std::ifstream in(path);
+  if (!in) {
+    std::fprintf(stderr, "cannot open %s\n", path.c_str());
+    std::exit(2);
+  }
+
+  std::vector<CsvRow> rows;
+  std::string line;
+  if (header)
+    std::getline(in, line);
+  while (std::getline(in, line)) {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    if (line.empty())
+      continue;
+
+    CsvRow row;
+    std::stringstream ss(line);
+    std::string field;
+    while (std::getline(ss, field, ','))
+      if (!field.empty())
+        row.fields.push_back(field);
+    rows.push_back(row);
+  }
+  return rows;
+}
+
+double now() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+bool succeeded(int status) {
+  return status == SUCCESS || status == SUCCESS_WITH_WARNINGS;
+}
+
+// Counts reference comparisons and reports the failing ones
+struct Checker {
+  int checks = 0;
+  int failures = 0;
+
+  void expect(const std::string &what, int status, double got, double want,
+              double tolerance) {
+    checks++;
+    if (succeeded(status) && std::fabs(got - want) <= tolerance)
+      return;
+    failures++;
+    std::printf("  DRIFT %-28s status %d  got %.6f  want %.6f  (tol %g)\n",
+                what.c_str(), status, got, want, tolerance);
+  }
+};
+
+// ---------------------------------------------------------------------------
+// Reference vectors
+
+struct P2PCase {
+  std::vector<double> pfl;
+  double h_tx__meter, h_rx__meter, epsilon, sigma, N_0, f__mhz;
+  int pol, climate, mdvar;
+  double time, location, situation;
+  double A__db, tolerance__db;
+};
+
+struct AreaCase {
+  AreaInputs in;
+  double d__km;
+  double A__db, tolerance__db;
+};
+
+std::vector<P2PCase> load_p2p_cases(const std::string &dir) {
+  const std::vector<CsvRow> rows = read_csv(dir + "/p2p.csv", true);
+  const std::vector<CsvRow> pfls = read_csv(dir + "/pfls.csv", false);
+  if (rows.size() != pfls.size()) {
+    std::fprintf(stderr, "p2p.csv and pfls.csv have different row counts\n");
+    std::exit(2);
+  }
+
+  std::vector<P2PCase> cases;
+  for (std::size_t i = 0; i < rows.size(); i++) {
+    const CsvRow &r = rows[i];
+    P2PCase c;
+    for (std::size_t k = 0; k < pfls[i].fields.size(); k++)
+      c.pfl.push_back(pfls[i].number(k));
+    c.h_tx__meter = r.number(0);
+    c.h_rx__meter = r.number(1);
+    c.epsilon = r.number(2);
+    c.sigma = r.number(3);
+    c.N_0 = r.number(4);
+    c.f__mhz = r.number(5);
+    c.pol = int(r.number(6));
+    c.climate = int(r.number(7));
+    c.time = r.number(8);
+    c.location = r.number(9);
+    c.situation = r.number(10);
+    c.mdvar = int(r.number(11));
+    c.A__db = r.number(12);
+    c.tolerance__db = r.rounding(12);
+    cases.push_back(c);
+  }
+  return cases;
+}
+
+std::vector<AreaCase> load_area_cases(const std::string &dir) {
+  std::vector<AreaCase> cases;
+  for (const CsvRow &r : read_csv(dir + "/area.csv", true)) {
+    AreaCase c;
+    c.in.h_tx__meter = r.number(0);
+    c.in.h_rx__meter = r.number(1);
+    c.in.delta_h__meter = r.number(2);
+    c.in.mdvar = int(r.number(3));
+    c.d__km = r.number(4);
+    c.in.tx_site_criteria = int(r.number(5));
+    c.in.rx_site_criteria = int(r.number(6));
+    c.in.epsilon = r.number(7);
+    c.in.sigma = r.number(8);
+    c.in.N_0 = r.number(9);
+    c.in.f__mhz = r.number(10);
+    c.in.pol = int(r.number(11));
+    c.in.climate = int(r.number(12));
+    c.in.time = r.number(13);
+    c.in.location = r.number(14);
+    c.in.situation = r.number(15);
+    c.A__db = r.number(16);
+    c.tolerance__db = r.rounding(16);
+    cases.push_back(c);
+  }
+  return cases;
+}
+
+int run_p2p(const P2PCase &c, double *A__db) {
+  long warnings;
+  return ITM_P2P_TLS(c.h_tx__meter, c.h_rx__meter, c.pfl.data(), c.climate,
+                     c.N_0, c.f__mhz, c.pol, c.epsilon, c.sigma, c.mdvar,
+                     c.time, c.location, c.situation, A__db, &warnings);
+}
+
+int run_area(const AreaCase &c, double *A__db) {
+  long warnings;
+  const AreaInputs &in = c.in;
+  return ITM_AREA_TLS(in.h_tx__meter, in.h_rx__meter, in.tx_site_criteria,
+                      in.rx_site_criteria, c.d__km, in.delta_h__meter,
+                      in.climate, in.N_0, in.f__mhz, in.pol, in.epsilon,
+                      in.sigma, in.mdvar, in.time, in.location, in.situation,
+                      A__db, &warnings);
+}
+
+// ---------------------------------------------------------------------------
+// Synthetic profiles
+
+// splitmix64, so the profiles are identical on every platform
+struct Random {
+  std::uint64_t state;
+
+  double uniform() {
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return (z >> 11) * (1.0 / 9007199254740992.0);
+  }
+};
+
+// Links over rolling terrain: ridges at four length scales plus a little
+// per-sample noise, so the terrain does not depend on the sample spacing.
+// Paths run from 5 to 150 km.
+std::vector<P2PCase> synthetic_cases() {
+  static const double kRidgeLength__meter[] = {30e3, 8e3, 2e3, 500};
+  static const double kRidgeHeight__meter[] = {400, 150, 50, 10};
+
+  std::vector<P2PCase> cases;
+  for (int n_points : kSyntheticSizes) {
+    for (int link = 0; link < kSyntheticLinksPerSize; link++) {
+      Random rng = {std::uint64_t(n_points) * 1000 + link};
+      const int np = n_points - 1;
+      const double d__meter = 5e3 + rng.uniform() * 145e3;
+
+      double amplitude[4], phase[4];
+      for (int k = 0; k < 4; k++) {
+        amplitude[k] = rng.uniform() * kRidgeHeight__meter[k];
+        phase[k] = rng.uniform() * 6.283185307179586;
+      }
+      const double base__meter = rng.uniform() * 1500 - 300;
+
+      P2PCase c;
+      c.pfl.resize(n_points + 2);
+      c.pfl[0] = np;
+      c.pfl[1] = d__meter / np;
+      for (int i = 0; i <= np; i++) {
+        const double x__meter = i * c.pfl[1];
+        double z = base__meter + (rng.uniform() - 0.5) * 4;
+        for (int k = 0; k < 4; k++)
+          z += amplitude[k] *
+               std::sin(6.283185307179586 * x__meter / kRidgeLength__meter[k] +
+                        phase[k]);
+        // some paths run over water
+        c.pfl[i + 2] = link % 4 == 0 ? std::max(z, 0.0) : z;
+      }
+
+      c.h_tx__meter = 2 + rng.uniform() * 98;
+      c.h_rx__meter = 1 + rng.uniform() * 14;
+      c.epsilon = 15;
+      c.sigma = 0.005;
+      c.N_0 = 250 + rng.uniform() * 150;
+      c.f__mhz = 50 * std::pow(400.0, rng.uniform());
+      c.pol = link % 2;
+      c.climate = 1 + link % 7;
+      c.mdvar = link % 4;
+      c.time = 1 + rng.uniform() * 98;
+      c.location = 1 + rng.uniform() * 98;
+      c.situation = 1 + rng.uniform() * 98;
+      cases.push_back(c);
+    }
+  }
+  return cases;
+}
+
+int write_synthetic_reference(const std::string &path) {
+  FILE *out = std::fopen(path.c_str(), "w");
+  if (!out) {
+    std::fprintf(stderr, "cannot write %s\n", path.c_str());
+    return 2;
+  }
+  std::fprintf(out, "n_points,link,A__db\n");
+  const std::vector<P2PCase> cases = synthetic_cases();
+  for (std::size_t i = 0; i < cases.size(); i++) {
+    double A__db = NAN;
+    run_p2p(cases[i], &A__db);
+    std::fprintf(out, "%d,%d,%.*f\n", int(cases[i].pfl[0]) + 1,
+                 int(i % kSyntheticLinksPerSize), kSyntheticDecimals, A__db);
+  }
+  std::fclose(out);
+  std::printf("wrote %zu synthetic reference losses to %s\n", cases.size(),
+              path.c_str());
+  return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Batched paths
+
+// Per-link columns and concatenated profiles of a batch of P2P cases
+struct BatchColumns {
+  std::vector<double> pfl;
+  std::vector<std::int64_t> offsets;
+  std::vector<double> h_tx__meter, h_rx__meter, N_0, f__mhz, epsilon, sigma,
+      time, location, situation;
+  std::vector<int> climate, pol, mdvar;
+
+  explicit BatchColumns(const std::vector<P2PCase> &cases) {
+    for (const P2PCase &c : cases) {
+      offsets.push_back(std::int64_t(pfl.size()));
+      pfl.insert(pfl.end(), c.pfl.begin(), c.pfl.end());
+      h_tx__meter.push_back(c.h_tx__meter);
+      h_rx__meter.push_back(c.h_rx__meter);
+      N_0.push_back(c.N_0);
+      f__mhz.push_back(c.f__mhz);
+      epsilon.push_back(c.epsilon);
+      sigma.push_back(c.sigma);
+      time.push_back(c.time);
+      location.push_back(c.location);
+      situation.push_back(c.situation);
+      climate.push_back(c.climate);
+      pol.push_back(c.pol);
+      mdvar.push_back(c.mdvar);
+    }
+  }
+
+  P2PBatchInputs inputs(bool vectorized = false) const {
+    P2PBatchInputs in;
+    in.n_links = offsets.size();
+    in.pfl = pfl.data();
+    in.offsets = offsets.data();
+    in.pfl_stride = 0;
+    in.h_tx__meter = Column<double>{h_tx__meter.data(), 1};
+    in.h_rx__meter = Column<double>{h_rx__meter.data(), 1};
+    in.climate = Column<int>{climate.data(), 1};
+    in.N_0 = Column<double>{N_0.data(), 1};
+    in.f__mhz = Column<double>{f__mhz.data(), 1};
+    in.pol = Column<int>{pol.data(), 1};
+    in.epsilon = Column<double>{epsilon.data(), 1};
+    in.sigma = Column<double>{sigma.data(), 1};
+    in.mdvar = Column<int>{mdvar.data(), 1};
+    in.time = Column<double>{time.data(), 1};
+    in.location = Column<double>{location.data(), 1};
+    in.situation = Column<double>{situation.data(), 1};
+    in.vectorized = vectorized;
+    in.cache = nullptr;
+    return in;
+  }
+};
+
+struct BatchResults {
+  std::vector<double> A__db, theta_hzn, d_hzn__meter, h_e__meter, N_s,
+      delta_h__meter, A_ref__db, A_fs__db, d__km;
+  std::vector<std::int32_t> status, mode;
+  std::vector<std::int64_t> warnings;
+
+  explicit BatchResults(std::size_t n)
+      : A__db(n), theta_hzn(2 * n), d_hzn__meter(2 * n), h_e__meter(2 * n),
+        N_s(n), delta_h__meter(n), A_ref__db(n), A_fs__db(n), d__km(n),
+        status(n), mode(n), warnings(n) {}
+
+  P2PBatchOutputs outputs() {
+    P2PBatchOutputs out;
+    out.A__db = A__db.data();
+    out.status = status.data();
+    out.warnings = warnings.data();
+    out.theta_hzn = theta_hzn.data();
+    out.d_hzn__meter = d_hzn__meter.data();
+    out.h_e__meter = h_e__meter.data();
+    out.N_s = N_s.data();
+    out.delta_h__meter = delta_h__meter.data();
+    out.A_ref__db = A_ref__db.data();
+    out.A_fs__db = A_fs__db.data();
+    out.d__km = d__km.data();
+    out.mode = mode.data();
+    return out;
+  }
+};
+
+// ---------------------------------------------------------------------------
+// Regression checks
+
+void check_p2p(Checker &checker, const char *label,
+               const std::vector<P2PCase> &cases, int n_threads) {
+  const BatchColumns columns(cases);
+  BatchResults batch(cases.size()), vectorized(cases.size());
+  itm_p2p_batch(columns.inputs(), QuantileMode::TLS, n_threads,
+                batch.outputs());
+  itm_p2p_batch(columns.inputs(true), QuantileMode::TLS, n_threads,
+                vectorized.outputs());
+  const double lane_tolerance__db =
+      GetSimdLevel() == SIMD__SCALAR ? 0 : kLaneTolerance__db;
+
+  for (std::size_t i = 0; i < cases.size(); i++) {
+    double A__db = NAN;
+    const int status = run_p2p(cases[i], &A__db);
+    const std::string name = std::string(label) + " #" + std::to_string(i);
+    checker.expect(name, status, A__db, cases[i].A__db,
+                   cases[i].tolerance__db);
+    // the batch must reproduce the single-link call exactly
+    checker.expect(name + " batch", batch.status[i], batch.A__db[i], A__db, 0);
+    checker.expect(name + " vectorized", vectorized.status[i],
+                   vectorized.A__db[i], A__db, lane_tolerance__db);
+  }
+}
+
+// Area loss of c.in at d__km through ITM_AREA_TLS_Ex
+int run_area_ex(const AreaCase &c, double d__km, double *A__db,
+                long *warnings, IntermediateValues *values) {
+  const AreaInputs &in = c.in;
+  return ITM_AREA_TLS_Ex(in.h_tx__meter, in.h_rx__meter, in.tx_site_criteria,
+                         in.rx_site_criteria, d__km, in.delta_h__meter,
+                         in.climate, in.N_0, in.f__mhz, in.pol, in.epsilon,
+                         in.sigma, in.mdvar, in.time, in.location,
+                         in.situation, A__db, warnings, values);
+}
+
+// Each area.csv parameter set is also evaluated over kAreaDistances__km, and
+// through an AreaLossTable, which must reproduce ITM at its samples and stay
+// within kAreaTableTolerance__db of it halfway between them
+void check_area(Checker &checker, const std::vector<AreaCase> &cases) {
+  const std::size_t n_distances =
+      sizeof(kAreaDistances__km) / sizeof(kAreaDistances__km[0]);
+  int modes[4] = {0, 0, 0, 0};
+  double max_interp = 0;
+
+  for (std::size_t i = 0; i < cases.size(); i++) {
+    const AreaCase &c = cases[i];
+    double A__db = NAN;
+    const int status = run_area(c, &A__db);
+    const std::string name = "area.csv #" + std::to_string(i);
+    checker.expect(name, status, A__db, c.A__db, c.tolerance__db);
+
+    std::vector<double> A_vec__db(n_distances), A_ref__db(n_distances),
+        A_fs__db(n_distances);
+    std::vector<std::int32_t> vec_status(n_distances), mode(n_distances);
+    std::vector<std::int64_t> warnings(n_distances);
+    const AreaDistanceOutputs out = {A_vec__db.data(), vec_status.data(),
+                                     warnings.data(),  A_ref__db.data(),
+                                     A_fs__db.data(),  mode.data()};
+    itm_area_distances(c.in, QuantileMode::TLS, n_distances,
+                       kAreaDistances__km, out, nullptr);
+
+    int seen = 0;
+    for (std::size_t k = 0; k < n_distances; k++) {
+      const std::string at = name + " at " + std::to_string(k);
+      double want__db = NAN;
+      long want_warnings = 0;
+      IntermediateValues values;
+      const int want_status = run_area_ex(c, kAreaDistances__km[k], &want__db,
+                                          &want_warnings, &values);
+      checker.expect(at + " status", SUCCESS, vec_status[k], want_status, 0);
+      checker.expect(at + " warnings", SUCCESS, double(warnings[k]),
+                     double(want_warnings), 0);
+      if (!succeeded(want_status))
+        continue;
+      checker.expect(at, vec_status[k], A_vec__db[k], want__db, 0);
+      checker.expect(at + " mode", vec_status[k], mode[k], values.mode, 0);
+      modes[values.mode & 3]++;
+      seen |= 1 << (values.mode & 3);
+    }
+    const int all_modes = 1 << MODE__LINE_OF_SIGHT | 1 << MODE__DIFFRACTION |
+                          1 << MODE__TROPOSCATTER;
+    checker.expect(name + " modes", SUCCESS, seen, all_modes, 0);
+
+    const AreaLossTable table(c.in, QuantileMode::TLS, kAreaTable__km[0],
+                              kAreaTable__km[1], kAreaTableSamples);
+    const std::vector<double> &d__km = table.d__km();
+    for (std::size_t k = 0; k < d__km.size(); k++) {
+      const std::string at = name + " table " + std::to_string(k);
+      long warnings_k;
+      IntermediateValues values;
+      double want__db = NAN;
+      int want_status =
+          run_area_ex(c, d__km[k], &want__db, &warnings_k, &values);
+      if (succeeded(want_status))
+        checker.expect(at, want_status, table(d__km[k]), want__db,
+                       kRoundingSlack__db);
+      if (k + 1 == d__km.size())
+        break;
+
+      // halfway in log distance, where the table interpolates
+      const double d_mid__km = std::sqrt(d__km[k] * d__km[k + 1]);
+      want_status =
+          run_area_ex(c, d_mid__km, &want__db, &warnings_k, &values);
+      if (succeeded(want_status)) {
+        const double got__db = table(d_mid__km);
+        checker.expect(at + " midpoint", want_status, got__db, want__db,
+                       kAreaTableTolerance__db);
+        max_interp = std::max(max_interp, std::fabs(got__db - want__db));
+      }
+    }
+    checker.expect(name + " table below range", SUCCESS,
+                   std::isnan(table(0.5 * kAreaTable__km[0])), 1, 0);
+    checker.expect(name + " table above range", SUCCESS,
+                   std::isnan(table(2 * kAreaTable__km[1])), 1, 0);
+  }
+
+  std::printf("area: %d line of sight, %d diffraction, %d troposcatter "
+              "distances; table interpolation error up to %.3g dB\n",
+              modes[MODE__LINE_OF_SIGHT], modes[MODE__DIFFRACTION],
+              modes[MODE__TROPOSCATTER], max_interp);
+}
+
+// Every cell of itm_p2p_sweep against the single-link call it stands for:
+// same status and warnings, and the same loss to the bit where it succeeds
+void check_sweep(Checker &checker, const std::vector<P2PCase> &cases) {
+  const std::size_t n_freqs =
+      sizeof(kSweepFrequencies__mhz) / sizeof(kSweepFrequencies__mhz[0]);
+  int cells = 0, failed = 0;
+
+  for (int cr = 0; cr < 2; cr++) {
+    const QuantileMode mode = cr ? QuantileMode::CR : QuantileMode::TLS;
+    const std::size_t n_quantiles =
+        cr ? sizeof(kSweepCR) / sizeof(kSweepCR[0])
+           : sizeof(kSweepTLS) / sizeof(kSweepTLS[0]);
+    const double *quantiles = cr ? &kSweepCR[0][0] : &kSweepTLS[0][0];
+    const std::size_t width = cr ? 2 : 3;
+
+    for (std::size_t i = 0; i < cases.size(); i++) {
+      const P2PCase &c = cases[i];
+      P2PSweepInputs in;
+      in.pfl = c.pfl.data();
+      in.h_tx__meter = c.h_tx__meter;
+      in.h_rx__meter = c.h_rx__meter;
+      in.climate = c.climate;
+      in.N_0 = c.N_0;
+      in.pol = c.pol;
+      in.epsilon = c.epsilon;
+      in.sigma = c.sigma;
+      in.mdvar = c.mdvar;
+      in.n_freqs = n_freqs;
+      in.f__mhz = kSweepFrequencies__mhz;
+      in.n_quantiles = n_quantiles;
+      in.quantiles = quantiles;
+
+      const std::size_t n = n_freqs * n_quantiles;
+      std::vector<double> A__db(n), A_ref__db(n_freqs), A_fs__db(n_freqs);
+      std::vector<std::int32_t> status(n), prop_mode(n_freqs);
+      std::vector<std::int64_t> warnings(n);
+      IntermediateValues geometry;
+      const P2PSweepOutputs out = {A__db.data(),     status.data(),
+                                   warnings.data(),  A_ref__db.data(),
+                                   A_fs__db.data(),  prop_mode.data(),
+                                   &geometry};
+      itm_p2p_sweep(in, mode, out);
+
+      for (std::size_t f = 0; f < n_freqs; f++) {
+        const double f__mhz = kSweepFrequencies__mhz[f];
+        bool have_ref = false;
+        for (std::size_t q = 0; q < n_quantiles; q++) {
+          const double *row = quantiles + q * width;
+          const std::size_t k = f * n_quantiles + q;
+          const std::string name = std::string(cr ? "sweep cr #" : "sweep #") +
+                                   std::to_string(i) + " f " +
+                                   std::to_string(f) + " q " +
+                                   std::to_string(q);
+
+          double want__db = NAN;
+          long want_warnings = 0;
+          IntermediateValues values;
+          const int want_status =
+              cr ? ITM_P2P_CR_Ex(c.h_tx__meter, c.h_rx__meter, c.pfl.data(),
+                                 c.climate, c.N_0, f__mhz, c.pol, c.epsilon,
+                                 c.sigma, c.mdvar, row[0], row[1], &want__db,
+                                 &want_warnings, &values)
+                 : ITM_P2P_TLS_Ex(c.h_tx__meter, c.h_rx__meter, c.pfl.data(),
+                                  c.climate, c.N_0, f__mhz, c.pol, c.epsilon,
+                                  c.sigma, c.mdvar, row[0], row[1], row[2],
+                                  &want__db, &want_warnings, &values);
+
+          cells++;
+          failed += !succeeded(want_status);
+          checker.expect(name + " status", SUCCESS, status[k], want_status, 0);
+          checker.expect(name + " warnings", SUCCESS, double(warnings[k]),
+                         double(want_warnings), 0);
+          if (!succeeded(want_status)) {
+            checker.expect(name + " loss", SUCCESS, std::isnan(A__db[k]), 1,
+                           0);
+            continue;
+          }
+          checker.expect(name, status[k], A__db[k], want__db, 0);
+
+          // the per-frequency outputs come from the first valid cell
+          if (!have_ref) {
+            checker.expect(name + " A_ref", status[k], A_ref__db[f],
+                           values.A_ref__db, 0);
+            checker.expect(name + " A_fs", status[k], A_fs__db[f],
+                           values.A_fs__db, 0);
+            checker.expect(name + " mode", status[k], prop_mode[f],
+                           values.mode, 0);
+            have_ref = true;
+          }
+        }
+      }
+    }
+  }
+
+  std::printf("sweep: %d cells, %d rejected, bit for bit with "
+              "ITM_P2P_TLS_Ex and ITM_P2P_CR_Ex\n",
+              cells, failed);
+}
+
+// Rows i of a and b hold the same values, NaN matching NaN
+bool same_row(const BatchResults &a, const BatchResults &b, std::size_t i) {
+  const auto same = [](double x, double y) {
+    return x == y || (std::isnan(x) && std::isnan(y));
+  };
+  bool equal = a.status[i] == b.status[i] && a.warnings[i] == b.warnings[i] &&
+               a.mode[i] == b.mode[i] && same(a.A__db[i], b.A__db[i]) &&
+               same(a.N_s[i], b.N_s[i]) &&
+               same(a.delta_h__meter[i], b.delta_h__meter[i]) &&
+               same(a.A_ref__db[i], b.A_ref__db[i]) &&
+               same(a.A_fs__db[i], b.A_fs__db[i]) &&
+               same(a.d__km[i], b.d__km[i]);
+  for (std::size_t t = 2 * i; t < 2 * i + 2; t++)
+    equal = equal && same(a.theta_hzn[t], b.theta_hzn[t]) &&
+            same(a.d_hzn__meter[t], b.d_hzn__meter[t]) &&
+            same(a.h_e__meter[t], b.h_e__meter[t]);
+  return equal;
+}
+
+// A batch run against a cache filled by the same batch must find every link
+// in it and reproduce the uncached rows exactly, also after reopening the
+// cache read-only and from the single-link path
+void check_cache(Checker &checker, const std::vector<P2PCase> &cases,
+                 int n_threads) {
+  const BatchColumns columns(cases);
+  const std::size_t n = cases.size();
+  std::remove(kCachePath);
+
+  for (int vectorized = 0; vectorized <= 1; vectorized++) {
+    const std::string label = vectorized ? "cache vectorized" : "cache";
+    P2PBatchInputs in = columns.inputs(vectorized != 0);
+    BatchResults plain(n), filled(n), cached(n), reopened(n);
+    itm_p2p_batch(in, QuantileMode::TLS, n_threads, plain.outputs());
+
+    {
+      LinkCache cache(kCachePath);
+      const std::uint64_t stored = cache.stats().records;
+      in.cache = &cache;
+      itm_p2p_batch(in, QuantileMode::TLS, n_threads, filled.outputs());
+      const LinkCacheStats first = cache.stats();
+      itm_p2p_batch(in, QuantileMode::TLS, n_threads, cached.outputs());
+      const LinkCacheStats second = cache.stats();
+      checker.expect(label + " hits", SUCCESS,
+                     double(second.hits - first.hits), double(n), 0);
+      checker.expect(label + " records", SUCCESS, double(second.records),
+                     double(stored + second.inserts), 0);
+    }
+    {
+      LinkCache cache(kCachePath, false);
+      in.cache = &cache;
+      itm_p2p_batch(in, QuantileMode::TLS, n_threads, reopened.outputs());
+      checker.expect(label + " reopened hits", SUCCESS,
+                     double(cache.stats().hits), double(n), 0);
+    }
+
+    int mismatched = 0;
+    for (std::size_t i = 0; i < n; i++)
+      mismatched += !same_row(filled, plain, i) +
+                    !same_row(cached, plain, i) +
+                    !same_row(reopened, plain, i);
+    checker.expect(label + " rows", SUCCESS, mismatched, 0, 0);
+  }
+
+  // single-link calls share entries with the scalar batch
+  {
+    LinkCache cache(kCachePath);
+    for (std::size_t i = 0; i < n; i++) {
+      const P2PCase &c = cases[i];
+      double A__db, want__db;
+      long warnings;
+      IntermediateValues values;
+      const int status = itm_p2p_link(
+          &cache, QuantileMode::TLS, c.h_tx__meter, c.h_rx__meter,
+          c.pfl.data(), c.climate, c.N_0, c.f__mhz, c.pol, c.epsilon, c.sigma,
+          c.mdvar, c.time, c.location, c.situation, &A__db, &warnings,
+          &values);
+      run_p2p(c, &want__db);
+      checker.expect("cache single #" + std::to_string(i), status, A__db,
+                     want__db, 0);
+    }
+    checker.expect("cache single hits", SUCCESS, double(cache.stats().hits),
+                   double(n), 0);
+  }
+  std::remove(kCachePath);
+}
+
+// Path parameters of a batch of links in the layout LongleyRiceBatch reads
+struct LaneColumns {
+  std::vector<double> theta_hzn[2], d_hzn__meter[2], h_e__meter[2],
+      h__meter[2];
+  std::vector<double> delta_h__meter, d__meter, Z_g_real, Z_g_imag, gamma_e,
+      N_s, f__mhz;
+
+  // The terrain analysis of every case, at each of kLaneDistanceScales
+  explicit LaneColumns(const std::vector<P2PCase> &cases) {
+    for (const P2PCase &c : cases) {
+      complex<double> Z_g;
+      double gamma_e_c, N_s_c, theta_hzn_c[2], d_hzn__meter_c[2],
+          h_e__meter_c[2], delta_h__meter_c, d__meter_c;
+      long warnings = 0;
+      if (InitializePointToPointPath(
+              c.h_tx__meter, c.h_rx__meter, c.pfl.data(), c.climate, c.N_0,
+              c.f__mhz, c.pol, c.epsilon, c.sigma, c.mdvar, c.time,
+              c.location, c.situation, &Z_g, &gamma_e_c, &N_s_c, theta_hzn_c,
+              d_hzn__meter_c, h_e__meter_c, &delta_h__meter_c, &d__meter_c,
+              &warnings) != SUCCESS)
+        continue;
+
+      for (double scale : kLaneDistanceScales) {
+        for (int t = 0; t < 2; t++) {
+          theta_hzn[t].push_back(theta_hzn_c[t]);
+          d_hzn__meter[t].push_back(d_hzn__meter_c[t]);
+          h_e__meter[t].push_back(h_e__meter_c[t]);
+        }
+        h__meter[0].push_back(c.h_tx__meter);
+        h__meter[1].push_back(c.h_rx__meter);
+        delta_h__meter.push_back(delta_h__meter_c);
+        d__meter.push_back(d__meter_c * scale);
+        Z_g_real.push_back(Z_g.real());
+        Z_g_imag.push_back(Z_g.imag());
+        gamma_e.push_back(gamma_e_c);
+        N_s.push_back(N_s_c);
+        f__mhz.push_back(c.f__mhz);
+      }
+    }
+  }
+
+  std::size_t size() const { return d__meter.size(); }
+
+  LinkGeometry geometry() const {
+    LinkGeometry g;
+    for (int t = 0; t < 2; t++) {
+      g.theta_hzn[t] = theta_hzn[t].data();
+      g.d_hzn__meter[t] = d_hzn__meter[t].data();
+      g.h_e__meter[t] = h_e__meter[t].data();
+      g.h__meter[t] = h__meter[t].data();
+    }
+    g.delta_h__meter = delta_h__meter.data();
+    g.d__meter = d__meter.data();
+    g.Z_g_real = Z_g_real.data();
+    g.Z_g_imag = Z_g_imag.data();
+    g.gamma_e = gamma_e.data();
+    g.N_s = N_s.data();
+    g.f__mhz = f__mhz.data();
+    return g;
+  }
+};
+
+// Variability inputs shared by a LongleyRiceBatch call
+struct LaneQuantiles {
+  int climate, mdvar;
+  double time, location, situation;
+};
+
+struct LaneResults {
+  std::vector<double> A__db, A_ref__db, A_fs__db;
+  std::vector<int> mode, status;
+  std::vector<long> warnings;
+
+  explicit LaneResults(std::size_t n)
+      : A__db(n), A_ref__db(n), A_fs__db(n), mode(n), status(n),
+        warnings(n) {}
+
+  void run(const LaneColumns &columns, const LaneQuantiles &q) {
+    std::fill(warnings.begin(), warnings.end(), 0);
+    const LinkGeometry links = columns.geometry();
+    const LinkLosses losses = {A__db.data(), A_ref__db.data(),
+                               A_fs__db.data(), mode.data(),
+                               warnings.data(), status.data()};
+    LongleyRiceBatch(int(columns.size()), &links, MODE__P2P, q.time,
+                     q.location, q.situation, q.climate, q.mdvar, &losses);
+  }
+
+  // Largest loss difference to other, or infinity if the links do not
+  // succeed, warn or propagate alike
+  double difference(const LaneResults &other) const {
+    double diff = 0;
+    for (std::size_t i = 0; i < A__db.size(); i++) {
+      if (status[i] != other.status[i] || warnings[i] != other.warnings[i])
+        return INFINITY;
+      if (!succeeded(status[i]))
+        continue;
+      if (mode[i] != other.mode[i])
+        return INFINITY;
+      diff = std::max(diff, std::fabs(A__db[i] - other.A__db[i]));
+      diff = std::max(diff, std::fabs(A_ref__db[i] - other.A_ref__db[i]));
+      diff = std::max(diff, std::fabs(A_fs__db[i] - other.A_fs__db[i]));
+    }
+    return diff;
+  }
+};
+
+// LongleyRiceBatch on every SIMD level up to the active one against the
+// scalar functions, across climates, modes of variability and quantiles.
+// The AVX2 and AVX-512 kernels must agree exactly.
+void check_lanes(Checker &checker, const std::vector<P2PCase> &cases) {
+  static const int kMdvars[] = {0, 1, 2, 3, 13, 22};
+  static const double kQuantiles[][3] = {
+      {50, 50, 50}, {90, 10, 95}, {5, 99, 20}, {99.9, 0.1, 50}};
+
+  const LaneColumns columns(cases);
+  const int active = GetSimdLevel();
+  static const char *const kLevelNames[] = {"scalar", "avx2", "avx512"};
+
+  double max_diff = 0;
+  for (int climate = CLIMATE__EQUATORIAL;
+       climate <= CLIMATE__MARITIME_TEMPERATE_OVER_SEA; climate++)
+    for (int mdvar : kMdvars)
+      for (const double *quantile : kQuantiles) {
+        const LaneQuantiles q = {climate, mdvar, quantile[0], quantile[1],
+                                 quantile[2]};
+        const std::string name = "lanes c" + std::to_string(climate) +
+                                 " mdvar " + std::to_string(mdvar) + " q" +
+                                 std::to_string(int(quantile[0]));
+
+        LaneResults scalar(columns.size()), avx2(columns.size());
+        SetSimdLevel(SIMD__SCALAR);
+        scalar.run(columns, q);
+        for (int level = SIMD__AVX2; level <= active; level++) {
+          LaneResults lanes(columns.size());
+          SetSimdLevel(level);
+          lanes.run(columns, q);
+          const double diff = lanes.difference(scalar);
+          max_diff = std::max(max_diff, diff);
+          checker.expect(name + " " + kLevelNames[level], SUCCESS, diff, 0,
+                         kLaneTolerance__db);
+          if (level == SIMD__AVX2)
+            avx2 = lanes;
+          else
+            checker.expect(name + " avx512 vs avx2", SUCCESS,
+                           lanes.difference(avx2), 0, 0);
+        }
+      }
+  SetSimdLevel(active);
+
+  if (active != SIMD__SCALAR)
+    std::printf("lanes: %zu links per configuration, largest difference to "
+                "scalar %.3g dB\n",
+                columns.size(), max_diff);
+}
+
+// ---------------------------------------------------------------------------
+// DEM tile store
+
+// Integer elevations (as SRTM stores them), so the float32 tiles hold the
+// raster exactly
+std::vector<double> synthetic_dem(GeoGrid *grid) {
+  std::vector<double> z(std::size_t(kDemPosts) * kDemPosts);
+  for (int r = 0; r < kDemPosts; r++)
+    for (int c = 0; c < kDemPosts; c++)
+      z[std::size_t(r) * kDemPosts + c] = std::floor(
+          1500 + 400 * std::sin(r * 0.011) * std::cos(c * 0.017) +
+          60 * std::sin(r * 0.13 + c * 0.07));
+  // a nodata hole, which profiles must report as missing samples
+  for (int r = 600; r < 620; r++)
+    for (int c = 600; c < 620; c++)
+      z[std::size_t(r) * kDemPosts + c] = -32768;
+
+  const double post = 1.0 / (kDemPosts - 1);
+  grid->z = z.data();
+  grid->rows = kDemPosts;
+  grid->cols = kDemPosts;
+  const double gt[6] = {kDemLon - post / 2, post, 0,
+                        kDemLat + 1 + post / 2, 0, -post};
+  std::copy(gt, gt + 6, grid->gt);
+  grid->nodata = -32768;
+  return z;
+}
+
+// Endpoints of kDemLinks links inside the synthetic DEM, plus one that runs
+// off its eastern edge
+void dem_links(std::vector<double> *lat_1, std::vector<double> *lon_1,
+               std::vector<double> *lat_2, std::vector<double> *lon_2) {
+  Random rng = {7};
+  for (int i = 0; i < kDemLinks; i++) {
+    lat_1->push_back(kDemLat + 0.05 + 0.9 * rng.uniform());
+    lon_1->push_back(kDemLon + 0.05 + 0.9 * rng.uniform());
+    lat_2->push_back(kDemLat + 0.05 + 0.9 * rng.uniform());
+    lon_2->push_back(kDemLon + 0.05 + 0.9 * rng.uniform());
+  }
+  lat_1->push_back(kDemLat + 0.5);
+  lon_1->push_back(kDemLon + 0.5);
+  lat_2->push_back(kDemLat + 0.5);
+  lon_2->push_back(kDemLon + 1.5);
+}
+
+void check_dem(Checker &checker, int n_threads) {
+  GeoGrid grid;
+  const std::vector<double> z = synthetic_dem(&grid);
+  DemStore::create(kDemPath, grid, 128);
+
+  std::vector<double> lat_1, lon_1, lat_2, lon_2;
+  dem_links(&lat_1, &lon_1, &lat_2, &lon_2);
+  const std::size_t n = lat_1.size();
+
+  {
+    // few enough mapped tiles that long profiles keep evicting
+    const DemStore store(kDemPath, 8);
+    DemProfiles profiles;
+    dem_profiles(store, n, lat_1.data(), lon_1.data(), lat_2.data(),
+                 lon_2.data(), kDemSpacing__meter, n_threads, &profiles);
+
+    for (std::size_t i = 0; i < n; i++) {
+      const double *pfl = profiles.pfl.data() + profiles.offsets[i];
+      const int np = int(pfl[0]);
+      const double bearing =
+          initial_bearing(lat_1[i], lon_1[i], lat_2[i], lon_2[i]);
+
+      int mismatched = 0, missing = 0;
+      for (int j = 0; j <= np; j++) {
+        double lat, lon;
+        destination_point(lat_1[i], lon_1[i], bearing, j * pfl[1], &lat, &lon);
+        const double want = sample_bilinear(grid, lat, lon);
+        missing += std::isnan(want);
+        if (!(pfl[j + 2] == want || (std::isnan(want) && std::isnan(pfl[j + 2]))))
+          mismatched++;
+      }
+
+      const std::string name = "dem profile #" + std::to_string(i);
+      checker.expect(name, SUCCESS, mismatched, 0, 0);
+      checker.expect(name + " missing", SUCCESS, double(profiles.missing[i]),
+                     missing, 0);
+    }
+
+    const DemStoreStats stats = store.stats();
+    checker.expect("dem store mapped tiles", SUCCESS, double(stats.mapped), 8,
+                   0);
+
+    // links without a direction or a sample spacing are rejected up front
+    const double bad_lat[] = {NAN, kDemLat + 0.5, kDemLat + 0.5};
+    const double bad_lon[] = {kDemLon + 0.5, INFINITY, kDemLon + 0.5};
+    for (int k = 0; k < 3; k++) {
+      const double lat_2 = kDemLat + 0.5, lon_2 = kDemLon + 0.5;
+      bool rejected = false;
+      try {
+        DemProfiles bad;
+        dem_profiles(store, 1, &bad_lat[k], &bad_lon[k], &lat_2, &lon_2,
+                     kDemSpacing__meter, n_threads, &bad);
+      } catch (const std::runtime_error &) {
+        rejected = true;
+      }
+      checker.expect("dem invalid link #" + std::to_string(k), SUCCESS,
+                     rejected, 1, 0);
+    }
+  }
+  std::remove(kDemPath);
+}
+
+// Every receiver of a radial sweep against ITM_P2P_TLS_Ex on the profile
+// truncated at that receiver, with the same status and warnings; receivers
+// past the first off-raster sample must report STATUS__OFF_GRID
+void check_radial(Checker &checker, int n_threads) {
+  GeoGrid grid;
+  const std::vector<double> z = synthetic_dem(&grid);
+
+  RadialSweepInputs in;
+  in.grid = grid;
+  in.lat = kRadialLat;
+  in.lon = kRadialLon;
+  in.h_tx__meter = 30;
+  in.h_rx__meter = 2;
+  in.n_radials = kRadials;
+  in.n_steps = kRadialSteps;
+  in.step__meter = kDemSpacing__meter;
+  in.climate = CLIMATE__CONTINENTAL_TEMPERATE;
+  in.N_0 = 301;
+  in.f__mhz = 915;
+  in.pol = POLARIZATION__VERTICAL;
+  in.epsilon = 15;
+  in.sigma = 0.005;
+  in.mdvar = MDVAR__MOBILE_MODE;
+  in.time = 90;
+  in.location = 90;
+  in.situation = 50;
+
+  const std::size_t n = std::size_t(kRadials) * kRadialSteps;
+  std::vector<double> A__db(n), lat(n), lon(n);
+  std::vector<std::int32_t> status(n);
+  std::vector<std::int64_t> warnings(n);
+  const RadialSweepOutputs out = {A__db.data(), status.data(),
+                                  warnings.data(), lat.data(), lon.data()};
+  itm_p2p_radial_sweep(in, n_threads, out);
+
+  int off_grid = 0;
+  double max_diff = 0;
+  for (int r = 0; r < kRadials; r++) {
+    const double bearing = 360.0 * r / kRadials;
+    std::vector<double> pfl(kRadialSteps + 3);
+    pfl[1] = in.step__meter;
+
+    int n_valid = -1;
+    for (int j = 0; j <= kRadialSteps && n_valid == j - 1; j++) {
+      double lat_j, lon_j;
+      destination_point(in.lat, in.lon, bearing, j * in.step__meter, &lat_j,
+                        &lon_j);
+      pfl[j + 2] = sample_bilinear(grid, lat_j, lon_j);
+      if (!std::isnan(pfl[j + 2]))
+        n_valid = j;
+    }
+
+    for (int j = 1; j <= kRadialSteps; j++) {
+      const std::size_t k = std::size_t(r) * kRadialSteps + j - 1;
+      const std::string name =
+          "radial " + std::to_string(r) + " rx " + std::to_string(j);
+
+      if (j > n_valid) {
+        off_grid++;
+        checker.expect(name + " off grid", SUCCESS, status[k],
+                       STATUS__OFF_GRID, 0);
+        checker.expect(name + " off grid loss", SUCCESS,
+                       std::isnan(A__db[k]), 1, 0);
+        continue;
+      }
+
+      pfl[0] = j;
+      double want__db = NAN;
+      long want_warnings = 0;
+      IntermediateValues values;
+      const int want_status = ITM_P2P_TLS_Ex(
+          in.h_tx__meter, in.h_rx__meter, pfl.data(), in.climate, in.N_0,
+          in.f__mhz, in.pol, in.epsilon, in.sigma, in.mdvar, in.time,
+          in.location, in.situation, &want__db, &want_warnings, &values);
+
+      checker.expect(name + " status", SUCCESS, status[k], want_status, 0);
+      checker.expect(name + " warnings", SUCCESS, double(warnings[k]),
+                     double(want_warnings), 0);
+      if (succeeded(want_status)) {
+        checker.expect(name, status[k], A__db[k], want__db,
+                       kRadialTolerance__db);
+        max_diff = std::max(max_diff, std::fabs(A__db[k] - want__db));
+      }
+    }
+  }
+
+  std::printf("radial: %zu receivers, %d off grid, largest difference to "
+              "ITM_P2P_TLS_Ex %.3g dB\n",
+              n, off_grid, max_diff);
+}
+
+// Sites and receivers of the best-server scenario, with per-site heights,
+// powers and frequencies
+struct BestServerScenario {
+  std::vector<double> tx_lat, tx_lon, h_tx__meter, eirp__dbm, f__mhz;
+  std::vector<double> rx_lat, rx_lon;
+
+  BestServerScenario() {
+    Random rng = {11};
+    for (int i = 0; i < kServerGrid * kServerGrid; i++) {
+      tx_lat.push_back(kDemLat + 0.1 + 0.8 * (i / kServerGrid + rng.uniform()) /
+                                           kServerGrid);
+      tx_lon.push_back(kDemLon + 0.1 + 0.8 * (i % kServerGrid + rng.uniform()) /
+                                           kServerGrid);
+      h_tx__meter.push_back(10 + 40 * rng.uniform());
+      eirp__dbm.push_back(20 + 20 * rng.uniform());
+      f__mhz.push_back(rng.uniform() < 0.5 ? 900 : 1800);
+    }
+    for (int r = 0; r < kReceiverGrid; r++)
+      for (int c = 0; c < kReceiverGrid; c++) {
+        rx_lat.push_back(kDemLat + 0.05 + 0.9 * r / (kReceiverGrid - 1));
+        rx_lon.push_back(kDemLon + 0.05 + 0.9 * c / (kReceiverGrid - 1));
+      }
+  }
+
+  BestServerInputs inputs(const DemStore &store, bool prune) const {
+    BestServerInputs in;
+    in.store = &store;
+    in.spacing__meter = kDemSpacing__meter;
+    in.n_tx = tx_lat.size();
+    in.tx_lat = tx_lat.data();
+    in.tx_lon = tx_lon.data();
+    in.h_tx__meter = Column<double>{h_tx__meter.data(), 1};
+    in.eirp__dbm = Column<double>{eirp__dbm.data(), 1};
+    in.f__mhz = Column<double>{f__mhz.data(), 1};
+    in.n_rx = rx_lat.size();
+    in.rx_lat = rx_lat.data();
+    in.rx_lon = rx_lon.data();
+    static const double h_rx__meter = 1.5;
+    in.h_rx__meter = Column<double>{&h_rx__meter, 0};
+    in.threshold__dbm = kSensitivity__dbm;
+    in.climate = CLIMATE__CONTINENTAL_TEMPERATE;
+    in.N_0 = 301;
+    in.pol = POLARIZATION__VERTICAL;
+    in.epsilon = 15;
+    in.sigma = 0.005;
+    in.mdvar = MDVAR__MOBILE_MODE;
+    in.time = 90;
+    in.location = 90;
+    in.situation = 50;
+    in.prune = prune;
+    return in;
+  }
+};
+
+struct BestServerResults {
+  std::vector<std::int32_t> best, second;
+  std::vector<double> best__dbm, margin__db, second__dbm;
+  BestServerCounters counters;
+
+  explicit BestServerResults(std::size_t n)
+      : best(n), second(n), best__dbm(n), margin__db(n), second__dbm(n) {}
+
+  void run(const BestServerInputs &in, int n_threads) {
+    const BestServerOutputs out = {best.data(), best__dbm.data(),
+                                   margin__db.data(), second.data(),
+                                   second__dbm.data()};
+    itm_best_server(in, n_threads, out, &counters);
+  }
+};
+
+void check_best_server(Checker &checker, int n_threads) {
+  GeoGrid grid;
+  const std::vector<double> z = synthetic_dem(&grid);
+  DemStore::create(kDemPath, grid);
+
+  {
+    const DemStore store(kDemPath);
+    const BestServerScenario scenario;
+    const std::size_t n = scenario.rx_lat.size();
+    BestServerResults pruned(n), full(n);
+    pruned.run(scenario.inputs(store, true), n_threads);
+    full.run(scenario.inputs(store, false), n_threads);
+
+    // pruning must not change any server or power
+    int differing = 0;
+    for (std::size_t i = 0; i < n; i++) {
+      const bool same =
+          pruned.best[i] == full.best[i] && pruned.second[i] == full.second[i] &&
+          (pruned.best__dbm[i] == full.best__dbm[i] || pruned.best[i] < 0) &&
+          (pruned.second__dbm[i] == full.second__dbm[i] || pruned.second[i] < 0);
+      differing += !same;
+    }
+    checker.expect("best server pruned vs full", SUCCESS, differing, 0, 0);
+
+    const BestServerCounters &c = pruned.counters;
+    checker.expect("best server link count", SUCCESS,
+                   double(c.below_threshold + c.outranked + c.evaluated),
+                   double(c.links), 0);
+    std::printf("best server: %llu links, %llu below threshold, %llu "
+                "outranked, %llu evaluated (%llu failed)\n",
+                (unsigned long long)c.links,
+                (unsigned long long)c.below_threshold,
+                (unsigned long long)c.outranked,
+                (unsigned long long)c.evaluated,
+                (unsigned long long)c.failed);
+  }
+  std::remove(kDemPath);
+}
+
+// ---------------------------------------------------------------------------
+// Throughput
+
+// Repeat fn (which processes `per_call` links) for at least `seconds`
+template <typename Fn>
+double links_per_second(double seconds, std::size_t per_call, Fn fn) {
+  std::size_t calls = 0;
+  const double start = now();
+  double elapsed = 0;
+  do {
+    fn();
+    calls++;
+    elapsed = now() - start;
+  } while (elapsed < seconds);
+  return double(calls * per_call) / elapsed;
+}
+
+void report(const char *label, double rate) {
+  std::printf("  %-40s %12.0f links/s\n", label, rate);
+}
+
+void bench_p2p(const char *label, const std::vector<P2PCase> &cases,
+               const Options &opt) {
+  volatile double sink = 0;
+  const double single = links_per_second(opt.seconds, cases.size(), [&] {
+    for (const P2PCase &c : cases) {
+      double A__db;
+      run_p2p(c, &A__db);
+      sink = sink + A__db;
+    }
+  });
+  report((std::string(label) + " single").c_str(), single);
+
+  // enough copies that every worker has several chunks of work
+  std::vector<P2PCase> many;
+  while (many.size() < 4096)
+    many.insert(many.end(), cases.begin(), cases.end());
+  const BatchColumns columns(many);
+  const P2PBatchInputs in = columns.inputs();
+  BatchResults batch(many.size());
+  const P2PBatchOutputs out = batch.outputs();
+  const double batched = links_per_second(opt.seconds, many.size(), [&] {
+    itm_p2p_batch(in, QuantileMode::TLS, opt.n_threads, out);
+  });
+  report((std::string(label) + " batch").c_str(), batched);
+
+  const P2PBatchInputs vectorized_in = columns.inputs(true);
+  const double vectorized = links_per_second(opt.seconds, many.size(), [&] {
+    itm_p2p_batch(vectorized_in, QuantileMode::TLS, opt.n_threads, out);
+  });
+  report((std::string(label) + " batch vectorized").c_str(), vectorized);
+
+  // every link answered by a cache that one earlier run filled
+  std::remove(kCachePath);
+  {
+    LinkCache cache(kCachePath);
+    P2PBatchInputs cached_in = columns.inputs();
+    cached_in.cache = &cache;
+    itm_p2p_batch(cached_in, QuantileMode::TLS, opt.n_threads, out);
+    const double cached = links_per_second(opt.seconds, many.size(), [&] {
+      itm_p2p_batch(cached_in, QuantileMode::TLS, opt.n_threads, out);
+    });
+    report((std::string(label) + " batch cached").c_str(), cached);
+  }
+  std::remove(kCachePath);
+}
+
+// LongleyRiceBatch alone, once the terrain analysis is done, on the scalar
+// functions and on the active SIMD level
+void bench_lanes(const std::vector<P2PCase> &cases, const Options &opt) {
+  const LaneColumns columns(cases);
+  const LaneQuantiles q = {CLIMATE__CONTINENTAL_TEMPERATE, MDVAR__MOBILE_MODE,
+                           90, 90, 50};
+  LaneResults results(columns.size());
+
+  const int active = GetSimdLevel();
+  SetSimdLevel(SIMD__SCALAR);
+  const double scalar = links_per_second(
+      opt.seconds, columns.size(), [&] { results.run(columns, q); });
+  report("LongleyRiceBatch scalar", scalar);
+  SetSimdLevel(active);
+  if (active == SIMD__SCALAR)
+    return;
+
+  const double lanes = links_per_second(opt.seconds, columns.size(),
+                                        [&] { results.run(columns, q); });
+  report(active == SIMD__AVX512 ? "LongleyRiceBatch avx512"
+                                : "LongleyRiceBatch avx2",
+         lanes);
+}
+
+void bench_area(const std::vector<AreaCase> &cases, const Options &opt) {
+  volatile double sink = 0;
+  const double single = links_per_second(opt.seconds, cases.size(), [&] {
+    for (const AreaCase &c : cases) {
+      double A__db;
+      run_area(c, &A__db);
+      sink = sink + A__db;
+    }
+  });
+  report("area.csv single", single);
+
+  // a 1000-point loss-vs-distance curve per case
+  const std::size_t n = 1000;
+  std::vector<double> d__km(n), A__db(n), A_ref__db(n), A_fs__db(n);
+  std::vector<std::int32_t> status(n), mode(n);
+  std::vector<std::int64_t> warnings(n);
+  for (std::size_t i = 0; i < n; i++)
+    d__km[i] = 1 + i * 0.2;
+  const AreaDistanceOutputs out = {A__db.data(),    status.data(),
+                                   warnings.data(), A_ref__db.data(),
+                                   A_fs__db.data(), mode.data()};
+  const double curve = links_per_second(opt.seconds, cases.size() * n, [&] {
+    for (const AreaCase &c : cases)
+      itm_area_distances(c.in, QuantileMode::TLS, n, d__km.data(), out,
+                         nullptr);
+  });
+  report("area.csv distance curve", curve);
+}
+
+void bench_dem(const Options &opt) {
+  GeoGrid grid;
+  const std::vector<double> z = synthetic_dem(&grid);
+  DemStore::create(kDemPath, grid);
+
+  std::vector<double> lat_1, lon_1, lat_2, lon_2;
+  dem_links(&lat_1, &lon_1, &lat_2, &lon_2);
+  {
+    const DemStore store(kDemPath);
+    DemProfiles profiles;
+    const double rate = links_per_second(opt.seconds, lat_1.size(), [&] {
+      dem_profiles(store, lat_1.size(), lat_1.data(), lon_1.data(),
+                   lat_2.data(), lon_2.data(), kDemSpacing__meter,
+                   opt.n_threads, &profiles);
+    });
+    report("dem profiles (90 m spacing)", rate);
+  }
+  std::remove(kDemPath);
+}
+
+void bench_best_server(const Options &opt) {
+  GeoGrid grid;
+  const std::vector<double> z = synthetic_dem(&grid);
+  DemStore::create(kDemPath, grid);
+
+  {
+    const DemStore store(kDemPath);
+    const BestServerScenario scenario;
+    const std::size_t n = scenario.rx_lat.size();
+    BestServerResults results(n);
+    for (int prune = 1; prune >= 0; prune--) {
+      const BestServerInputs in = scenario.inputs(store, prune != 0);
+      const double rate = links_per_second(opt.seconds, n * in.n_tx, [&] {
+        results.run(in, opt.n_threads);
+      });
+      report(prune ? "best server (pruned)" : "best server (every link)",
+             rate);
+    }
+  }
+  std::remove(kDemPath);
+}
+
+void print_profile() {
+  static const char *const kStageNames[STAGE__COUNT] = {
+      "QuickPfl",         "LongleyRice", "DiffractionLoss",
+      "TroposcatterLoss", "Variability", "LongleyRiceBatch"};
+  std::printf("\nstage timings (inclusive)\n");
+  for (int s = 0; s < STAGE__COUNT; s++) {
+    long long calls;
+    double seconds;
+    GetStageCounters(s, &calls, &seconds);
+    std::printf("  %-18s %12lld calls %10.3f s %10.3f us/call\n",
+                kStageNames[s], calls, seconds,
+                calls ? seconds / calls * 1e6 : 0.0);
+  }
+  std::printf("propagation modes: line of sight %lld, diffraction %lld, "
+              "troposcatter %lld\n",
+              GetModeCount(MODE__LINE_OF_SIGHT),
+              GetModeCount(MODE__DIFFRACTION),
+              GetModeCount(MODE__TROPOSCATTER));
+}
+
+// ---------------------------------------------------------------------------
+
+int parse_simd(const char *name) {
+  if (!std::strcmp(name, "scalar"))
+    return SIMD__SCALAR;
+  if (!std::strcmp(name, "avx2"))
+    return SIMD__AVX2;
+  if (!std::strcmp(name, "avx512"))
+    return SIMD__AVX512;
+  std::fprintf(stderr, "unknown --simd level %s\n", name);
+  std::exit(2);
+}
+
+Options parse_options(int argc, char **argv) {
+  Options opt;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "--data-dir" && has_value)
+      opt.data_dir = argv[++i];
+    else if (arg == "--reference" && has_value)
+      opt.reference = argv[++i];
+    else if (arg == "--simd" && has_value)
+      opt.simd = parse_simd(argv[++i]);
+    else if (arg == "--threads" && has_value)
+      opt.n_threads = std::atoi(argv[++i]);
+    else if (arg == "--seconds" && has_value)
+      opt.seconds = std::atof(argv[++i]);
+    else if (arg == "--check-only")
+      opt.check_only = true;
+    else if (arg == "--profile")
+      opt.profile = true;
+    else if (arg == "--write-reference")
+      opt.write_reference = true;
+    else {
+      std::fprintf(stderr, "unknown argument %s\n", arg.c_str());
+      std::exit(2);
+    }
+  }
+  return opt;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const Options opt = parse_options(argc, argv);
+
+  if (opt.simd >= 0)
+    SetSimdLevel(opt.simd);
+  static const char *const kSimdNames[] = {"scalar", "avx2", "avx512"};
+  std::printf("terrain kernels: %s\n", kSimdNames[GetSimdLevel()]);
+
+  if (opt.write_reference)
+    return write_synthetic_reference(opt.reference);
+
+  const std::vector<P2PCase> p2p = load_p2p_cases(opt.data_dir);
+  const std::vector<AreaCase> area = load_area_cases(opt.data_dir);
+
+  std::vector<P2PCase> synthetic = synthetic_cases();
+  const std::vector<CsvRow> reference = read_csv(opt.reference, true);
+  if (reference.size() != synthetic.size()) {
+    std::fprintf(stderr, "%s has %zu rows, expected %zu\n",
+                 opt.reference.c_str(), reference.size(), synthetic.size());
+    return 2;
+  }
+  for (std::size_t i = 0; i < synthetic.size(); i++) {
+    synthetic[i].A__db = reference[i].number(2);
+    synthetic[i].tolerance__db = reference[i].rounding(2);
+  }
+
+  Checker checker;
+  check_p2p(checker, "p2p.csv", p2p, opt.n_threads);
+  check_area(checker, area);
+  check_p2p(checker, "synthetic", synthetic, opt.n_threads);
+
+  std::vector<P2PCase> all = p2p;
+  all.insert(all.end(), synthetic.begin(), synthetic.end());
+  check_sweep(checker, all);
+  check_lanes(checker, all);
+  check_cache(checker, all, opt.n_threads);
+  check_dem(checker, opt.n_threads);
+  check_radial(checker, opt.n_threads);
+  check_best_server(checker, opt.n_threads);
+  std::printf("regression: %d checks, %d drifted\n", checker.checks,
+              checker.failures);
+
+  if (!opt.check_only) {
+    if (opt.profile) {
+      ResetInstrumentation();
+      EnableInstrumentation(true);
+    }
+
+    std::printf("\nthroughput\n");
+    bench_p2p("p2p.csv", p2p, opt);
+    for (int n_points : kSyntheticSizes) {
+      std::vector<P2PCase> sized;
+      for (const P2PCase &c : synthetic)
+        if (int(c.pfl[0]) + 1 == n_points)
+          sized.push_back(c);
+      const std::string label = "synthetic " + std::to_string(n_points) + " pts";
+      bench_p2p(label.c_str(), sized, opt);
+    }
+    bench_lanes(all, opt);
+    bench_area(area, opt);
+    bench_dem(opt);
+    bench_best_server(opt);
+
+    if (opt.profile) {
+      EnableInstrumentation(false);
+      print_profile();
+    }
+  }
+
+  return checker.failures ? 1 : 0;
+}
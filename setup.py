@@ -8,13 +8,29 @@ radiokit_bindings_itm = Extension(
     "radiokit.bindings.itm_bindings",
     sources=[
         "src/radiokit/bindings/itm_bindings.cpp",
+        "src/radiokit/bindings/itm_batch.cpp",
+        "src/radiokit/bindings/itm_radial.cpp",
+        "src/radiokit/bindings/itm_sweep.cpp",
+        "src/radiokit/bindings/itm_area.cpp",
+        "src/radiokit/bindings/dem_store.cpp",
+        "src/radiokit/bindings/itm_best_server.cpp",
+        "src/radiokit/bindings/link_cache.cpp",
         *itm_sources,
     ],
     include_dirs=[
         "third_party/itm/include",
+        "src/radiokit/bindings",
         pybind11.get_include(),
     ],
-    extra_compile_args=["-fdeclspec", "-fms-extensions", "-std=c++11"],
+    extra_compile_args=[
+        "-fdeclspec",
+        "-fms-extensions",
+        "-std=c++11",
+        "-pthread",
+        # keep the SIMD terrain kernels bit-identical to their scalar fallback
+        "-ffp-contract=off",
+    ],
+    extra_link_args=["-pthread"],
     language="c++",
 )
 
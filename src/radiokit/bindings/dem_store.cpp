@@ -0,0 +1,360 @@
+#include "dem_store.h"
+#include "parallel.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char kDemMagic[8] = {'R', 'K', 'D', 'E', 'M', 0, 0, 0};
+
+// Links handed to a worker at a time when extracting a batch of profiles
+static const std::size_t kProfileChunk = 16;
+
+// Tiles a reader keeps hold of between store lookups. Four covers the corner
+// where a bilinear sample straddles tile boundaries in both directions.
+static const int kCursorTiles = 4;
+
+static std::size_t tile_bytes(int tile_size) {
+  return static_cast<std::size_t>(tile_size) * tile_size * sizeof(float);
+}
+
+// One tile mapped read-only from the store file; unmapped when the last
+// reader releases it
+class MappedTile {
+public:
+  MappedTile(const void *data, std::size_t bytes)
+      : data_(data), bytes_(bytes) {}
+
+  ~MappedTile() {
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+#else
+    munmap(const_cast<void *>(data_), bytes_);
+#endif
+  }
+
+  const float *samples() const { return static_cast<const float *>(data_); }
+
+private:
+  const void *data_;
+  std::size_t bytes_;
+};
+
+// Per-reader view of the store that remembers the last few tiles it touched,
+// so consecutive samples along a profile rarely take the store's lock
+class TileCursor {
+public:
+  explicit TileCursor(const DemStore &store) : store_(store), next_(0) {
+    for (int k = 0; k < kCursorTiles; k++)
+      index_[k] = std::numeric_limits<std::size_t>::max();
+  }
+
+  double operator()(std::size_t row, std::size_t col) {
+    const std::size_t ts = static_cast<std::size_t>(store_.tile_size_);
+    const std::size_t index = (row / ts) * store_.tiles_across_ + col / ts;
+
+    int k = 0;
+    while (k < kCursorTiles && index_[k] != index)
+      k++;
+    if (k == kCursorTiles) {
+      k = next_;
+      next_ = (next_ + 1) % kCursorTiles;
+      index_[k] = index;
+      tiles_[k] = store_.tile(index);
+    }
+
+    if (!tiles_[k])
+      return NAN;
+    return tiles_[k]->samples()[(row % ts) * ts + col % ts];
+  }
+
+private:
+  const DemStore &store_;
+  std::size_t index_[kCursorTiles];
+  std::shared_ptr<const MappedTile> tiles_[kCursorTiles];
+  int next_;
+};
+
+void DemStore::create(const std::string &path, const GeoGrid &grid,
+                      int tile_size) {
+  if (tile_size <= 0 || tile_size % kDemTileAlign != 0)
+    throw std::runtime_error("DEM tile size must be a positive multiple of " +
+                             std::to_string(kDemTileAlign));
+  if (grid.rows == 0 || grid.cols == 0)
+    throw std::runtime_error("DEM raster is empty");
+
+  // write next to the destination and rename, so an interrupted conversion
+  // never leaves a store that looks complete
+  const std::string partial = path + ".partial";
+  std::FILE *file = std::fopen(partial.c_str(), "wb");
+  if (!file)
+    throw std::runtime_error("cannot create DEM store " + partial);
+
+  std::vector<char> header(kDemHeaderBytes, 0);
+  DemFileHeader fields;
+  std::memset(&fields, 0, sizeof(fields));
+  std::memcpy(fields.magic, kDemMagic, sizeof(kDemMagic));
+  fields.version = kDemFormatVersion;
+  fields.tile_size = static_cast<std::uint32_t>(tile_size);
+  fields.rows = grid.rows;
+  fields.cols = grid.cols;
+  std::copy(grid.gt, grid.gt + 6, fields.gt);
+  std::memcpy(header.data(), &fields, sizeof(fields));
+  bool ok = std::fwrite(header.data(), 1, header.size(), file) == header.size();
+
+  const std::size_t ts = static_cast<std::size_t>(tile_size);
+  const std::size_t tiles_across = (grid.cols + ts - 1) / ts;
+  const std::size_t tiles_down = (grid.rows + ts - 1) / ts;
+
+  // one row of tiles at a time
+  std::vector<float> band(tiles_across * ts * ts);
+  for (std::size_t tr = 0; ok && tr < tiles_down; tr++) {
+    std::fill(band.begin(), band.end(), NAN);
+    for (std::size_t r = 0; r < ts; r++) {
+      const std::size_t row = tr * ts + r;
+      if (row >= grid.rows)
+        break;
+      const double *z = grid.z + row * grid.cols;
+      for (std::size_t col = 0; col < grid.cols; col++) {
+        const std::size_t tc = col / ts;
+        band[tc * ts * ts + r * ts + col % ts] =
+            z[col] == grid.nodata ? NAN : static_cast<float>(z[col]);
+      }
+    }
+    ok = std::fwrite(band.data(), sizeof(float), band.size(), file) ==
+         band.size();
+  }
+
+  ok = std::fclose(file) == 0 && ok;
+  // replace any existing store in one step, so readers see the old file or
+  // the new one
+#ifdef _WIN32
+  ok = ok && MoveFileExA(partial.c_str(), path.c_str(),
+                         MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+  ok = ok && std::rename(partial.c_str(), path.c_str()) == 0;
+#endif
+  if (!ok) {
+    std::remove(partial.c_str());
+    throw std::runtime_error("cannot write DEM store " + path);
+  }
+}
+
+DemStore::DemStore(const std::string &path, std::size_t max_tiles)
+    : max_tiles_(std::max<std::size_t>(max_tiles, 1)), stats_() {
+  DemFileHeader header;
+  std::uint64_t file_size;
+
+#ifdef _WIN32
+  file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file_ == INVALID_HANDLE_VALUE)
+    throw std::runtime_error("cannot open DEM store " + path);
+
+  DWORD read = 0;
+  LARGE_INTEGER size;
+  if (!ReadFile(file_, &header, sizeof(header), &read, NULL) ||
+      read != sizeof(header) || !GetFileSizeEx(file_, &size)) {
+    CloseHandle(file_);
+    throw std::runtime_error("cannot read DEM store " + path);
+  }
+  file_size = static_cast<std::uint64_t>(size.QuadPart);
+  mapping_ = NULL;
+#else
+  fd_ = open(path.c_str(), O_RDONLY);
+  if (fd_ < 0)
+    throw std::runtime_error("cannot open DEM store " + path);
+
+  struct stat st;
+  if (pread(fd_, &header, sizeof(header), 0) !=
+          static_cast<ssize_t>(sizeof(header)) ||
+      fstat(fd_, &st) != 0) {
+    close(fd_);
+    throw std::runtime_error("cannot read DEM store " + path);
+  }
+  file_size = static_cast<std::uint64_t>(st.st_size);
+#endif
+
+  const char *problem = nullptr;
+  if (std::memcmp(header.magic, kDemMagic, sizeof(kDemMagic)) != 0)
+    problem = " is not a DEM store";
+  else if (header.version != kDemFormatVersion)
+    problem = " has an unsupported format version";
+  else if (header.tile_size == 0 || header.tile_size % kDemTileAlign != 0 ||
+           header.rows == 0 || header.cols == 0)
+    problem = " has a corrupt header";
+
+  if (!problem) {
+    rows_ = static_cast<std::size_t>(header.rows);
+    cols_ = static_cast<std::size_t>(header.cols);
+    std::copy(header.gt, header.gt + 6, gt_);
+    tile_size_ = static_cast<int>(header.tile_size);
+    tiles_across_ = (cols_ + tile_size_ - 1) / tile_size_;
+    const std::size_t tiles_down = (rows_ + tile_size_ - 1) / tile_size_;
+    if (file_size <
+        kDemHeaderBytes + tiles_across_ * tiles_down * tile_bytes(tile_size_))
+      problem = " is truncated";
+  }
+
+#ifdef _WIN32
+  if (!problem) {
+    mapping_ = CreateFileMappingA(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping_)
+      problem = " cannot be mapped";
+  }
+  if (problem) {
+    CloseHandle(file_);
+    throw std::runtime_error("DEM store " + path + problem);
+  }
+#else
+  if (problem) {
+    close(fd_);
+    throw std::runtime_error("DEM store " + path + problem);
+  }
+#endif
+}
+
+DemStore::~DemStore() {
+  // mapped views stay valid after their file handles are closed
+#ifdef _WIN32
+  CloseHandle(mapping_);
+  CloseHandle(file_);
+#else
+  close(fd_);
+#endif
+}
+
+DemStoreStats DemStore::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  DemStoreStats result = stats_;
+  result.mapped = lru_.size();
+  return result;
+}
+
+std::shared_ptr<const MappedTile> DemStore::tile(std::size_t index) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  const auto found = index_.find(index);
+  if (found != index_.end()) {
+    stats_.hits++;
+    lru_.splice(lru_.begin(), lru_, found->second);
+    return found->second->second;
+  }
+  stats_.misses++;
+
+  const std::size_t bytes = tile_bytes(tile_size_);
+  const std::uint64_t offset =
+      kDemHeaderBytes + static_cast<std::uint64_t>(index) * bytes;
+#ifdef _WIN32
+  const void *data =
+      MapViewOfFile(mapping_, FILE_MAP_READ, DWORD(offset >> 32),
+                    DWORD(offset & 0xFFFFFFFF), bytes);
+  if (!data)
+    return nullptr;
+#else
+  void *data = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd_,
+                    static_cast<off_t>(offset));
+  if (data == MAP_FAILED)
+    return nullptr;
+#endif
+
+  std::shared_ptr<const MappedTile> tile =
+      std::make_shared<MappedTile>(data, bytes);
+  lru_.emplace_front(index, tile);
+  index_[index] = lru_.begin();
+
+  while (lru_.size() > max_tiles_) {
+    index_.erase(lru_.back().first);
+    lru_.pop_back();
+    stats_.evictions++;
+  }
+  return tile;
+}
+
+double DemStore::sample(double lat, double lon) const {
+  TileCursor cursor(*this);
+  return interpolate_bilinear(rows_, cols_, gt_, lat, lon, cursor);
+}
+
+bool DemStore::link_valid(double lat_1, double lon_1, double lat_2,
+                          double lon_2) {
+  return std::isfinite(lat_1) && std::isfinite(lon_1) &&
+         std::isfinite(lat_2) && std::isfinite(lon_2) &&
+         great_circle_distance(lat_1, lon_1, lat_2, lon_2) > 0;
+}
+
+std::size_t DemStore::profile_size(double lat_1, double lon_1, double lat_2,
+                                   double lon_2, double spacing__meter) {
+  if (!link_valid(lat_1, lon_1, lat_2, lon_2))
+    throw std::runtime_error(
+        "link endpoints must be finite and a positive distance apart");
+  const double d__meter = great_circle_distance(lat_1, lon_1, lat_2, lon_2);
+  const double np = std::max(std::ceil(d__meter / spacing__meter), 1.0);
+  return static_cast<std::size_t>(np) + 3;
+}
+
+std::size_t DemStore::profile(double lat_1, double lon_1, double lat_2,
+                              double lon_2, double spacing__meter,
+                              double *pfl) const {
+  const double d__meter = great_circle_distance(lat_1, lon_1, lat_2, lon_2);
+  const double bearing = initial_bearing(lat_1, lon_1, lat_2, lon_2);
+  const std::size_t np =
+      profile_size(lat_1, lon_1, lat_2, lon_2, spacing__meter) - 3;
+  const double xi = d__meter / np;
+
+  pfl[0] = static_cast<double>(np);
+  pfl[1] = xi;
+
+  TileCursor cursor(*this);
+  std::size_t missing = 0;
+  for (std::size_t i = 0; i <= np; i++) {
+    double lat, lon;
+    destination_point(lat_1, lon_1, bearing, i * xi, &lat, &lon);
+    const double z = interpolate_bilinear(rows_, cols_, gt_, lat, lon, cursor);
+    if (std::isnan(z))
+      missing++;
+    pfl[i + 2] = z;
+  }
+  return missing;
+}
+
+void dem_profiles(const DemStore &store, std::size_t n_links,
+                  const double *lat_1, const double *lon_1,
+                  const double *lat_2, const double *lon_2,
+                  double spacing__meter, int n_threads, DemProfiles *out) {
+  out->offsets.resize(n_links);
+  out->missing.assign(n_links, 0);
+
+  std::size_t size = 0;
+  for (std::size_t i = 0; i < n_links; i++) {
+    if (!DemStore::link_valid(lat_1[i], lon_1[i], lat_2[i], lon_2[i]))
+      throw std::runtime_error("endpoints of link " + std::to_string(i) +
+                               " must be finite and a positive distance "
+                               "apart");
+    out->offsets[i] = static_cast<std::int64_t>(size);
+    size += DemStore::profile_size(lat_1[i], lon_1[i], lat_2[i], lon_2[i],
+                                   spacing__meter);
+  }
+  out->pfl.resize(size);
+
+  parallel_for(n_links, n_threads, kProfileChunk,
+               [&](std::size_t begin, std::size_t end) {
+                 for (std::size_t i = begin; i < end; i++)
+                   out->missing[i] = static_cast<std::int64_t>(store.profile(
+                       lat_1[i], lon_1[i], lat_2[i], lon_2[i], spacing__meter,
+                       out->pfl.data() + out->offsets[i]));
+               });
+}
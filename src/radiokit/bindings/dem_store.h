@@ -0,0 +1,138 @@
+#pragma once
+
+#include "geo.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Tiled elevation file written once from a fetched DEM and then read through
+// memory-mapped tiles. The layout is
+//
+//   [0, kDemHeaderBytes)   DemFileHeader, zero padded
+//   tile t                 tile_size x tile_size little-endian float32
+//                          samples, row-major, at
+//                          kDemHeaderBytes + t * tile_size^2 * 4
+//
+// with tiles numbered row-major across the raster. Nodata samples and the
+// padding of edge tiles hold NaN. The header size and the tile size (a
+// multiple of kDemTileAlign) keep every tile on a mapping boundary on both
+// POSIX and Windows.
+const std::size_t kDemHeaderBytes = 65536;
+const int kDemTileAlign = 128;
+const int kDemDefaultTileSize = 256;
+const std::uint32_t kDemFormatVersion = 1;
+
+struct DemFileHeader {
+  char magic[8]; // "RKDEM\0\0\0"
+  std::uint32_t version;
+  std::uint32_t tile_size;
+  std::uint64_t rows;
+  std::uint64_t cols;
+  double gt[6];
+};
+
+// Tile usage since the store was opened
+struct DemStoreStats {
+  std::uint64_t hits;      // tile found in the mapped set
+  std::uint64_t misses;    // tile had to be mapped
+  std::uint64_t evictions; // mappings dropped to stay within max_tiles
+  std::size_t mapped;      // tiles currently mapped
+};
+
+class MappedTile;
+
+// Read-only tiled DEM. Up to max_tiles tiles stay mapped, the least recently
+// used being unmapped first; a tile that is still being read by another
+// thread stays valid until that thread lets go of it. All member functions
+// are safe to call from several threads at once. Errors opening or writing a
+// store throw std::runtime_error.
+class DemStore {
+public:
+  DemStore(const std::string &path, std::size_t max_tiles = 256);
+  ~DemStore();
+
+  DemStore(const DemStore &) = delete;
+  DemStore &operator=(const DemStore &) = delete;
+
+  // Write grid to path in the tiled format. The raster is read once, tile
+  // row by tile row; samples equal to grid.nodata are stored as NaN.
+  static void create(const std::string &path, const GeoGrid &grid,
+                     int tile_size = kDemDefaultTileSize);
+
+  std::size_t rows() const { return rows_; }
+  std::size_t cols() const { return cols_; }
+  const double *geotransform() const { return gt_; }
+  int tile_size() const { return tile_size_; }
+  DemStoreStats stats() const;
+
+  // Bilinear elevation between pixel centers, as sample_bilinear; NaN
+  // outside the raster or next to nodata
+  double sample(double lat, double lon) const;
+
+  // Terrain profile along the great circle from (lat_1, lon_1) to
+  // (lat_2, lon_2), sampled bilinearly at the largest spacing not above
+  // spacing__meter, in [np, xi, z_0, ..., z_np] layout. pfl must hold
+  // profile_size() values. Returns the number of samples that fell off the
+  // raster or on nodata; those samples are NaN.
+  std::size_t profile(double lat_1, double lon_1, double lat_2, double lon_2,
+                      double spacing__meter, double *pfl) const;
+
+  // Number of doubles profile() writes for the same endpoints and spacing.
+  // Both take only links for which link_valid() holds and throw
+  // std::runtime_error for any other.
+  static std::size_t profile_size(double lat_1, double lon_1, double lat_2,
+                                  double lon_2, double spacing__meter);
+
+  // Whether the endpoints are finite and a positive distance apart, so the
+  // link has a direction and a sample spacing
+  static bool link_valid(double lat_1, double lon_1, double lat_2,
+                         double lon_2);
+
+private:
+  friend class TileCursor;
+
+  std::shared_ptr<const MappedTile> tile(std::size_t index) const;
+
+  std::size_t rows_;
+  std::size_t cols_;
+  double gt_[6];
+  int tile_size_;
+  std::size_t tiles_across_;
+  std::size_t max_tiles_;
+
+#ifdef _WIN32
+  void *file_;
+  void *mapping_;
+#else
+  int fd_;
+#endif
+
+  // least recently used tile at the back
+  typedef std::list<std::pair<std::size_t, std::shared_ptr<const MappedTile>>>
+      TileList;
+  mutable std::mutex mutex_;
+  mutable TileList lru_;
+  mutable std::unordered_map<std::size_t, TileList::iterator> index_;
+  mutable DemStoreStats stats_;
+};
+
+// Profiles for a batch of links, concatenated for itm_p2p_batch: link i's
+// profile starts at pfl[offsets[i]] and runs from (lat_1[i], lon_1[i]) to
+// (lat_2[i], lon_2[i]). missing[i] counts its off-raster samples. Throws
+// std::runtime_error, before sampling anything, when a link is not
+// DemStore::link_valid().
+struct DemProfiles {
+  std::vector<double> pfl;
+  std::vector<std::int64_t> offsets;
+  std::vector<std::int64_t> missing;
+};
+
+void dem_profiles(const DemStore &store, std::size_t n_links,
+                  const double *lat_1, const double *lon_1,
+                  const double *lat_2, const double *lon_2,
+                  double spacing__meter, int n_threads, DemProfiles *out);
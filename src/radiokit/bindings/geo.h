@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+// Mean earth radius used for great-circle geometry, matching the terrain
+// helpers on the Python side
+const double kEarthRadius__meter = 6371e3;
+const double kDegToRad = 3.14159265358979323846 / 180.0;
+
+// Point reached by travelling d__meter from (lat, lon) along a great circle
+// with the given initial bearing. Angles are in degrees.
+inline void destination_point(double lat, double lon, double bearing,
+                              double d__meter, double *lat_out,
+                              double *lon_out) {
+  const double phi_1 = lat * kDegToRad;
+  const double lambda_1 = lon * kDegToRad;
+  const double theta = bearing * kDegToRad;
+  const double delta = d__meter / kEarthRadius__meter;
+
+  const double sin_phi_2 = std::sin(phi_1) * std::cos(delta) +
+                           std::cos(phi_1) * std::sin(delta) * std::cos(theta);
+  const double phi_2 = std::asin(sin_phi_2);
+  const double lambda_2 =
+      lambda_1 + std::atan2(std::sin(theta) * std::sin(delta) * std::cos(phi_1),
+                            std::cos(delta) - std::sin(phi_1) * sin_phi_2);
+
+  *lat_out = phi_2 / kDegToRad;
+  *lon_out = std::remainder(lambda_2 / kDegToRad, 360.0);
+}
+
+// Great-circle distance in meters between two points (haversine formula).
+// Angles are in degrees.
+inline double great_circle_distance(double lat_1, double lon_1, double lat_2,
+                                    double lon_2) {
+  const double phi_1 = lat_1 * kDegToRad;
+  const double phi_2 = lat_2 * kDegToRad;
+  const double sin_dphi = std::sin((phi_2 - phi_1) / 2);
+  const double sin_dlambda = std::sin((lon_2 - lon_1) * kDegToRad / 2);
+
+  const double a = sin_dphi * sin_dphi +
+                   std::cos(phi_1) * std::cos(phi_2) * sin_dlambda * sin_dlambda;
+  return 2 * kEarthRadius__meter * std::asin(std::min(std::sqrt(a), 1.0));
+}
+
+// Initial bearing in degrees of the great circle from point 1 to point 2
+inline double initial_bearing(double lat_1, double lon_1, double lat_2,
+                              double lon_2) {
+  const double phi_1 = lat_1 * kDegToRad;
+  const double phi_2 = lat_2 * kDegToRad;
+  const double dlambda = (lon_2 - lon_1) * kDegToRad;
+
+  const double y = std::sin(dlambda) * std::cos(phi_2);
+  const double x = std::cos(phi_1) * std::sin(phi_2) -
+                   std::sin(phi_1) * std::cos(phi_2) * std::cos(dlambda);
+  return std::atan2(y, x) / kDegToRad;
+}
+
+// Row-major elevation raster in geographic coordinates. The geotransform
+// follows the GDAL convention:
+//   lon = gt[0] + col * gt[1] + row * gt[2]
+//   lat = gt[3] + col * gt[4] + row * gt[5]
+// for the top-left corner of pixel (row, col).
+struct GeoGrid {
+  const double *z;
+  std::size_t rows;
+  std::size_t cols;
+  double gt[6];
+  double nodata;
+};
+
+// Bilinear interpolation at (lat, lon) between the pixel centers of a
+// rows x cols raster with geotransform gt, reading pixels through
+// pixel(row, col). Returns NaN outside the raster; a NaN pixel makes the
+// result NaN.
+template <typename Pixel>
+double interpolate_bilinear(std::size_t rows, std::size_t cols,
+                            const double gt[6], double lat, double lon,
+                            Pixel &&pixel) {
+  const double det = gt[1] * gt[5] - gt[2] * gt[4];
+  const double dx = lon - gt[0];
+  const double dy = lat - gt[3];
+
+  // fractional pixel coordinates, shifted so that integers are pixel centers
+  double col = (gt[5] * dx - gt[2] * dy) / det - 0.5;
+  double row = (gt[1] * dy - gt[4] * dx) / det - 0.5;
+
+  if (!(col >= -0.5 && col <= cols - 0.5 && row >= -0.5 &&
+        row <= rows - 0.5))
+    return NAN;
+
+  col = std::min(std::max(col, 0.0), double(cols - 1));
+  row = std::min(std::max(row, 0.0), double(rows - 1));
+
+  const std::size_t c_0 = static_cast<std::size_t>(col);
+  const std::size_t r_0 = static_cast<std::size_t>(row);
+  const std::size_t c_1 = std::min(c_0 + 1, cols - 1);
+  const std::size_t r_1 = std::min(r_0 + 1, rows - 1);
+  const double t_c = col - c_0;
+  const double t_r = row - r_0;
+
+  const double z_00 = pixel(r_0, c_0);
+  const double z_01 = pixel(r_0, c_1);
+  const double z_10 = pixel(r_1, c_0);
+  const double z_11 = pixel(r_1, c_1);
+
+  const double top = z_00 + (z_01 - z_00) * t_c;
+  const double bottom = z_10 + (z_11 - z_10) * t_c;
+  return top + (bottom - top) * t_r;
+}
+
+// Bilinear elevation at (lat, lon) between pixel centers. Returns NaN outside
+// the raster or when a contributing pixel holds the nodata value.
+inline double sample_bilinear(const GeoGrid &grid, double lat, double lon) {
+  return interpolate_bilinear(
+      grid.rows, grid.cols, grid.gt, lat, lon,
+      [&grid](std::size_t row, std::size_t col) {
+        const double z = grid.z[row * grid.cols + col];
+        return z == grid.nodata ? NAN : z;
+      });
+}
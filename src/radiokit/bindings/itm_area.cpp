@@ -0,0 +1,173 @@
+#include "itm_area.h"
+#include "Enums.h"
+#include "Errors.h"
+#include "Warnings.h"
+#include <cmath>
+
+static bool valid_site_criteria(int criteria) {
+  return criteria == SITING_CRITERIA__RANDOM ||
+         criteria == SITING_CRITERIA__CAREFUL ||
+         criteria == SITING_CRITERIA__VERY_CAREFUL;
+}
+
+void itm_area_distances(const AreaInputs &in, QuantileMode quantiles,
+                        std::size_t n, const double *d__km,
+                        const AreaDistanceOutputs &out,
+                        IntermediateValues *geometry) {
+  double time = in.time, location = in.location, situation = in.situation;
+  if (quantiles == QuantileMode::CR)
+    location = 50;
+
+  // everything ITM_AREA_TLS_Ex checks apart from the distance itself
+  long input_warnings = NO_WARNINGS;
+  int input_rtn = ValidateInputs(in.h_tx__meter, in.h_rx__meter, in.climate,
+                                 time, location, situation, in.N_0, in.f__mhz,
+                                 in.pol, in.epsilon, in.sigma, in.mdvar,
+                                 &input_warnings);
+  int area_rtn = SUCCESS;
+  if (in.delta_h__meter < 0)
+    area_rtn = ERROR__DELTA_H;
+  else if (!valid_site_criteria(in.tx_site_criteria))
+    area_rtn = ERROR__TX_SITING_CRITERIA;
+  else if (!valid_site_criteria(in.rx_site_criteria))
+    area_rtn = ERROR__RX_SITING_CRITERIA;
+
+  const int site_criteria[2] = {in.tx_site_criteria, in.rx_site_criteria};
+  const double h__meter[2] = {in.h_tx__meter, in.h_rx__meter};
+  double theta_hzn[2] = {NAN, NAN};
+  double d_hzn__meter[2] = {NAN, NAN};
+  double h_e__meter[2] = {NAN, NAN};
+  complex<double> Z_g;
+  double gamma_e, N_s = NAN;
+
+  ReferenceLines lines;
+  long line_warnings = NO_WARNINGS;
+  int line_rtn = SUCCESS;
+  bool have_los = false, have_tropo = false;
+
+  if (input_rtn == SUCCESS && area_rtn == SUCCESS) {
+    InitializePointToPoint(in.f__mhz, 0.0, in.N_0, in.pol, in.epsilon,
+                           in.sigma, &Z_g, &gamma_e, &N_s);
+    InitializeArea(site_criteria, gamma_e, in.delta_h__meter, h__meter,
+                   h_e__meter, d_hzn__meter, theta_hzn);
+    line_rtn = InitializeReferenceLines(
+        theta_hzn, in.f__mhz, Z_g, d_hzn__meter, h_e__meter, gamma_e, N_s,
+        in.delta_h__meter, h__meter, MODE__AREA, &lines, &line_warnings);
+  }
+
+  if (geometry) {
+    for (int t = 0; t < 2; t++) {
+      geometry->theta_hzn[t] = theta_hzn[t];
+      geometry->d_hzn__meter[t] = d_hzn__meter[t];
+      geometry->h_e__meter[t] = h_e__meter[t];
+    }
+    geometry->N_s = N_s;
+    geometry->delta_h__meter = in.delta_h__meter;
+    geometry->A_ref__db = NAN;
+    geometry->A_fs__db = NAN;
+    geometry->d__km = NAN;
+    geometry->mode = MODE__NOT_SET;
+  }
+
+  for (std::size_t i = 0; i < n; i++) {
+    double A__db = NAN, A_ref__db = NAN, A_fs__db = NAN;
+    int propmode = MODE__NOT_SET;
+    long warnings = input_warnings;
+
+    int rtn = input_rtn;
+    if (rtn == SUCCESS) {
+      if (d__km[i] <= 0)
+        rtn = ERROR__PATH_DISTANCE;
+      else if (area_rtn != SUCCESS)
+        rtn = area_rtn;
+      else if (line_rtn != SUCCESS)
+        rtn = line_rtn;
+    }
+
+    if (rtn == SUCCESS) {
+      const double d__meter = d__km[i] * 1000;
+
+      // the same branch LongleyRice takes, with each set of coefficients
+      // computed the first time a distance needs it
+      if (d__meter < lines.d_sML__meter) {
+        if (!have_los) {
+          LineOfSightCoefficients(h_e__meter, Z_g, in.delta_h__meter,
+                                  in.f__mhz, &lines);
+          have_los = true;
+        }
+      } else if (!have_tropo) {
+        TroposcatterCoefficients(theta_hzn, d_hzn__meter, h_e__meter, N_s,
+                                 in.f__mhz, &lines);
+        have_tropo = true;
+      }
+
+      warnings |= line_warnings;
+      A_ref__db = ReferenceAttenuation(&lines, d__meter, &warnings, &propmode);
+      A_fs__db = FreeSpaceLoss(d__meter, in.f__mhz);
+      A__db = A_fs__db + Variability(time, location, situation, h_e__meter,
+                                     in.delta_h__meter, in.f__mhz, d__meter,
+                                     A_ref__db, in.climate, in.mdvar,
+                                     &warnings);
+      rtn = warnings != NO_WARNINGS ? SUCCESS_WITH_WARNINGS : SUCCESS;
+    }
+
+    // report CR inputs under their own error codes, as ITM_AREA_CR_Ex does
+    if (quantiles == QuantileMode::CR) {
+      if (rtn == ERROR__INVALID_TIME)
+        rtn = ERROR__INVALID_RELIABILITY;
+      else if (rtn == ERROR__INVALID_SITUATION)
+        rtn = ERROR__INVALID_CONFIDENCE;
+    }
+
+    out.A__db[i] = A__db;
+    out.status[i] = rtn;
+    out.warnings[i] = warnings;
+    out.A_ref__db[i] = A_ref__db;
+    out.A_fs__db[i] = A_fs__db;
+    out.mode[i] = propmode;
+  }
+}
+
+AreaLossTable::AreaLossTable(const AreaInputs &in, QuantileMode quantiles,
+                             double d_min__km, double d_max__km,
+                             std::size_t n_samples)
+    : d__km_(n_samples), A__db_(n_samples), log_d_min_(std::log(d_min__km)),
+      inv_log_step_((n_samples - 1) /
+                    (std::log(d_max__km) - std::log(d_min__km))) {
+  for (std::size_t k = 0; k < n_samples; k++)
+    d__km_[k] = std::exp(log_d_min_ + k / inv_log_step_);
+  // pin the end points so the full requested range is covered
+  d__km_.front() = d_min__km;
+  d__km_.back() = d_max__km;
+
+  std::vector<std::int32_t> status(n_samples), mode(n_samples);
+  std::vector<std::int64_t> warnings(n_samples);
+  std::vector<double> A_ref__db(n_samples), A_fs__db(n_samples);
+  const AreaDistanceOutputs out = {A__db_.data(),    status.data(),
+                                   warnings.data(),  A_ref__db.data(),
+                                   A_fs__db.data(),  mode.data()};
+  itm_area_distances(in, quantiles, n_samples, d__km_.data(), out, nullptr);
+
+  for (std::size_t k = 0; k < n_samples; k++)
+    if (status[k] != SUCCESS && status[k] != SUCCESS_WITH_WARNINGS)
+      A__db_[k] = NAN;
+}
+
+double AreaLossTable::operator()(double d__km) const {
+  if (!(d__km >= d__km_.front() && d__km <= d__km_.back()))
+    return NAN;
+
+  const double t = (std::log(d__km) - log_d_min_) * inv_log_step_;
+  std::size_t k = t > 0 ? static_cast<std::size_t>(t) : 0;
+  if (k > A__db_.size() - 2)
+    k = A__db_.size() - 2;
+
+  const double w = t - k;
+  return A__db_[k] + w * (A__db_[k + 1] - A__db_[k]);
+}
+
+void AreaLossTable::evaluate(std::size_t n, const double *d__km,
+                             double *A__db) const {
+  for (std::size_t i = 0; i < n; i++)
+    A__db[i] = (*this)(d__km[i]);
+}
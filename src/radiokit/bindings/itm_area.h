@@ -0,0 +1,70 @@
+#pragma once
+
+#include "itm.h"
+#include "itm_batch.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Area mode inputs shared by every distance of a curve. In CR mode the
+// confidence is read from `situation` and the reliability from `time`, as in
+// the batched point-to-point inputs.
+struct AreaInputs {
+  double h_tx__meter;
+  double h_rx__meter;
+  int tx_site_criteria;
+  int rx_site_criteria;
+  double delta_h__meter;
+  int climate;
+  double N_0;
+  double f__mhz;
+  int pol;
+  double epsilon;
+  double sigma;
+  int mdvar;
+  double time;
+  double location;
+  double situation;
+};
+
+// Preallocated per-distance outputs
+struct AreaDistanceOutputs {
+  double *A__db;
+  std::int32_t *status;
+  std::int64_t *warnings;
+  double *A_ref__db;
+  double *A_fs__db;
+  std::int32_t *mode;
+};
+
+// Area mode loss at each of n distances. The effective terminal geometry and
+// the diffraction, line-of-sight and troposcatter lines are computed once;
+// only the reference attenuation, free space loss and Variability are
+// evaluated per distance. Each entry matches the corresponding
+// ITM_AREA_TLS_Ex / ITM_AREA_CR_Ex call exactly. geometry, if not null,
+// receives the distance-independent intermediate values.
+void itm_area_distances(const AreaInputs &in, QuantileMode quantiles,
+                        std::size_t n, const double *d__km,
+                        const AreaDistanceOutputs &out,
+                        IntermediateValues *geometry);
+
+// Area mode loss sampled at log-spaced distances over [d_min, d_max] and
+// linearly interpolated in log distance. Lookups outside the range, or next
+// to a sample where ITM reported an error, return NaN.
+class AreaLossTable {
+public:
+  AreaLossTable(const AreaInputs &in, QuantileMode quantiles,
+                double d_min__km, double d_max__km, std::size_t n_samples);
+
+  double operator()(double d__km) const;
+  void evaluate(std::size_t n, const double *d__km, double *A__db) const;
+
+  const std::vector<double> &d__km() const { return d__km_; }
+  const std::vector<double> &A__db() const { return A__db_; }
+
+private:
+  std::vector<double> d__km_;
+  std::vector<double> A__db_;
+  double log_d_min_;
+  double inv_log_step_;
+};
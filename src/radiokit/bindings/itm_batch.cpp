@@ -0,0 +1,365 @@
+#include "itm_batch.h"
+#include "Enums.h"
+#include "Errors.h"
+#include "Warnings.h"
+#include "link_cache.h"
+#include "parallel.h"
+
+#include <algorithm>
+
+// Links handed to a worker at a time; large enough to amortize the shared
+// counter, small enough to balance profiles of very different lengths
+static const std::size_t kBatchChunk = 64;
+
+void store_link_result(const P2PBatchOutputs &out, std::size_t i, int status,
+                       double A__db, long warnings,
+                       const IntermediateValues &values) {
+  out.A__db[i] = A__db;
+  out.status[i] = status;
+  out.warnings[i] = warnings;
+
+  for (int t = 0; t < 2; t++) {
+    out.theta_hzn[2 * i + t] = values.theta_hzn[t];
+    out.d_hzn__meter[2 * i + t] = values.d_hzn__meter[t];
+    out.h_e__meter[2 * i + t] = values.h_e__meter[t];
+  }
+  out.N_s[i] = values.N_s;
+  out.delta_h__meter[i] = values.delta_h__meter;
+  out.A_ref__db[i] = values.A_ref__db;
+  out.A_fs__db[i] = values.A_fs__db;
+  out.d__km[i] = values.d__km;
+  out.mode[i] = values.mode;
+}
+
+int itm_p2p_link(LinkCache *cache, QuantileMode quantiles, double h_tx__meter,
+                 double h_rx__meter, const double *pfl, int climate,
+                 double N_0, double f__mhz, int pol, double epsilon,
+                 double sigma, int mdvar, double time, double location,
+                 double situation, double *A__db, long *warnings,
+                 IntermediateValues *values) {
+  LinkKey key = {0, 0};
+  LinkResult result;
+  if (cache) {
+    key = cache->key(quantiles, false, h_tx__meter, h_rx__meter, pfl, climate,
+                     N_0, f__mhz, pol, epsilon, sigma, mdvar, time, location,
+                     situation);
+    if (cache->lookup(key, &result)) {
+      *A__db = result.A__db;
+      *warnings = result.warnings;
+      *values = result.values;
+      return result.status;
+    }
+  }
+
+  // ITM leaves the outputs untouched on early validation failures, so start
+  // every link from a defined state
+  result.A__db = NAN;
+  result.warnings = 0;
+  result.values = {{NAN, NAN}, {NAN, NAN}, {NAN, NAN}, NAN, NAN,
+                   NAN,        NAN,        NAN,        0};
+
+  if (quantiles == QuantileMode::CR)
+    result.status = ITM_P2P_CR_Ex(h_tx__meter, h_rx__meter, pfl, climate, N_0,
+                                  f__mhz, pol, epsilon, sigma, mdvar,
+                                  situation, time, &result.A__db,
+                                  &result.warnings, &result.values);
+  else
+    result.status = ITM_P2P_TLS_Ex(h_tx__meter, h_rx__meter, pfl, climate,
+                                   N_0, f__mhz, pol, epsilon, sigma, mdvar,
+                                   time, location, situation, &result.A__db,
+                                   &result.warnings, &result.values);
+
+  if (cache)
+    cache->insert(key, result);
+  *A__db = result.A__db;
+  *warnings = result.warnings;
+  *values = result.values;
+  return result.status;
+}
+
+static void run_link(const P2PBatchInputs &in, QuantileMode quantiles,
+                     std::size_t i, const P2PBatchOutputs &out) {
+  double A__db;
+  long warnings;
+  IntermediateValues values;
+  const int status = itm_p2p_link(
+      in.cache, quantiles, in.h_tx__meter[i], in.h_rx__meter[i],
+      batch_pfl(in, i), in.climate[i], in.N_0[i], in.f__mhz[i], in.pol[i],
+      in.epsilon[i], in.sigma[i], in.mdvar[i], in.time[i], in.location[i],
+      in.situation[i], &A__db, &warnings, &values);
+  store_link_result(out, i, status, A__db, warnings, values);
+}
+
+// Variability inputs of one link, as ITM_P2P_TLS_Ex takes them
+struct LinkQuantiles {
+  int climate;
+  int mdvar;
+  double time;
+  double location;
+  double situation;
+
+  bool operator==(const LinkQuantiles &o) const {
+    return climate == o.climate && mdvar == o.mdvar && time == o.time &&
+           location == o.location && situation == o.situation;
+  }
+
+  bool operator<(const LinkQuantiles &o) const {
+    if (climate != o.climate)
+      return climate < o.climate;
+    if (mdvar != o.mdvar)
+      return mdvar < o.mdvar;
+    if (time != o.time)
+      return time < o.time;
+    if (location != o.location)
+      return location < o.location;
+    return situation < o.situation;
+  }
+};
+
+static LinkQuantiles link_quantiles(const P2PBatchInputs &in,
+                                    QuantileMode quantiles, std::size_t i) {
+  // ITM_P2P_CR_Ex runs reliability as time and confidence as situation, at
+  // the median location
+  if (quantiles == QuantileMode::CR)
+    return LinkQuantiles{in.climate[i], in.mdvar[i], in.time[i], 50,
+                         in.situation[i]};
+  return LinkQuantiles{in.climate[i], in.mdvar[i], in.time[i],
+                       in.location[i], in.situation[i]};
+}
+
+// Path parameters of up to kBatchChunk links in the structure-of-arrays
+// layout LongleyRiceBatch reads, followed by its outputs
+struct LinkBlock {
+  double theta_hzn[2][kBatchChunk];
+  double d_hzn__meter[2][kBatchChunk];
+  double h_e__meter[2][kBatchChunk];
+  double h__meter[2][kBatchChunk];
+  double delta_h__meter[kBatchChunk];
+  double d__meter[kBatchChunk];
+  double Z_g_real[kBatchChunk];
+  double Z_g_imag[kBatchChunk];
+  double gamma_e[kBatchChunk];
+  double N_s[kBatchChunk];
+  double f__mhz[kBatchChunk];
+  LinkQuantiles quantiles[kBatchChunk];
+  std::size_t link[kBatchChunk]; // batch row of each entry
+  LinkKey key[kBatchChunk];      // when the batch has a cache
+
+  double A__db[kBatchChunk];
+  double A_ref__db[kBatchChunk];
+  double A_fs__db[kBatchChunk];
+  int mode[kBatchChunk];
+  long warnings[kBatchChunk];
+  int status[kBatchChunk];
+};
+
+// Reorder the first n entries of a block column so that entry k comes from
+// entry order[k]
+template <typename T>
+static void permute(T *values, const int order[], int n) {
+  T sorted[kBatchChunk];
+  for (int k = 0; k < n; k++)
+    sorted[k] = values[order[k]];
+  std::copy(sorted, sorted + n, values);
+}
+
+// Group the entries of a block that share their quantiles, so each group
+// takes one LongleyRiceBatch call
+static void sort_block(LinkBlock &b, int n) {
+  int order[kBatchChunk];
+  for (int k = 0; k < n; k++)
+    order[k] = k;
+  std::stable_sort(order, order + n, [&](int x, int y) {
+    return b.quantiles[x] < b.quantiles[y];
+  });
+
+  for (int t = 0; t < 2; t++) {
+    permute(b.theta_hzn[t], order, n);
+    permute(b.d_hzn__meter[t], order, n);
+    permute(b.h_e__meter[t], order, n);
+    permute(b.h__meter[t], order, n);
+  }
+  permute(b.delta_h__meter, order, n);
+  permute(b.d__meter, order, n);
+  permute(b.Z_g_real, order, n);
+  permute(b.Z_g_imag, order, n);
+  permute(b.gamma_e, order, n);
+  permute(b.N_s, order, n);
+  permute(b.f__mhz, order, n);
+  permute(b.quantiles, order, n);
+  permute(b.link, order, n);
+  permute(b.key, order, n);
+  permute(b.warnings, order, n);
+}
+
+// Evaluate entries [begin, end) of the block, which share their quantiles
+static void evaluate_block(LinkBlock &b, int begin, int end) {
+  LinkGeometry links;
+  for (int t = 0; t < 2; t++) {
+    links.theta_hzn[t] = b.theta_hzn[t] + begin;
+    links.d_hzn__meter[t] = b.d_hzn__meter[t] + begin;
+    links.h_e__meter[t] = b.h_e__meter[t] + begin;
+    links.h__meter[t] = b.h__meter[t] + begin;
+  }
+  links.delta_h__meter = b.delta_h__meter + begin;
+  links.d__meter = b.d__meter + begin;
+  links.Z_g_real = b.Z_g_real + begin;
+  links.Z_g_imag = b.Z_g_imag + begin;
+  links.gamma_e = b.gamma_e + begin;
+  links.N_s = b.N_s + begin;
+  links.f__mhz = b.f__mhz + begin;
+
+  const LinkLosses losses = {b.A__db + begin,    b.A_ref__db + begin,
+                             b.A_fs__db + begin, b.mode + begin,
+                             b.warnings + begin, b.status + begin};
+
+  const LinkQuantiles &q = b.quantiles[begin];
+  LongleyRiceBatch(end - begin, &links, MODE__P2P, q.time, q.location,
+                   q.situation, q.climate, q.mdvar, &losses);
+}
+
+// Result of a link that stopped before its losses were computed
+static LinkResult failed_link(int status, long warnings) {
+  const LinkResult result = {
+      status,
+      NAN,
+      warnings,
+      {{NAN, NAN}, {NAN, NAN}, {NAN, NAN}, NAN, NAN, NAN, NAN, NAN, 0}};
+  return result;
+}
+
+// Store one link's results in row i of the batch outputs, and under key in
+// the batch's cache when it has one
+static void finish_link(const P2PBatchInputs &in, std::size_t i,
+                        const LinkKey &key, const LinkResult &result,
+                        const P2PBatchOutputs &out) {
+  if (in.cache)
+    in.cache->insert(key, result);
+  store_link_result(out, i, result.status, result.A__db, result.warnings,
+                    result.values);
+}
+
+// Links [begin, end) of the batch, with the terrain analysis done link by
+// link and everything after it by LongleyRiceBatch. Rows come out as
+// run_link writes them.
+static void run_links_vectorized(const P2PBatchInputs &in,
+                                 QuantileMode quantiles, std::size_t begin,
+                                 std::size_t end, const P2PBatchOutputs &out) {
+  LinkBlock b;
+  for (std::size_t first = begin; first < end; first += kBatchChunk) {
+    const std::size_t last = std::min(first + kBatchChunk, end);
+
+    int n = 0;
+    for (std::size_t i = first; i < last; i++) {
+      const LinkQuantiles q = link_quantiles(in, quantiles, i);
+      const double h_tx__meter = in.h_tx__meter[i];
+      const double h_rx__meter = in.h_rx__meter[i];
+      const double f__mhz = in.f__mhz[i];
+
+      LinkKey key = {0, 0};
+      if (in.cache) {
+        key = in.cache->key(quantiles, true, h_tx__meter, h_rx__meter,
+                            batch_pfl(in, i), in.climate[i], in.N_0[i], f__mhz,
+                            in.pol[i], in.epsilon[i], in.sigma[i],
+                            in.mdvar[i], in.time[i], in.location[i],
+                            in.situation[i]);
+        LinkResult hit;
+        if (in.cache->lookup(key, &hit)) {
+          store_link_result(out, i, hit.status, hit.A__db, hit.warnings,
+                            hit.values);
+          continue;
+        }
+      }
+
+      complex<double> Z_g;
+      double gamma_e, N_s, theta_hzn[2], d_hzn__meter[2], h_e__meter[2];
+      double delta_h__meter, d__meter;
+      long warnings = NO_WARNINGS;
+      int status = InitializePointToPointPath(
+          h_tx__meter, h_rx__meter, batch_pfl(in, i), q.climate, in.N_0[i],
+          f__mhz, in.pol[i], in.epsilon[i], in.sigma[i], q.mdvar, q.time,
+          q.location, q.situation, &Z_g, &gamma_e, &N_s, theta_hzn,
+          d_hzn__meter, h_e__meter, &delta_h__meter, &d__meter, &warnings);
+      if (status != SUCCESS) {
+        if (quantiles == QuantileMode::CR && status == ERROR__INVALID_TIME)
+          status = ERROR__INVALID_RELIABILITY;
+        if (quantiles == QuantileMode::CR &&
+            status == ERROR__INVALID_SITUATION)
+          status = ERROR__INVALID_CONFIDENCE;
+
+        finish_link(in, i, key, failed_link(status, warnings), out);
+        continue;
+      }
+
+      for (int t = 0; t < 2; t++) {
+        b.theta_hzn[t][n] = theta_hzn[t];
+        b.d_hzn__meter[t][n] = d_hzn__meter[t];
+        b.h_e__meter[t][n] = h_e__meter[t];
+      }
+      b.h__meter[0][n] = h_tx__meter;
+      b.h__meter[1][n] = h_rx__meter;
+      b.delta_h__meter[n] = delta_h__meter;
+      b.d__meter[n] = d__meter;
+      b.Z_g_real[n] = Z_g.real();
+      b.Z_g_imag[n] = Z_g.imag();
+      b.gamma_e[n] = gamma_e;
+      b.N_s[n] = N_s;
+      b.f__mhz[n] = f__mhz;
+      b.quantiles[n] = q;
+      b.link[n] = i;
+      b.key[n] = key;
+      b.warnings[n] = warnings;
+      n++;
+    }
+
+    // LongleyRiceBatch takes one set of quantiles, so split the block into
+    // runs of links that share theirs
+    sort_block(b, n);
+    for (int k = 0; k < n;) {
+      int run_end = k + 1;
+      while (run_end < n && b.quantiles[run_end] == b.quantiles[k])
+        run_end++;
+      evaluate_block(b, k, run_end);
+      k = run_end;
+    }
+
+    for (int k = 0; k < n; k++) {
+      const std::size_t i = b.link[k];
+      const double *pfl = batch_pfl(in, i);
+
+      LinkResult result = failed_link(b.status[k], b.warnings[k]);
+      IntermediateValues &values = result.values;
+      values.d__km = (pfl[0] * pfl[1]) / 1000;
+      if (b.status[k] != SUCCESS && b.status[k] != SUCCESS_WITH_WARNINGS) {
+        finish_link(in, i, b.key[k], result, out);
+        continue;
+      }
+
+      for (int t = 0; t < 2; t++) {
+        values.theta_hzn[t] = b.theta_hzn[t][k];
+        values.d_hzn__meter[t] = b.d_hzn__meter[t][k];
+        values.h_e__meter[t] = b.h_e__meter[t][k];
+      }
+      values.N_s = b.N_s[k];
+      values.delta_h__meter = b.delta_h__meter[k];
+      values.A_ref__db = b.A_ref__db[k];
+      values.A_fs__db = b.A_fs__db[k];
+      values.mode = b.mode[k];
+      result.A__db = b.A__db[k];
+      finish_link(in, i, b.key[k], result, out);
+    }
+  }
+}
+
+void itm_p2p_batch(const P2PBatchInputs &in, QuantileMode quantiles,
+                   int n_threads, const P2PBatchOutputs &out) {
+  parallel_for(in.n_links, n_threads, kBatchChunk,
+               [&](std::size_t begin, std::size_t end) {
+                 if (in.vectorized) {
+                   run_links_vectorized(in, quantiles, begin, end, out);
+                   return;
+                 }
+                 for (std::size_t i = begin; i < end; i++)
+                   run_link(in, quantiles, i, out);
+               });
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "itm.h"
+#include <cstddef>
+#include <cstdint>
+
+class LinkCache;
+
+// Strided read-only view over one per-link input column. A stride of zero
+// broadcasts a single value to every link.
+template <typename T> struct Column {
+  const T *data;
+  std::ptrdiff_t stride;
+
+  T operator[](std::size_t i) const {
+    return data[static_cast<std::ptrdiff_t>(i) * stride];
+  }
+};
+
+// How the three variability inputs of a batch are interpreted
+enum class QuantileMode {
+  TLS, // time, location, situation
+  CR   // confidence (in `situation`), reliability (in `time`)
+};
+
+// Inputs to a batched point-to-point run. Link i reads its profile from
+// pfl + offsets[i], or from pfl + i * pfl_stride when offsets is null. Each
+// profile is in the usual [np, xi, z_0, ..., z_np] layout.
+struct P2PBatchInputs {
+  std::size_t n_links;
+  const double *pfl;
+  const std::int64_t *offsets;
+  std::size_t pfl_stride;
+
+  Column<double> h_tx__meter;
+  Column<double> h_rx__meter;
+  Column<int> climate;
+  Column<double> N_0;
+  Column<double> f__mhz;
+  Column<int> pol;
+  Column<double> epsilon;
+  Column<double> sigma;
+  Column<int> mdvar;
+  Column<double> time;
+  Column<double> location;
+  Column<double> situation;
+
+  // evaluate the links after their terrain analysis with LongleyRiceBatch,
+  // several per SIMD register; losses then match the single-link functions
+  // to within rounding rather than exactly
+  bool vectorized;
+
+  // links found here skip ITM entirely, and the others are added to it; may
+  // be null
+  LinkCache *cache;
+};
+
+// Preallocated per-link outputs. The two-element terminal values are stored
+// row-major as [n_links][2].
+struct P2PBatchOutputs {
+  double *A__db;
+  std::int32_t *status;
+  std::int64_t *warnings;
+
+  double *theta_hzn;
+  double *d_hzn__meter;
+  double *h_e__meter;
+  double *N_s;
+  double *delta_h__meter;
+  double *A_ref__db;
+  double *A_fs__db;
+  double *d__km;
+  std::int32_t *mode;
+};
+
+// Start of link i's profile within the batch input buffer
+inline const double *batch_pfl(const P2PBatchInputs &in, std::size_t i) {
+  return in.offsets ? in.pfl + in.offsets[i] : in.pfl + i * in.pfl_stride;
+}
+
+// Store one link's results in row i of the batch outputs
+void store_link_result(const P2PBatchOutputs &out, std::size_t i, int status,
+                       double A__db, long warnings,
+                       const IntermediateValues &values);
+
+// ITM_P2P_TLS_Ex, or ITM_P2P_CR_Ex with reliability in time and confidence
+// in situation, for one link. When cache is not null the result comes from
+// it if it holds the link and is added to it otherwise. Outputs are NaN on
+// early validation failures, as in batch rows.
+int itm_p2p_link(LinkCache *cache, QuantileMode quantiles, double h_tx__meter,
+                 double h_rx__meter, const double *pfl, int climate,
+                 double N_0, double f__mhz, int pol, double epsilon,
+                 double sigma, int mdvar, double time, double location,
+                 double situation, double *A__db, long *warnings,
+                 IntermediateValues *values);
+
+// Run ITM_P2P_TLS_Ex (or ITM_P2P_CR_Ex) for every link in the batch on up to
+// n_threads workers, or their vectorized equivalent when in.vectorized is
+// set. Does not touch the Python interpreter, so callers may release the GIL
+// around it.
+void itm_p2p_batch(const P2PBatchInputs &in, QuantileMode quantiles,
+                   int n_threads, const P2PBatchOutputs &out);
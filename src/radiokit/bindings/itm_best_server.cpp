@@ -0,0 +1,160 @@
+#include "itm_best_server.h"
+#include "Errors.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace {
+
+// Receivers handed to a worker at a time
+const std::size_t kBestServerChunk = 8;
+
+// Allowance for rounding between the loss bound and the full calculation
+const double kBoundSlack__db = 1e-6;
+
+struct Candidate {
+  double bound__dbm; // highest power the transmitter could deliver
+  std::size_t tx;
+};
+
+// Highest power first; ties in transmitter order
+bool stronger(const Candidate &a, const Candidate &b) {
+  return a.bound__dbm > b.bound__dbm ||
+         (a.bound__dbm == b.bound__dbm && a.tx < b.tx);
+}
+
+struct Server {
+  std::int32_t tx;
+  double power__dbm;
+};
+
+// Whether a beats b, breaking ties in favour of the lower transmitter index
+bool beats(const Server &a, const Server &b) {
+  return b.tx < 0 || a.power__dbm > b.power__dbm ||
+         (a.power__dbm == b.power__dbm && a.tx < b.tx);
+}
+
+struct Worker {
+  std::vector<Candidate> candidates;
+  std::vector<double> pfl;
+  BestServerCounters counters;
+};
+
+// Received power from transmitter tx at receiver rx, or NaN when the link
+// cannot be evaluated
+double received_power(const BestServerInputs &in, std::size_t tx,
+                      std::size_t rx, Worker &w) {
+  const double lat_1 = in.tx_lat[tx], lon_1 = in.tx_lon[tx];
+  const double lat_2 = in.rx_lat[rx], lon_2 = in.rx_lon[rx];
+  if (!DemStore::link_valid(lat_1, lon_1, lat_2, lon_2))
+    return NAN;
+
+  w.pfl.resize(
+      DemStore::profile_size(lat_1, lon_1, lat_2, lon_2, in.spacing__meter));
+  if (in.store->profile(lat_1, lon_1, lat_2, lon_2, in.spacing__meter,
+                        w.pfl.data()) != 0)
+    return NAN;
+
+  double A__db;
+  long warnings;
+  IntermediateValues values;
+  const int status =
+      ITM_P2P_TLS_Ex(in.h_tx__meter[tx], in.h_rx__meter[rx], w.pfl.data(),
+                     in.climate, in.N_0, in.f__mhz[tx], in.pol, in.epsilon,
+                     in.sigma, in.mdvar, in.time, in.location, in.situation,
+                     &A__db, &warnings, &values);
+  if (status != SUCCESS && status != SUCCESS_WITH_WARNINGS)
+    return NAN;
+  return in.eirp__dbm[tx] - A__db;
+}
+
+void serve_receiver(const BestServerInputs &in, std::size_t rx, Worker &w,
+                    const BestServerOutputs &out) {
+  w.candidates.clear();
+  w.counters.links += in.n_tx;
+
+  for (std::size_t tx = 0; tx < in.n_tx; tx++) {
+    double bound__dbm = INFINITY;
+    if (in.prune) {
+      const double d__meter = great_circle_distance(
+          in.tx_lat[tx], in.tx_lon[tx], in.rx_lat[rx], in.rx_lon[rx]);
+      const double A_min__db =
+          FreeSpaceLoss(d__meter, in.f__mhz[tx]) +
+          VariabilityLowerBound(in.time, in.location, in.situation,
+                                in.f__mhz[tx], d__meter, in.climate,
+                                in.mdvar);
+      bound__dbm = in.eirp__dbm[tx] - A_min__db + kBoundSlack__db;
+      if (bound__dbm < in.threshold__dbm) {
+        w.counters.below_threshold++;
+        continue;
+      }
+    }
+    w.candidates.push_back(Candidate{bound__dbm, tx});
+  }
+  std::sort(w.candidates.begin(), w.candidates.end(), stronger);
+
+  Server best = {-1, NAN};
+  Server second = {-1, NAN};
+  for (std::size_t k = 0; k < w.candidates.size(); k++) {
+    const Candidate &c = w.candidates[k];
+    if (second.tx >= 0 && c.bound__dbm < second.power__dbm) {
+      w.counters.outranked += w.candidates.size() - k;
+      break;
+    }
+
+    w.counters.evaluated++;
+    const double power__dbm = received_power(in, c.tx, rx, w);
+    if (std::isnan(power__dbm)) {
+      w.counters.failed++;
+      continue;
+    }
+    if (power__dbm < in.threshold__dbm)
+      continue;
+
+    const Server s = {static_cast<std::int32_t>(c.tx), power__dbm};
+    if (beats(s, best)) {
+      second = best;
+      best = s;
+    } else if (beats(s, second)) {
+      second = s;
+    }
+  }
+
+  out.best[rx] = best.tx;
+  out.best__dbm[rx] = best.power__dbm;
+  out.margin__db[rx] = best.power__dbm - in.threshold__dbm;
+  out.second[rx] = second.tx;
+  out.second__dbm[rx] = second.power__dbm;
+}
+
+} // namespace
+
+void itm_best_server(const BestServerInputs &in, int n_threads,
+                     const BestServerOutputs &out,
+                     BestServerCounters *counters) {
+  std::atomic<std::uint64_t> links(0), below_threshold(0), outranked(0),
+      evaluated(0), failed(0);
+
+  parallel_for(in.n_rx, n_threads, kBestServerChunk,
+               [&](std::size_t begin, std::size_t end) {
+                 Worker w;
+                 w.counters = BestServerCounters();
+                 w.candidates.reserve(in.n_tx);
+                 for (std::size_t rx = begin; rx < end; rx++)
+                   serve_receiver(in, rx, w, out);
+
+                 links += w.counters.links;
+                 below_threshold += w.counters.below_threshold;
+                 outranked += w.counters.outranked;
+                 evaluated += w.counters.evaluated;
+                 failed += w.counters.failed;
+               });
+
+  counters->links = links;
+  counters->below_threshold = below_threshold;
+  counters->outranked = outranked;
+  counters->evaluated = evaluated;
+  counters->failed = failed;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "dem_store.h"
+#include "itm_batch.h"
+#include <cstdint>
+
+// Transmitter sites competing to serve a set of receivers, with terrain read
+// from a DEM store. Profiles run from each transmitter to each receiver along
+// the great circle, sampled every spacing__meter (or slightly less).
+struct BestServerInputs {
+  const DemStore *store;
+  double spacing__meter;
+
+  std::size_t n_tx;
+  const double *tx_lat;
+  const double *tx_lon;
+  Column<double> h_tx__meter;
+  Column<double> eirp__dbm;
+  Column<double> f__mhz;
+
+  std::size_t n_rx;
+  const double *rx_lat;
+  const double *rx_lon;
+  Column<double> h_rx__meter;
+
+  // receiver sensitivity; a transmitter serves a receiver only when its
+  // received power reaches this
+  double threshold__dbm;
+
+  int climate;
+  double N_0;
+  int pol;
+  double epsilon;
+  double sigma;
+  int mdvar;
+  double time;
+  double location;
+  double situation;
+
+  // skip links whose loss bound rules them out; false runs every link, e.g.
+  // to check the pruned results
+  bool prune;
+};
+
+// Preallocated per-receiver outputs. Servers are transmitter indices, -1
+// where fewer than one (best) or two (second) transmitters reach the
+// threshold; their powers and the margin are then NaN.
+struct BestServerOutputs {
+  std::int32_t *best;
+  double *best__dbm;
+  double *margin__db; // best__dbm - threshold__dbm
+  std::int32_t *second;
+  double *second__dbm;
+};
+
+// What happened to the n_tx * n_rx candidate links
+struct BestServerCounters {
+  std::uint64_t links;
+  std::uint64_t below_threshold; // pruned: bound cannot reach the threshold
+  std::uint64_t outranked;       // pruned: bound below the second best server
+  std::uint64_t evaluated;       // full ITM runs
+  std::uint64_t failed;          // evaluated, but off the DEM or ITM error
+};
+
+// Best and second-best server for every receiver. Each link first gets a
+// lower bound on its loss from FreeSpaceLoss and VariabilityLowerBound,
+// which needs no terrain. Links that cannot reach the threshold are dropped,
+// the rest are evaluated in order of decreasing bound, and evaluation stops
+// once no remaining bound can beat the second-best server found so far.
+// Results are identical to evaluating every link.
+void itm_best_server(const BestServerInputs &in, int n_threads,
+                     const BestServerOutputs &out,
+                     BestServerCounters *counters);
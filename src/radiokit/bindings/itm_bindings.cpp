@@ -1,4 +1,14 @@
+#include "Enums.h"
+#include "dem_store.h"
 #include "itm.h"
+#include "itm_area.h"
+#include "itm_batch.h"
+#include "itm_best_server.h"
+#include "itm_radial.h"
+#include "itm_sweep.h"
+#include "link_cache.h"
+#include <cmath>
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
@@ -66,6 +76,425 @@ py::dict wrap_intermediate_values(const IntermediateValues &values) {
   return result;
 }
 
+// Contiguous NumPy input, converting dtype and layout only when needed
+template <typename T>
+using ndarray_in = py::array_t<T, py::array::c_style | py::array::forcecast>;
+
+// View a per-link parameter that is either a scalar or one value per link.
+// Only a scalar or a 1-D array of one value is broadcast.
+template <typename T>
+Column<T> as_column(const ndarray_in<T> &values, std::size_t n_links,
+                    const char *name) {
+  if (values.size() == 1 && values.ndim() <= 1)
+    return Column<T>{values.data(), 0};
+  if (values.ndim() != 1 || static_cast<std::size_t>(values.size()) != n_links)
+    throw py::value_error(std::string(name) +
+                          " must be a scalar or have one value per link");
+  return Column<T>{values.data(), 1};
+}
+
+// Check that a profile header holds a whole number of intervals np >= 1 and
+// that the profile fits inside the buffer it was read from
+bool pfl_fits(const double *pfl, std::size_t available) {
+  return available >= 3 && pfl[0] >= 1 && pfl[0] == std::floor(pfl[0]) &&
+         pfl[0] + 3 <= static_cast<double>(available);
+}
+
+void check_batch_pfl(const double *pfl, std::size_t available,
+                     std::size_t link) {
+  if (!pfl_fits(pfl, available))
+    throw py::value_error("pfl for link " + std::to_string(link) +
+                          " must start with a whole number of intervals np >= "
+                          "1 and fit in its row of the profile buffer");
+}
+
+// Shared body of the batched point-to-point entry points. Profiles are either
+// a 2-D array with one padded pfl per row, or a flat buffer of concatenated
+// pfls with the start offset of each link.
+py::tuple run_p2p_batch(QuantileMode quantiles, const ndarray_in<double> &h_tx,
+                        const ndarray_in<double> &h_rx,
+                        const ndarray_in<double> &pfl,
+                        const ndarray_in<int> &climate,
+                        const ndarray_in<double> &N_0,
+                        const ndarray_in<double> &f_mhz,
+                        const ndarray_in<int> &pol,
+                        const ndarray_in<double> &epsilon,
+                        const ndarray_in<double> &sigma,
+                        const ndarray_in<int> &mdvar,
+                        const ndarray_in<double> &time,
+                        const ndarray_in<double> &location,
+                        const ndarray_in<double> &situation,
+                        const py::object &offsets, int n_threads,
+                        bool vectorized, LinkCache *cache) {
+  P2PBatchInputs in;
+  in.pfl = pfl.data();
+  in.offsets = nullptr;
+  in.pfl_stride = 0;
+
+  ndarray_in<std::int64_t> pfl_offsets;
+  if (offsets.is_none()) {
+    if (pfl.ndim() != 2)
+      throw py::value_error(
+          "pfl must be a 2-D array with one profile per row, or a 1-D "
+          "buffer of concatenated profiles together with offsets");
+    in.n_links = static_cast<std::size_t>(pfl.shape(0));
+    in.pfl_stride = static_cast<std::size_t>(pfl.shape(1));
+    for (std::size_t i = 0; i < in.n_links; i++)
+      check_batch_pfl(batch_pfl(in, i), in.pfl_stride, i);
+  } else {
+    pfl_offsets = offsets.cast<ndarray_in<std::int64_t>>();
+    if (pfl.ndim() != 1 || pfl_offsets.ndim() != 1)
+      throw py::value_error("ragged profiles need a 1-D pfl buffer and 1-D "
+                            "offsets");
+    in.n_links = static_cast<std::size_t>(pfl_offsets.size());
+    in.offsets = pfl_offsets.data();
+    const std::int64_t size = pfl.size();
+    for (std::size_t i = 0; i < in.n_links; i++) {
+      if (in.offsets[i] < 0 || in.offsets[i] >= size)
+        throw py::value_error("offset for link " + std::to_string(i) +
+                              " is outside the pfl buffer");
+      check_batch_pfl(batch_pfl(in, i),
+                      static_cast<std::size_t>(size - in.offsets[i]), i);
+    }
+  }
+
+  const std::size_t n = in.n_links;
+  in.h_tx__meter = as_column(h_tx, n, "h_tx");
+  in.h_rx__meter = as_column(h_rx, n, "h_rx");
+  in.climate = as_column(climate, n, "climate");
+  in.N_0 = as_column(N_0, n, "N_0");
+  in.f__mhz = as_column(f_mhz, n, "f_mhz");
+  in.pol = as_column(pol, n, "pol");
+  in.epsilon = as_column(epsilon, n, "epsilon");
+  in.sigma = as_column(sigma, n, "sigma");
+  in.mdvar = as_column(mdvar, n, "mdvar");
+  in.time = as_column(time, n, quantiles == QuantileMode::CR ? "reliability"
+                                                               : "time");
+  in.location = as_column(location, n, "location");
+  in.situation = as_column(situation, n, quantiles == QuantileMode::CR
+                                             ? "confidence"
+                                             : "situation");
+  in.vectorized = vectorized;
+  in.cache = cache;
+
+  const py::ssize_t rows = static_cast<py::ssize_t>(n);
+  py::array_t<double> A_db(rows);
+  py::array_t<std::int32_t> status(rows);
+  py::array_t<std::int64_t> warnings(rows);
+  py::array_t<double> theta_hzn({rows, py::ssize_t(2)});
+  py::array_t<double> d_hzn({rows, py::ssize_t(2)});
+  py::array_t<double> h_e({rows, py::ssize_t(2)});
+  py::array_t<double> N_s(rows);
+  py::array_t<double> delta_h(rows);
+  py::array_t<double> A_ref(rows);
+  py::array_t<double> A_fs(rows);
+  py::array_t<double> d_km(rows);
+  py::array_t<std::int32_t> mode(rows);
+
+  P2PBatchOutputs out;
+  out.A__db = A_db.mutable_data();
+  out.status = status.mutable_data();
+  out.warnings = warnings.mutable_data();
+  out.theta_hzn = theta_hzn.mutable_data();
+  out.d_hzn__meter = d_hzn.mutable_data();
+  out.h_e__meter = h_e.mutable_data();
+  out.N_s = N_s.mutable_data();
+  out.delta_h__meter = delta_h.mutable_data();
+  out.A_ref__db = A_ref.mutable_data();
+  out.A_fs__db = A_fs.mutable_data();
+  out.d__km = d_km.mutable_data();
+  out.mode = mode.mutable_data();
+
+  {
+    py::gil_scoped_release release;
+    itm_p2p_batch(in, quantiles, n_threads, out);
+  }
+
+  py::dict values;
+  values["theta_hzn"] = theta_hzn;
+  values["d_hzn__meter"] = d_hzn;
+  values["h_e__meter"] = h_e;
+  values["N_s"] = N_s;
+  values["delta_h__meter"] = delta_h;
+  values["A_ref__db"] = A_ref;
+  values["A_fs__db"] = A_fs;
+  values["d__km"] = d_km;
+  values["mode"] = mode;
+
+  return py::make_tuple(status, A_db, warnings, values);
+}
+
+// Shared body of the frequency and quantile sweeps over one profile
+py::tuple run_p2p_sweep(QuantileMode quantiles, double h_tx, double h_rx,
+                        const ndarray_in<double> &pfl, int climate, double N_0,
+                        const ndarray_in<double> &f_mhz, int pol,
+                        double epsilon, double sigma, int mdvar,
+                        const ndarray_in<double> &quantile_rows) {
+  const py::ssize_t width = quantiles == QuantileMode::CR ? 2 : 3;
+  if (pfl.ndim() != 1 ||
+      !pfl_fits(pfl.data(), static_cast<std::size_t>(pfl.size())))
+    throw py::value_error("pfl must be a 1-D profile in [np, xi, z_0..z_np] "
+                          "layout");
+  if (f_mhz.ndim() != 1 || f_mhz.size() == 0)
+    throw py::value_error("f_mhz must be a non-empty 1-D array");
+  if (quantile_rows.ndim() != 2 || quantile_rows.shape(1) != width ||
+      quantile_rows.shape(0) == 0)
+    throw py::value_error(
+        quantiles == QuantileMode::CR
+            ? "quantiles must be an array of (confidence, reliability) rows"
+            : "quantiles must be an array of (time, location, situation) "
+              "rows");
+
+  P2PSweepInputs in;
+  in.pfl = pfl.data();
+  in.h_tx__meter = h_tx;
+  in.h_rx__meter = h_rx;
+  in.climate = climate;
+  in.N_0 = N_0;
+  in.pol = pol;
+  in.epsilon = epsilon;
+  in.sigma = sigma;
+  in.mdvar = mdvar;
+  in.n_freqs = static_cast<std::size_t>(f_mhz.size());
+  in.f__mhz = f_mhz.data();
+  in.n_quantiles = static_cast<std::size_t>(quantile_rows.shape(0));
+  in.quantiles = quantile_rows.data();
+
+  const py::ssize_t n_freqs = f_mhz.size();
+  const std::vector<py::ssize_t> shape = {n_freqs, quantile_rows.shape(0)};
+  py::array_t<double> A_db(shape);
+  py::array_t<std::int32_t> status(shape);
+  py::array_t<std::int64_t> warnings(shape);
+  py::array_t<double> A_ref(n_freqs);
+  py::array_t<double> A_fs(n_freqs);
+  py::array_t<std::int32_t> mode(n_freqs);
+  IntermediateValues geometry;
+
+  P2PSweepOutputs out;
+  out.A__db = A_db.mutable_data();
+  out.status = status.mutable_data();
+  out.warnings = warnings.mutable_data();
+  out.A_ref__db = A_ref.mutable_data();
+  out.A_fs__db = A_fs.mutable_data();
+  out.mode = mode.mutable_data();
+  out.geometry = &geometry;
+
+  {
+    py::gil_scoped_release release;
+    itm_p2p_sweep(in, quantiles, out);
+  }
+
+  // geometry is shared by every cell; the frequency-dependent values are
+  // arrays with one entry per frequency
+  py::dict values = wrap_intermediate_values(geometry);
+  values["A_ref__db"] = A_ref;
+  values["A_fs__db"] = A_fs;
+  values["mode"] = mode;
+
+  return py::make_tuple(status, A_db, warnings, values);
+}
+
+// Hand a vector's buffer to NumPy without copying it
+template <typename T> py::array_t<T> release_to_array(std::vector<T> &values) {
+  std::vector<T> *owner = new std::vector<T>(std::move(values));
+  py::capsule free_owner(
+      owner, [](void *p) { delete static_cast<std::vector<T> *>(p); });
+  return py::array_t<T>(owner->size(), owner->data(), free_owner);
+}
+
+// Profiles along a batch of great-circle links, laid out for the ragged
+// form of the batched entry points
+py::tuple dem_store_profiles(const DemStore &store,
+                             const ndarray_in<double> &lat_1,
+                             const ndarray_in<double> &lon_1,
+                             const ndarray_in<double> &lat_2,
+                             const ndarray_in<double> &lon_2,
+                             double spacing_m, int n_threads) {
+  const py::ssize_t n = lat_1.size();
+  if (lat_1.ndim() != 1 || lon_1.ndim() != 1 || lat_2.ndim() != 1 ||
+      lon_2.ndim() != 1 || lon_1.size() != n || lat_2.size() != n ||
+      lon_2.size() != n)
+    throw py::value_error("link endpoints must be 1-D arrays of equal length");
+  if (!(spacing_m > 0))
+    throw py::value_error("spacing_m must be positive");
+  for (py::ssize_t i = 0; i < n; i++)
+    if (!DemStore::link_valid(lat_1.data()[i], lon_1.data()[i],
+                              lat_2.data()[i], lon_2.data()[i]))
+      throw py::value_error("endpoints of link " + std::to_string(i) +
+                            " must be finite and a positive distance apart");
+
+  DemProfiles profiles;
+  {
+    py::gil_scoped_release release;
+    dem_profiles(store, static_cast<std::size_t>(n), lat_1.data(),
+                 lon_1.data(), lat_2.data(), lon_2.data(), spacing_m,
+                 n_threads, &profiles);
+  }
+
+  return py::make_tuple(release_to_array(profiles.pfl),
+                        release_to_array(profiles.offsets),
+                        release_to_array(profiles.missing));
+}
+
+// Best-server evaluation over a DEM store. Returns (best, margin_db, second,
+// values) with the server powers and the pruning counters in values.
+py::tuple run_best_server(
+    const DemStore &store, const ndarray_in<double> &tx_lat,
+    const ndarray_in<double> &tx_lon, const ndarray_in<double> &h_tx,
+    const ndarray_in<double> &eirp_dbm, const ndarray_in<double> &f_mhz,
+    const ndarray_in<double> &rx_lat, const ndarray_in<double> &rx_lon,
+    const ndarray_in<double> &h_rx, double threshold_dbm, int climate,
+    double N_0, int pol, double epsilon, double sigma, int mdvar, double time,
+    double location, double situation, double spacing_m, bool prune,
+    int n_threads) {
+  if (tx_lat.ndim() != 1 || tx_lon.ndim() != 1 ||
+      tx_lon.size() != tx_lat.size())
+    throw py::value_error("tx_lat and tx_lon must be 1-D arrays of equal "
+                          "length");
+  if (rx_lat.ndim() != 1 || rx_lon.ndim() != 1 ||
+      rx_lon.size() != rx_lat.size())
+    throw py::value_error("rx_lat and rx_lon must be 1-D arrays of equal "
+                          "length");
+  if (!(spacing_m > 0))
+    throw py::value_error("spacing_m must be positive");
+
+  BestServerInputs in;
+  in.store = &store;
+  in.spacing__meter = spacing_m;
+  in.n_tx = static_cast<std::size_t>(tx_lat.size());
+  in.tx_lat = tx_lat.data();
+  in.tx_lon = tx_lon.data();
+  in.h_tx__meter = as_column(h_tx, in.n_tx, "h_tx");
+  in.eirp__dbm = as_column(eirp_dbm, in.n_tx, "eirp_dbm");
+  in.f__mhz = as_column(f_mhz, in.n_tx, "f_mhz");
+  in.n_rx = static_cast<std::size_t>(rx_lat.size());
+  in.rx_lat = rx_lat.data();
+  in.rx_lon = rx_lon.data();
+  in.h_rx__meter = as_column(h_rx, in.n_rx, "h_rx");
+  in.threshold__dbm = threshold_dbm;
+  in.climate = climate;
+  in.N_0 = N_0;
+  in.pol = pol;
+  in.epsilon = epsilon;
+  in.sigma = sigma;
+  in.mdvar = mdvar;
+  in.time = time;
+  in.location = location;
+  in.situation = situation;
+  in.prune = prune;
+
+  const py::ssize_t n = rx_lat.size();
+  py::array_t<std::int32_t> best(n);
+  py::array_t<double> best_dbm(n);
+  py::array_t<double> margin_db(n);
+  py::array_t<std::int32_t> second(n);
+  py::array_t<double> second_dbm(n);
+
+  BestServerOutputs out;
+  out.best = best.mutable_data();
+  out.best__dbm = best_dbm.mutable_data();
+  out.margin__db = margin_db.mutable_data();
+  out.second = second.mutable_data();
+  out.second__dbm = second_dbm.mutable_data();
+
+  BestServerCounters counters;
+  {
+    py::gil_scoped_release release;
+    itm_best_server(in, n_threads, out, &counters);
+  }
+
+  py::dict links;
+  links["total"] = counters.links;
+  links["below_threshold"] = counters.below_threshold;
+  links["outranked"] = counters.outranked;
+  links["evaluated"] = counters.evaluated;
+  links["failed"] = counters.failed;
+
+  py::dict values;
+  values["best__dbm"] = best_dbm;
+  values["second__dbm"] = second_dbm;
+  values["links"] = links;
+
+  return py::make_tuple(best, margin_db, second, values);
+}
+
+// Gather the scalar area mode parameters
+AreaInputs area_inputs(double h_tx, double h_rx, int tx_site_criteria,
+                       int rx_site_criteria, double delta_h_meter, int climate,
+                       double N_0, double f_mhz, int pol, double epsilon,
+                       double sigma, int mdvar, double time, double location,
+                       double situation) {
+  AreaInputs in;
+  in.h_tx__meter = h_tx;
+  in.h_rx__meter = h_rx;
+  in.tx_site_criteria = tx_site_criteria;
+  in.rx_site_criteria = rx_site_criteria;
+  in.delta_h__meter = delta_h_meter;
+  in.climate = climate;
+  in.N_0 = N_0;
+  in.f__mhz = f_mhz;
+  in.pol = pol;
+  in.epsilon = epsilon;
+  in.sigma = sigma;
+  in.mdvar = mdvar;
+  in.time = time;
+  in.location = location;
+  in.situation = situation;
+  return in;
+}
+
+// Shared body of the area mode distance sweeps
+py::tuple run_area_distances(QuantileMode quantiles, const AreaInputs &in,
+                             const ndarray_in<double> &d_km) {
+  if (d_km.ndim() != 1)
+    throw py::value_error("d_km must be a 1-D array of distances");
+
+  const py::ssize_t n = d_km.size();
+  py::array_t<double> A_db(n);
+  py::array_t<std::int32_t> status(n);
+  py::array_t<std::int64_t> warnings(n);
+  py::array_t<double> A_ref(n);
+  py::array_t<double> A_fs(n);
+  py::array_t<std::int32_t> mode(n);
+  IntermediateValues geometry;
+
+  AreaDistanceOutputs out;
+  out.A__db = A_db.mutable_data();
+  out.status = status.mutable_data();
+  out.warnings = warnings.mutable_data();
+  out.A_ref__db = A_ref.mutable_data();
+  out.A_fs__db = A_fs.mutable_data();
+  out.mode = mode.mutable_data();
+
+  {
+    py::gil_scoped_release release;
+    itm_area_distances(in, quantiles, static_cast<std::size_t>(n),
+                       d_km.data(), out, &geometry);
+  }
+
+  py::dict values = wrap_intermediate_values(geometry);
+  values["A_ref__db"] = A_ref;
+  values["A_fs__db"] = A_fs;
+  values["d__km"] = d_km;
+  values["mode"] = mode;
+
+  return py::make_tuple(status, A_db, warnings, values);
+}
+
+// Build a loss table after checking its range, releasing the GIL while the
+// samples are computed
+AreaLossTable *make_area_table(QuantileMode quantiles, const AreaInputs &in,
+                               double d_min_km, double d_max_km,
+                               std::size_t n_samples) {
+  if (!(d_min_km > 0 && d_max_km > d_min_km))
+    throw py::value_error("table range must satisfy 0 < d_min_km < d_max_km");
+  if (n_samples < 2)
+    throw py::value_error("n_samples must be at least 2");
+
+  py::gil_scoped_release release;
+  return new AreaLossTable(in, quantiles, d_min_km, d_max_km, n_samples);
+}
+
 PYBIND11_MODULE(itm_bindings, m) {
   m.doc() = "Python bindings for ITM propagation model";
 
@@ -88,14 +517,18 @@ PYBIND11_MODULE(itm_bindings, m) {
       "itm_p2p_tls_ex",
       [](double h_tx, double h_rx, const std::vector<double> &pfl, int climate,
          double N_0, double f_mhz, int pol, double epsilon, double sigma,
-         int mdvar, double time, double location, double situation) {
+         int mdvar, double time, double location, double situation,
+         LinkCache *cache) {
+        if (cache && !pfl_fits(pfl.data(), pfl.size()))
+          throw py::value_error("pfl must be in [np, xi, z_0..z_np] layout");
         double A_db;
         long warnings;
         IntermediateValues interValues;
 
-        int status = ITM_P2P_TLS_Ex(h_tx, h_rx, pfl.data(), climate, N_0, f_mhz,
-                                    pol, epsilon, sigma, mdvar, time, location,
-                                    situation, &A_db, &warnings, &interValues);
+        int status = itm_p2p_link(cache, QuantileMode::TLS, h_tx, h_rx,
+                                  pfl.data(), climate, N_0, f_mhz, pol,
+                                  epsilon, sigma, mdvar, time, location,
+                                  situation, &A_db, &warnings, &interValues);
 
         return py::make_tuple(
             status,                               // Return status code
@@ -104,11 +537,13 @@ PYBIND11_MODULE(itm_bindings, m) {
             wrap_intermediate_values(interValues) // Wrapped intermediate values
         );
       },
-      "Point-to-point transmission loss calculation with extended values",
+      "Point-to-point transmission loss calculation with extended values. "
+      "With a LinkCache, a link it already holds skips ITM and any other is "
+      "added to it",
       py::arg("h_tx"), py::arg("h_rx"), py::arg("pfl"), py::arg("climate"),
       py::arg("N_0"), py::arg("f_mhz"), py::arg("pol"), py::arg("epsilon"),
       py::arg("sigma"), py::arg("mdvar"), py::arg("time"), py::arg("location"),
-      py::arg("situation"));
+      py::arg("situation"), py::arg("cache") = py::none());
 
   // ITM_P2P_CR
   m.def("itm_p2p_cr",
@@ -128,14 +563,19 @@ PYBIND11_MODULE(itm_bindings, m) {
       "itm_p2p_cr_ex",
       [](double h_tx, double h_rx, const std::vector<double> &pfl, int climate,
          double N_0, double f_mhz, int pol, double epsilon, double sigma,
-         int mdvar, double confidence, double reliability) {
+         int mdvar, double confidence, double reliability, LinkCache *cache) {
+        if (cache && !pfl_fits(pfl.data(), pfl.size()))
+          throw py::value_error("pfl must be in [np, xi, z_0..z_np] layout");
         double A_db;
         long warnings;
         IntermediateValues interValues;
 
-        int status = ITM_P2P_CR_Ex(h_tx, h_rx, pfl.data(), climate, N_0, f_mhz,
-                                   pol, epsilon, sigma, mdvar, confidence,
-                                   reliability, &A_db, &warnings, &interValues);
+        // itm_p2p_link takes reliability as time and confidence as situation
+        int status = itm_p2p_link(cache, QuantileMode::CR, h_tx, h_rx,
+                                  pfl.data(), climate, N_0, f_mhz, pol,
+                                  epsilon, sigma, mdvar, reliability,
+                                  reliability, confidence, &A_db, &warnings,
+                                  &interValues);
 
         return py::make_tuple(
             status,                               // Return status code
@@ -145,11 +585,12 @@ PYBIND11_MODULE(itm_bindings, m) {
         );
       },
       "Point-to-point transmission loss calculation with confidence, "
-      "reliability, and extended values",
+      "reliability, and extended values. With a LinkCache, a link it already "
+      "holds skips ITM and any other is added to it",
       py::arg("h_tx"), py::arg("h_rx"), py::arg("pfl"), py::arg("climate"),
       py::arg("N_0"), py::arg("f_mhz"), py::arg("pol"), py::arg("epsilon"),
       py::arg("sigma"), py::arg("mdvar"), py::arg("confidence"),
-      py::arg("reliability"));
+      py::arg("reliability"), py::arg("cache") = py::none());
 
   // ITM_AREA_TLS
   m.def("itm_area_tls",
@@ -254,4 +695,475 @@ PYBIND11_MODULE(itm_bindings, m) {
       py::arg("climate"), py::arg("N_0"), py::arg("f_mhz"), py::arg("pol"),
       py::arg("epsilon"), py::arg("sigma"), py::arg("mdvar"),
       py::arg("confidence"), py::arg("reliability"));
+
+  m.def("parse_warnings", &parse_warnings,
+        "Convert an ITM warnings bitmask into a list of messages",
+        py::arg("warnings"));
+
+  // ITM_P2P_TLS_Ex over a batch of links
+  m.def(
+      "itm_p2p_tls_batch",
+      [](const ndarray_in<double> &h_tx, const ndarray_in<double> &h_rx,
+         const ndarray_in<double> &pfl, const ndarray_in<int> &climate,
+         const ndarray_in<double> &N_0, const ndarray_in<double> &f_mhz,
+         const ndarray_in<int> &pol, const ndarray_in<double> &epsilon,
+         const ndarray_in<double> &sigma, const ndarray_in<int> &mdvar,
+         const ndarray_in<double> &time, const ndarray_in<double> &location,
+         const ndarray_in<double> &situation, const py::object &offsets,
+         int n_threads, bool vectorized, LinkCache *cache) {
+        return run_p2p_batch(QuantileMode::TLS, h_tx, h_rx, pfl, climate, N_0,
+                             f_mhz, pol, epsilon, sigma, mdvar, time, location,
+                             situation, offsets, n_threads, vectorized, cache);
+      },
+      "Point-to-point transmission loss for a batch of links, computed on a "
+      "pool of worker threads with the GIL released. Returns arrays of "
+      "status codes, losses, warning bitmasks and intermediate values. With "
+      "vectorized=True, links are evaluated several at a time in SIMD "
+      "registers and losses match the single-link function to within "
+      "rounding. With a LinkCache, links it already holds skip ITM and the "
+      "others are added to it",
+      py::arg("h_tx"), py::arg("h_rx"), py::arg("pfl"), py::arg("climate"),
+      py::arg("N_0"), py::arg("f_mhz"), py::arg("pol"), py::arg("epsilon"),
+      py::arg("sigma"), py::arg("mdvar"), py::arg("time"), py::arg("location"),
+      py::arg("situation"), py::arg("offsets") = py::none(),
+      py::arg("n_threads") = 0, py::arg("vectorized") = false,
+      py::arg("cache") = py::none());
+
+  // ITM_P2P_CR_Ex over a batch of links
+  m.def(
+      "itm_p2p_cr_batch",
+      [](const ndarray_in<double> &h_tx, const ndarray_in<double> &h_rx,
+         const ndarray_in<double> &pfl, const ndarray_in<int> &climate,
+         const ndarray_in<double> &N_0, const ndarray_in<double> &f_mhz,
+         const ndarray_in<int> &pol, const ndarray_in<double> &epsilon,
+         const ndarray_in<double> &sigma, const ndarray_in<int> &mdvar,
+         const ndarray_in<double> &confidence,
+         const ndarray_in<double> &reliability, const py::object &offsets,
+         int n_threads, bool vectorized, LinkCache *cache) {
+        return run_p2p_batch(QuantileMode::CR, h_tx, h_rx, pfl, climate, N_0,
+                             f_mhz, pol, epsilon, sigma, mdvar, reliability,
+                             reliability, confidence, offsets, n_threads,
+                             vectorized, cache);
+      },
+      "Point-to-point transmission loss with confidence and reliability for "
+      "a batch of links, computed on a pool of worker threads with the GIL "
+      "released, and answered from cache where it holds the link",
+      py::arg("h_tx"), py::arg("h_rx"), py::arg("pfl"), py::arg("climate"),
+      py::arg("N_0"), py::arg("f_mhz"), py::arg("pol"), py::arg("epsilon"),
+      py::arg("sigma"), py::arg("mdvar"), py::arg("confidence"),
+      py::arg("reliability"), py::arg("offsets") = py::none(),
+      py::arg("n_threads") = 0, py::arg("vectorized") = false,
+      py::arg("cache") = py::none());
+
+  // ITM_P2P_TLS_Ex for every receiver of a radial sweep over a DEM
+  m.def(
+      "itm_p2p_tls_radials",
+      [](const ndarray_in<double> &elevation,
+         const std::vector<double> &geotransform, double lat, double lon,
+         double h_tx, double h_rx, int n_radials, double step_m, int n_steps,
+         int climate, double N_0, double f_mhz, int pol, double epsilon,
+         double sigma, int mdvar, double time, double location,
+         double situation, double nodata, int n_threads) {
+        if (elevation.ndim() != 2)
+          throw py::value_error("elevation must be a 2-D array");
+        if (geotransform.size() != 6)
+          throw py::value_error("geotransform must have 6 coefficients");
+        if (n_radials <= 0 || n_steps <= 0 || !(step_m > 0))
+          throw py::value_error(
+              "n_radials, n_steps and step_m must all be positive");
+
+        RadialSweepInputs in;
+        in.grid.z = elevation.data();
+        in.grid.rows = static_cast<std::size_t>(elevation.shape(0));
+        in.grid.cols = static_cast<std::size_t>(elevation.shape(1));
+        std::copy(geotransform.begin(), geotransform.end(), in.grid.gt);
+        in.grid.nodata = nodata;
+        if (in.grid.gt[1] * in.grid.gt[5] - in.grid.gt[2] * in.grid.gt[4] ==
+            0)
+          throw py::value_error("geotransform is not invertible");
+
+        in.lat = lat;
+        in.lon = lon;
+        in.h_tx__meter = h_tx;
+        in.h_rx__meter = h_rx;
+        in.n_radials = n_radials;
+        in.n_steps = n_steps;
+        in.step__meter = step_m;
+        in.climate = climate;
+        in.N_0 = N_0;
+        in.f__mhz = f_mhz;
+        in.pol = pol;
+        in.epsilon = epsilon;
+        in.sigma = sigma;
+        in.mdvar = mdvar;
+        in.time = time;
+        in.location = location;
+        in.situation = situation;
+
+        const std::vector<py::ssize_t> shape = {n_radials, n_steps};
+        py::array_t<double> A_db(shape);
+        py::array_t<std::int32_t> status(shape);
+        py::array_t<std::int64_t> warnings(shape);
+        py::array_t<double> rx_lat(shape);
+        py::array_t<double> rx_lon(shape);
+
+        RadialSweepOutputs out;
+        out.A__db = A_db.mutable_data();
+        out.status = status.mutable_data();
+        out.warnings = warnings.mutable_data();
+        out.lat = rx_lat.mutable_data();
+        out.lon = rx_lon.mutable_data();
+
+        {
+          py::gil_scoped_release release;
+          itm_p2p_radial_sweep(in, n_threads, out);
+        }
+
+        py::array_t<double> bearing(n_radials);
+        for (int r = 0; r < n_radials; r++)
+          bearing.mutable_data()[r] = 360.0 * r / n_radials;
+        py::array_t<double> d_km(n_steps);
+        for (int j = 0; j < n_steps; j++)
+          d_km.mutable_data()[j] = (j + 1) * step_m / 1000;
+
+        py::dict values;
+        values["lat"] = rx_lat;
+        values["lon"] = rx_lon;
+        values["bearing__deg"] = bearing;
+        values["d__km"] = d_km;
+
+        return py::make_tuple(status, A_db, warnings, values);
+      },
+      "Point-to-point transmission loss from one transmitter to receivers "
+      "spaced step_m apart along n_radials great-circle radials, with terrain "
+      "sampled bilinearly from an elevation grid. Returns [n_radials, "
+      "n_steps] arrays; receivers off the grid get status -1",
+      py::arg("elevation"), py::arg("geotransform"), py::arg("lat"),
+      py::arg("lon"), py::arg("h_tx"), py::arg("h_rx"), py::arg("n_radials"),
+      py::arg("step_m"), py::arg("n_steps"), py::arg("climate"),
+      py::arg("N_0"), py::arg("f_mhz"), py::arg("pol"), py::arg("epsilon"),
+      py::arg("sigma"), py::arg("mdvar"), py::arg("time"), py::arg("location"),
+      py::arg("situation"), py::arg("nodata") = NAN,
+      py::arg("n_threads") = 0);
+
+  // ITM_P2P_TLS_Ex over a grid of frequencies and TLS quantiles
+  m.def(
+      "itm_p2p_tls_sweep",
+      [](double h_tx, double h_rx, const ndarray_in<double> &pfl, int climate,
+         double N_0, const ndarray_in<double> &f_mhz, int pol, double epsilon,
+         double sigma, int mdvar, const ndarray_in<double> &quantiles) {
+        return run_p2p_sweep(QuantileMode::TLS, h_tx, h_rx, pfl, climate, N_0,
+                             f_mhz, pol, epsilon, sigma, mdvar, quantiles);
+      },
+      "Point-to-point transmission loss for one profile at every frequency "
+      "in f_mhz and every (time, location, situation) row of quantiles. The "
+      "terrain geometry is computed once; returns [n_freqs, n_quantiles] "
+      "arrays",
+      py::arg("h_tx"), py::arg("h_rx"), py::arg("pfl"), py::arg("climate"),
+      py::arg("N_0"), py::arg("f_mhz"), py::arg("pol"), py::arg("epsilon"),
+      py::arg("sigma"), py::arg("mdvar"), py::arg("quantiles"));
+
+  // ITM_P2P_CR_Ex over a grid of frequencies and CR quantiles
+  m.def(
+      "itm_p2p_cr_sweep",
+      [](double h_tx, double h_rx, const ndarray_in<double> &pfl, int climate,
+         double N_0, const ndarray_in<double> &f_mhz, int pol, double epsilon,
+         double sigma, int mdvar, const ndarray_in<double> &quantiles) {
+        return run_p2p_sweep(QuantileMode::CR, h_tx, h_rx, pfl, climate, N_0,
+                             f_mhz, pol, epsilon, sigma, mdvar, quantiles);
+      },
+      "Point-to-point transmission loss for one profile at every frequency "
+      "in f_mhz and every (confidence, reliability) row of quantiles. The "
+      "terrain geometry is computed once; returns [n_freqs, n_quantiles] "
+      "arrays",
+      py::arg("h_tx"), py::arg("h_rx"), py::arg("pfl"), py::arg("climate"),
+      py::arg("N_0"), py::arg("f_mhz"), py::arg("pol"), py::arg("epsilon"),
+      py::arg("sigma"), py::arg("mdvar"), py::arg("quantiles"));
+
+  // ITM_AREA_TLS_Ex over an array of distances
+  m.def(
+      "itm_area_tls_distances",
+      [](double h_tx, double h_rx, int tx_site_criteria, int rx_site_criteria,
+         const ndarray_in<double> &d_km, double delta_h_meter, int climate,
+         double N_0, double f_mhz, int pol, double epsilon, double sigma,
+         int mdvar, double time, double location, double situation) {
+        const AreaInputs in =
+            area_inputs(h_tx, h_rx, tx_site_criteria, rx_site_criteria,
+                        delta_h_meter, climate, N_0, f_mhz, pol, epsilon,
+                        sigma, mdvar, time, location, situation);
+        return run_area_distances(QuantileMode::TLS, in, d_km);
+      },
+      "Area transmission loss at every distance in d_km. The terminal "
+      "geometry and reference lines are computed once; returns arrays with "
+      "one entry per distance",
+      py::arg("h_tx"), py::arg("h_rx"), py::arg("tx_site_criteria"),
+      py::arg("rx_site_criteria"), py::arg("d_km"), py::arg("delta_h_meter"),
+      py::arg("climate"), py::arg("N_0"), py::arg("f_mhz"), py::arg("pol"),
+      py::arg("epsilon"), py::arg("sigma"), py::arg("mdvar"), py::arg("time"),
+      py::arg("location"), py::arg("situation"));
+
+  // ITM_AREA_CR_Ex over an array of distances
+  m.def(
+      "itm_area_cr_distances",
+      [](double h_tx, double h_rx, int tx_site_criteria, int rx_site_criteria,
+         const ndarray_in<double> &d_km, double delta_h_meter, int climate,
+         double N_0, double f_mhz, int pol, double epsilon, double sigma,
+         int mdvar, double confidence, double reliability) {
+        // CR mode reads reliability from time and confidence from situation
+        const AreaInputs in =
+            area_inputs(h_tx, h_rx, tx_site_criteria, rx_site_criteria,
+                        delta_h_meter, climate, N_0, f_mhz, pol, epsilon,
+                        sigma, mdvar, reliability, 50, confidence);
+        return run_area_distances(QuantileMode::CR, in, d_km);
+      },
+      "Area transmission loss with confidence and reliability at every "
+      "distance in d_km",
+      py::arg("h_tx"), py::arg("h_rx"), py::arg("tx_site_criteria"),
+      py::arg("rx_site_criteria"), py::arg("d_km"), py::arg("delta_h_meter"),
+      py::arg("climate"), py::arg("N_0"), py::arg("f_mhz"), py::arg("pol"),
+      py::arg("epsilon"), py::arg("sigma"), py::arg("mdvar"),
+      py::arg("confidence"), py::arg("reliability"));
+
+  // Precomputed area mode loss curve
+  py::class_<AreaLossTable>(m, "AreaLossTable",
+                            "Area transmission loss sampled at log-spaced "
+                            "distances and linearly interpolated")
+      .def(
+          "__call__",
+          [](const AreaLossTable &table, const ndarray_in<double> &d_km) {
+            py::array_t<double> A_db(
+                std::vector<py::ssize_t>(d_km.shape(),
+                                         d_km.shape() + d_km.ndim()));
+            double *dst = A_db.mutable_data();
+            {
+              py::gil_scoped_release release;
+              table.evaluate(static_cast<std::size_t>(d_km.size()),
+                             d_km.data(), dst);
+            }
+            return A_db;
+          },
+          "Interpolated loss at each distance; NaN outside the table range",
+          py::arg("d_km"))
+      .def_property_readonly(
+          "d_km",
+          [](const AreaLossTable &table) {
+            return py::array_t<double>(table.d__km().size(),
+                                       table.d__km().data());
+          })
+      .def_property_readonly("loss_db", [](const AreaLossTable &table) {
+        return py::array_t<double>(table.A__db().size(),
+                                   table.A__db().data());
+      });
+
+  m.def(
+      "itm_area_tls_table",
+      [](double h_tx, double h_rx, int tx_site_criteria, int rx_site_criteria,
+         double delta_h_meter, int climate, double N_0, double f_mhz, int pol,
+         double epsilon, double sigma, int mdvar, double time, double location,
+         double situation, double d_min_km, double d_max_km,
+         std::size_t n_samples) {
+        const AreaInputs in =
+            area_inputs(h_tx, h_rx, tx_site_criteria, rx_site_criteria,
+                        delta_h_meter, climate, N_0, f_mhz, pol, epsilon,
+                        sigma, mdvar, time, location, situation);
+        return make_area_table(QuantileMode::TLS, in, d_min_km, d_max_km,
+                               n_samples);
+      },
+      "Precompute an area transmission loss table over [d_min_km, d_max_km] "
+      "for fast repeated lookups",
+      py::arg("h_tx"), py::arg("h_rx"), py::arg("tx_site_criteria"),
+      py::arg("rx_site_criteria"), py::arg("delta_h_meter"),
+      py::arg("climate"), py::arg("N_0"), py::arg("f_mhz"), py::arg("pol"),
+      py::arg("epsilon"), py::arg("sigma"), py::arg("mdvar"), py::arg("time"),
+      py::arg("location"), py::arg("situation"), py::arg("d_min_km"),
+      py::arg("d_max_km"), py::arg("n_samples") = 1024);
+
+  py::class_<DemStore>(m, "DemStore",
+                       "Tiled, memory-mapped elevation store written once "
+                       "from a DEM raster")
+      .def(py::init<const std::string &, std::size_t>(), py::arg("path"),
+           py::arg("max_tiles") = 256,
+           "Open a store, keeping at most max_tiles tiles mapped")
+      .def_static(
+          "create",
+          [](const std::string &path, const ndarray_in<double> &elevation,
+             const std::vector<double> &geotransform, double nodata,
+             int tile_size) {
+            if (elevation.ndim() != 2)
+              throw py::value_error("elevation must be a 2-D array");
+            if (geotransform.size() != 6)
+              throw py::value_error("geotransform must have 6 coefficients");
+            if (geotransform[1] * geotransform[5] -
+                    geotransform[2] * geotransform[4] ==
+                0)
+              throw py::value_error("geotransform is not invertible");
+            if (tile_size <= 0 || tile_size % kDemTileAlign != 0)
+              throw py::value_error("tile_size must be a positive multiple "
+                                    "of " +
+                                    std::to_string(kDemTileAlign));
+
+            GeoGrid grid;
+            grid.z = elevation.data();
+            grid.rows = static_cast<std::size_t>(elevation.shape(0));
+            grid.cols = static_cast<std::size_t>(elevation.shape(1));
+            std::copy(geotransform.begin(), geotransform.end(), grid.gt);
+            grid.nodata = nodata;
+
+            py::gil_scoped_release release;
+            DemStore::create(path, grid, tile_size);
+          },
+          "Convert an elevation raster with a GDAL geotransform into a tile "
+          "store at path",
+          py::arg("path"), py::arg("elevation"), py::arg("geotransform"),
+          py::arg("nodata") = NAN, py::arg("tile_size") = kDemDefaultTileSize)
+      .def_property_readonly("rows", &DemStore::rows)
+      .def_property_readonly("cols", &DemStore::cols)
+      .def_property_readonly("tile_size", &DemStore::tile_size)
+      .def_property_readonly("geotransform",
+                             [](const DemStore &store) {
+                               const double *gt = store.geotransform();
+                               return std::vector<double>(gt, gt + 6);
+                             })
+      .def("stats",
+           [](const DemStore &store) {
+             const DemStoreStats stats = store.stats();
+             py::dict result;
+             result["hits"] = stats.hits;
+             result["misses"] = stats.misses;
+             result["evictions"] = stats.evictions;
+             result["mapped"] = stats.mapped;
+             return result;
+           },
+           "Tile lookups that hit or missed the mapped set, evictions, and "
+           "tiles currently mapped")
+      .def("sample", &DemStore::sample,
+           "Bilinear elevation at (lat, lon); NaN off the raster or next to "
+           "nodata",
+           py::arg("lat"), py::arg("lon"))
+      .def(
+          "profile",
+          [](const DemStore &store, double lat_1, double lon_1, double lat_2,
+             double lon_2, double spacing_m) {
+            if (!(spacing_m > 0))
+              throw py::value_error("spacing_m must be positive");
+            if (!DemStore::link_valid(lat_1, lon_1, lat_2, lon_2))
+              throw py::value_error("link endpoints must be finite and a "
+                                    "positive distance apart");
+            py::array_t<double> pfl(static_cast<py::ssize_t>(
+                DemStore::profile_size(lat_1, lon_1, lat_2, lon_2,
+                                       spacing_m)));
+            double *data = pfl.mutable_data();
+            std::size_t missing;
+            {
+              py::gil_scoped_release release;
+              missing =
+                  store.profile(lat_1, lon_1, lat_2, lon_2, spacing_m, data);
+            }
+            return py::make_tuple(pfl, missing);
+          },
+          "Great-circle terrain profile from (lat_1, lon_1) to (lat_2, "
+          "lon_2) in [np, xi, z_0..z_np] layout, sampled every spacing_m or "
+          "slightly less. Returns (pfl, number of samples off the raster)",
+          py::arg("lat_1"), py::arg("lon_1"), py::arg("lat_2"),
+          py::arg("lon_2"), py::arg("spacing_m"))
+      .def("profiles", &dem_store_profiles,
+           "Profiles for a batch of links on a pool of worker threads. "
+           "Returns (pfl, offsets, missing), where pfl and offsets can be "
+           "passed straight to itm_p2p_tls_batch",
+           py::arg("lat_1"), py::arg("lon_1"), py::arg("lat_2"),
+           py::arg("lon_2"), py::arg("spacing_m"), py::arg("n_threads") = 0);
+
+  py::class_<LinkCache>(m, "LinkCache",
+                        "Persistent, memory-mapped store of point-to-point "
+                        "link results keyed by terrain profile and "
+                        "quantized parameters")
+      .def(py::init([](const std::string &path, bool writable,
+                       double height_step_m, double N_0_step,
+                       double f_step_mhz, double ground_step,
+                       double percent_step) {
+             const LinkCacheQuanta quanta = {height_step_m, N_0_step,
+                                             f_step_mhz, ground_step,
+                                             percent_step};
+             return new LinkCache(path, writable, quanta);
+           }),
+           "Open the cache at path, creating it when it does not exist and "
+           "writable is set. The steps parameters are rounded to before "
+           "hashing only apply to a new cache; an existing one keeps those "
+           "it was created with. Only one process may hold a cache open "
+           "for writing; any number may read it",
+           py::arg("path"), py::arg("writable") = true,
+           py::arg("height_step_m") = kDefaultLinkCacheQuanta.height__meter,
+           py::arg("N_0_step") = kDefaultLinkCacheQuanta.N_0,
+           py::arg("f_step_mhz") = kDefaultLinkCacheQuanta.f__mhz,
+           py::arg("ground_step") = kDefaultLinkCacheQuanta.ground,
+           py::arg("percent_step") = kDefaultLinkCacheQuanta.percent)
+      .def_property_readonly("writable", &LinkCache::writable)
+      .def("stats",
+           [](const LinkCache &cache) {
+             const LinkCacheStats stats = cache.stats();
+             py::dict result;
+             result["hits"] = stats.hits;
+             result["misses"] = stats.misses;
+             result["inserts"] = stats.inserts;
+             result["records"] = stats.records;
+             return result;
+           },
+           "Lookups that hit or missed since opening, records appended since "
+           "opening, and records in the file");
+
+  // Best and second-best server per receiver among many transmitters
+  m.def("itm_best_server_tls", &run_best_server,
+        "Best and second-best transmitter for every receiver, with terrain "
+        "from a DEM store. Links whose free-space and variability loss bound "
+        "cannot reach threshold_dbm or beat the second-best server are "
+        "skipped. Returns (best, margin_db, second, values); servers are "
+        "transmitter indices, -1 where none reaches the threshold",
+        py::arg("store"), py::arg("tx_lat"), py::arg("tx_lon"),
+        py::arg("h_tx"), py::arg("eirp_dbm"), py::arg("f_mhz"),
+        py::arg("rx_lat"), py::arg("rx_lon"), py::arg("h_rx"),
+        py::arg("threshold_dbm"), py::arg("climate"), py::arg("N_0"),
+        py::arg("pol"), py::arg("epsilon"), py::arg("sigma"),
+        py::arg("mdvar"), py::arg("time"), py::arg("location"),
+        py::arg("situation"), py::arg("spacing_m") = 30.0,
+        py::arg("prune") = true, py::arg("n_threads") = 0);
+
+  m.def("enable_instrumentation", &EnableInstrumentation,
+        "Turn the ITM stage timers and propagation mode counters on or off",
+        py::arg("enabled") = true);
+
+  m.def("reset_instrumentation", &ResetInstrumentation,
+        "Zero the ITM stage timers and propagation mode counters");
+
+  // counters are process-wide and include calls made from worker threads
+  m.def(
+      "instrumentation",
+      []() {
+        static const char *const stage_names[STAGE__COUNT] = {
+            "QuickPfl",         "LongleyRice", "DiffractionLoss",
+            "TroposcatterLoss", "Variability", "LongleyRiceBatch"};
+
+        py::dict stages;
+        for (int stage = 0; stage < STAGE__COUNT; stage++) {
+          long long calls;
+          double seconds;
+          GetStageCounters(stage, &calls, &seconds);
+          py::dict counters;
+          counters["calls"] = calls;
+          counters["seconds"] = seconds;
+          stages[stage_names[stage]] = counters;
+        }
+
+        py::dict modes;
+        modes["line_of_sight"] = GetModeCount(MODE__LINE_OF_SIGHT);
+        modes["diffraction"] = GetModeCount(MODE__DIFFRACTION);
+        modes["troposcatter"] = GetModeCount(MODE__TROPOSCATTER);
+
+        py::dict result;
+        result["enabled"] = InstrumentationEnabled();
+        result["stages"] = stages;
+        result["modes"] = modes;
+        return result;
+      },
+      "Per-stage call counts and inclusive wall time, and the number of "
+      "reference attenuations in each propagation mode");
 }
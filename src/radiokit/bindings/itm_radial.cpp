@@ -0,0 +1,451 @@
+#include "itm_radial.h"
+#include "Enums.h"
+#include "Errors.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+namespace {
+
+// Samples per block of the RX horizon search
+const int kHorizonBlock = 16;
+
+// Fit ranges up to this many intervals are summed directly rather than from
+// the running sums
+const int kDirectFitLength = 256;
+
+// Allowance for rounding when comparing a block bound with a horizon angle
+const double kHorizonSlack = 1e-9;
+
+// Upper convex hull of the TX-side horizon candidates (x_i, s_i), where x_i is
+// the distance to terrain sample i and s_i the slope from the TX antenna to
+// it. The TX horizon angle max_i(s_i - x_i / 2a_e) is always attained at a
+// hull vertex. A plain running maximum is not enough: a_e follows the path
+// average height and so changes from one receiver to the next.
+class HorizonHull {
+public:
+  void clear() { vertices_.clear(); }
+
+  // Add sample i; samples must arrive in order of increasing distance
+  void push(int i, const double *x, const double *s) {
+    while (vertices_.size() >= 2) {
+      const int a = vertices_[vertices_.size() - 2];
+      const int b = vertices_.back();
+      const double cross =
+          (x[b] - x[a]) * (s[i] - s[a]) - (s[b] - s[a]) * (x[i] - x[a]);
+      if (cross < 0)
+        break;
+      vertices_.pop_back();
+    }
+    vertices_.push_back(i);
+  }
+
+  std::size_t size() const { return vertices_.size(); }
+  int vertex(std::size_t k) const { return vertices_[k]; }
+
+  // Position of the vertex maximizing s - c * x, the earliest one on ties;
+  // -1 when empty
+  int argmax(double c, const double *x, const double *s) const {
+    if (vertices_.empty())
+      return -1;
+
+    // edge slopes decrease along the hull: find the first edge that does not
+    // climb faster than c
+    std::size_t lo = 0;
+    std::size_t hi = vertices_.size() - 1;
+    while (lo < hi) {
+      const std::size_t mid = (lo + hi) / 2;
+      const int a = vertices_[mid];
+      const int b = vertices_[mid + 1];
+      if (s[b] - s[a] > c * (x[b] - x[a]))
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    return static_cast<int>(lo);
+  }
+
+private:
+  std::vector<int> vertices_;
+};
+
+// Working state of the radial being swept, kept by each worker and reused
+// from one radial to the next. pfl holds the sampled radial in pfl layout;
+// the profile of the receiver at sample np is its first np + 1 samples.
+struct RadialState {
+  std::vector<double> pfl;
+  std::vector<double> x__meter; // distances accumulated as FindHorizons does
+  std::vector<double> s_tx;     // slope from the TX antenna to each sample
+  std::vector<double> sum_z;    // sum_z[k] = z_0 + ... + z_(k-1)
+  std::vector<double> sum_iz;   // sum_iz[k] = 0 * z_0 + ... + (k-1) * z_(k-1)
+  std::vector<double> block_max; // highest sample of each horizon block
+  HorizonHull hull;
+
+  const double *z() const { return pfl.data() + 2; }
+};
+
+// LinearLeastSquaresFit over the first np intervals of the radial, with the
+// running sums taking the place of the per-call loop
+void prefix_linear_fit(const RadialState &st, int np, double xi,
+                       double d_start, double d_end, double *fit_y1,
+                       double *fit_y2) {
+  const double *z = st.z();
+
+  int i_start = int(fdim(d_start / xi, 0.0));
+  int i_end = np - int(fdim(np, d_end / xi));
+
+  if (i_end <= i_start) {
+    i_start = (int)fdim(i_start, 1.0);
+    i_end = np - (int)fdim(np, i_end + 1.0);
+  }
+
+  const double x_length = i_end - i_start;
+  const double mid_shifted_index = -0.5 * x_length;
+  const double mid_shifted_end = i_end + mid_shifted_index;
+
+  double sum_y = 0.5 * (z[i_start] + z[i_end]);
+  double scaled_sum_y = 0.5 * (z[i_start] - z[i_end]) * mid_shifted_index;
+
+  if (i_end - i_start <= kDirectFitLength) {
+    // short ranges: the running sums would cancel badly, sum directly
+    double w = mid_shifted_index;
+    for (int i = i_start + 1; i < i_end; i++) {
+      w++;
+      sum_y += z[i];
+      scaled_sum_y += z[i] * w;
+    }
+  } else {
+    // interior samples i_start < i < i_end, weighted by their offset from
+    // the middle of the fit range
+    const double inner = st.sum_z[i_end] - st.sum_z[i_start + 1];
+    const double inner_i = st.sum_iz[i_end] - st.sum_iz[i_start + 1];
+    sum_y += inner;
+    scaled_sum_y += inner_i + (mid_shifted_index - i_start) * inner;
+  }
+
+  sum_y = sum_y / x_length;
+  scaled_sum_y =
+      scaled_sum_y * 12.0 / ((x_length * x_length + 2.0) * x_length);
+
+  *fit_y1 = sum_y - scaled_sum_y * mid_shifted_end;
+  *fit_y2 = sum_y + scaled_sum_y * (np - mid_shifted_end);
+}
+
+// ComputeDeltaH for the receiver at sample np. The reference resamples the
+// range to at most 245 points but reaches each one by stepping through the
+// terrain a sample at a time, which costs O(np) per receiver; here each
+// point is reached in one jump. The steps subtract 1.0 exactly, so the jump
+// lands on the same sample and fraction and the result is unchanged.
+double radial_delta_h(const RadialState &st, int np, double xi,
+                      double d_start__meter, double d_end__meter) {
+  const double *pfl = st.pfl.data();
+  double s[247] = {0};
+
+  double x_start = d_start__meter / xi;
+  double x_end = d_end__meter / xi;
+  if (x_end - x_start < 2.0)
+    return 0;
+
+  int p10 = (int)(0.1 * (x_end - x_start + 8.0));
+  p10 = MIN(MAX(4, p10), 25);
+  const int n = 10 * p10 - 5;
+  const int p90 = n - p10;
+
+  const double np_s = n - 1;
+  s[0] = np_s;
+  s[1] = 1.0;
+
+  x_end = (x_end - x_start) / np_s;
+  int i = (int)x_start;
+  x_start -= float(i + 1.0);
+
+  for (int j = 0; j < n; j++) {
+    if (x_start > 0.0 && i + 1 < np) {
+      const int steps = MIN((int)ceil(x_start), np - 1 - i);
+      x_start -= steps;
+      i += steps;
+    }
+    s[j + 2] = pfl[i + 3] + (pfl[i + 3] - pfl[i + 2]) * x_start;
+    x_start += x_end;
+  }
+
+  double fit_y1, fit_y2;
+  LinearLeastSquaresFit(s, 0.0, np_s, &fit_y1, &fit_y2);
+  fit_y2 = (fit_y2 - fit_y1) / np_s;
+
+  double diffs[245];
+  for (int j = 0; j < n; j++) {
+    diffs[j] = s[j + 2] - fit_y1;
+    fit_y1 += fit_y2;
+  }
+
+  std::nth_element(diffs, diffs + p10 - 1, diffs + n, std::greater<double>());
+  const double q10 = diffs[p10 - 1];
+  std::nth_element(diffs + p10, diffs + p90, diffs + n,
+                   std::greater<double>());
+  const double q90 = diffs[p90];
+
+  return (q10 - q90) /
+         (1.0 - 0.8 * exp(-(d_end__meter - d_start__meter) / 50e3));
+}
+
+// QuickPfl for the receiver at sample np, reusing the radial state
+void radial_quick_pfl(RadialState &st, int np, double xi, double gamma_e,
+                      const double h__meter[2], double theta_hzn[2],
+                      double d_hzn__meter[2], double h_e__meter[2],
+                      double *delta_h__meter, double *d__meter) {
+  const double *z = st.z();
+  const double d = np * xi;
+  const double a_e__meter = 1 / gamma_e;
+  *d__meter = d;
+
+  const double z_tx__meter = z[0] + h__meter[0];
+  const double z_rx__meter = z[np] + h__meter[1];
+
+  // FindHorizons: line-of-sight angles first, as in the reference
+  theta_hzn[0] = (z_rx__meter - z_tx__meter) / d - d / (2 * a_e__meter);
+  theta_hzn[1] = -(z_rx__meter - z_tx__meter) / d - d / (2 * a_e__meter);
+  d_hzn__meter[0] = d;
+  d_hzn__meter[1] = d;
+
+  // The hull is searched with s - c * x, which rounds differently from the
+  // angle FindHorizons compares, so a near-tie could go to another sample.
+  // The winning vertex and its neighbours are compared again with the exact
+  // expression, in sample order so the earliest wins ties.
+  const int v = st.hull.argmax(1 / (2 * a_e__meter), st.x__meter.data(),
+                               st.s_tx.data());
+  if (v >= 0) {
+    const std::size_t k_end = MIN(std::size_t(v) + 2, st.hull.size());
+    for (std::size_t k = v > 0 ? v - 1 : 0; k < k_end; k++) {
+      const int i = st.hull.vertex(k);
+      const double x = st.x__meter[i];
+      const double theta_tx = (z[i] - z_tx__meter) / x - x / (2 * a_e__meter);
+      if (theta_tx > theta_hzn[0]) {
+        theta_hzn[0] = theta_tx;
+        d_hzn__meter[0] = x;
+      }
+    }
+  }
+
+  // The RX horizon moves with the receiver, so it is searched afresh, walking
+  // back from the receiver a block at a time. A block is skipped when even
+  // its highest sample, placed at its nearest distance, could not beat the
+  // best angle so far. Equal angles resolve towards the TX end as in
+  // FindHorizons, with the line-of-sight angle winning over samples.
+  const double c = 1 / (2 * a_e__meter);
+  bool rx_is_los = true;
+  for (int i = np - 1; i >= 1;) {
+    const int b = i / kHorizonBlock;
+    const int i_lo = MAX(b * kHorizonBlock, 1);
+
+    const double u_lo = d - st.x__meter[i];
+    const double u_hi = d - st.x__meter[i_lo];
+    const double rise = st.block_max[b] - z_rx__meter;
+    const double bound = rise / (rise >= 0 ? u_lo : u_hi) - u_lo * c;
+
+    if (bound + kHorizonSlack >= theta_hzn[1]) {
+      for (int k = i; k >= i_lo; k--) {
+        const double d_rx__meter = d - st.x__meter[k];
+        const double theta_rx = -(z_rx__meter - z[k]) / d_rx__meter -
+                                d_rx__meter / (2 * a_e__meter);
+        if (theta_rx > theta_hzn[1] ||
+            (theta_rx == theta_hzn[1] && !rx_is_los)) {
+          theta_hzn[1] = theta_rx;
+          d_hzn__meter[1] = d_rx__meter;
+          rx_is_los = false;
+        }
+      }
+    }
+    i = i_lo - 1;
+  }
+
+  // remainder of QuickPfl, with the least-squares fits served from the
+  // running sums
+  double fit_tx, fit_rx, q;
+  const double d_start__meter =
+      MIN(15.0 * h__meter[0], 0.1 * d_hzn__meter[0]);
+  const double d_end__meter =
+      d - MIN(15.0 * h__meter[1], 0.1 * d_hzn__meter[1]);
+
+  *delta_h__meter =
+      radial_delta_h(st, np, xi, d_start__meter, d_end__meter);
+
+  if (d_hzn__meter[0] + d_hzn__meter[1] > 1.5 * d) {
+    prefix_linear_fit(st, np, xi, d_start__meter, d_end__meter, &fit_tx,
+                      &fit_rx);
+
+    h_e__meter[0] = h__meter[0] + fdim(z[0], fit_tx);
+    h_e__meter[1] = h__meter[1] + fdim(z[np], fit_rx);
+
+    for (int i = 0; i < 2; i++)
+      d_hzn__meter[i] =
+          sqrt(2.0 * h_e__meter[i] * a_e__meter) *
+          exp(-0.07 * sqrt(*delta_h__meter / MAX(h_e__meter[i], 5.0)));
+
+    const double combined_horizons__meter = d_hzn__meter[0] + d_hzn__meter[1];
+    if (combined_horizons__meter <= d) {
+      q = pow(d / combined_horizons__meter, 2);
+
+      for (int i = 0; i < 2; i++) {
+        h_e__meter[i] = h_e__meter[i] * q;
+        d_hzn__meter[i] =
+            sqrt(2.0 * h_e__meter[i] * a_e__meter) *
+            exp(-0.07 * sqrt(*delta_h__meter / MAX(h_e__meter[i], 5.0)));
+      }
+    }
+
+    for (int i = 0; i < 2; i++) {
+      q = sqrt(2.0 * h_e__meter[i] * a_e__meter);
+      theta_hzn[i] =
+          (0.65 * *delta_h__meter * (q / d_hzn__meter[i] - 1.0) -
+           2.0 * h_e__meter[i]) /
+          q;
+    }
+  } else {
+    double dummy = 0;
+
+    prefix_linear_fit(st, np, xi, d_start__meter, 0.9 * d_hzn__meter[0],
+                      &fit_tx, &dummy);
+    h_e__meter[0] = h__meter[0] + fdim(z[0], fit_tx);
+
+    prefix_linear_fit(st, np, xi, d - 0.9 * d_hzn__meter[1], d_end__meter,
+                      &dummy, &fit_rx);
+    h_e__meter[1] = h__meter[1] + fdim(z[np], fit_rx);
+  }
+}
+
+void sweep_radial(const RadialSweepInputs &in, int r, long base_warnings,
+                  RadialState &st, const RadialSweepOutputs &out) {
+  const int n_steps = in.n_steps;
+  const double xi = in.step__meter;
+  const double bearing = 360.0 * r / in.n_radials;
+  const std::size_t row = static_cast<std::size_t>(r) * n_steps;
+
+  // sample the radial once, stopping where it leaves the grid
+  st.pfl.assign(n_steps + 3, 0.0);
+  st.pfl[1] = xi;
+  double *z = st.pfl.data() + 2;
+
+  int n_valid = -1; // last usable sample index
+  for (int j = 0; j <= n_steps; j++) {
+    double lat, lon;
+    destination_point(in.lat, in.lon, bearing, j * xi, &lat, &lon);
+    if (j > 0) {
+      out.lat[row + j - 1] = lat;
+      out.lon[row + j - 1] = lon;
+    }
+    if (n_valid == j - 1) {
+      z[j] = sample_bilinear(in.grid, lat, lon);
+      if (!std::isnan(z[j]))
+        n_valid = j;
+    }
+  }
+
+  const double h__meter[2] = {in.h_tx__meter, in.h_rx__meter};
+  const double z_tx__meter = z[0] + h__meter[0];
+
+  st.x__meter.assign(n_steps + 1, 0.0);
+  st.s_tx.assign(n_steps + 1, 0.0);
+  st.sum_z.assign(n_steps + 2, 0.0);
+  st.sum_iz.assign(n_steps + 2, 0.0);
+  st.block_max.assign(n_steps / kHorizonBlock + 1, -INFINITY);
+  st.hull.clear();
+
+  double d_tx__meter = 0.0;
+  for (int j = 0; j <= n_valid; j++) {
+    double &block_max = st.block_max[j / kHorizonBlock];
+    block_max = MAX(block_max, z[j]);
+    st.sum_z[j + 1] = st.sum_z[j] + z[j];
+    st.sum_iz[j + 1] = st.sum_iz[j] + j * z[j];
+    if (j > 0) {
+      d_tx__meter = d_tx__meter + xi;
+      st.x__meter[j] = d_tx__meter;
+      st.s_tx[j] = (z[j] - z_tx__meter) / d_tx__meter;
+    }
+  }
+
+  for (int np = 1; np <= n_steps; np++) {
+    const std::size_t k = row + np - 1;
+    out.A__db[k] = NAN;
+    out.warnings[k] = 0;
+
+    if (np > n_valid) {
+      out.status[k] = STATUS__OFF_GRID;
+      continue;
+    }
+
+    // samples strictly between the terminals are TX horizon candidates
+    if (np >= 2)
+      st.hull.push(np - 1, st.x__meter.data(), st.s_tx.data());
+
+    long warnings = base_warnings;
+
+    // average path height, ignoring the first and last 10%
+    const int p10 = int(0.1 * np);
+    const double h_sys__meter = (st.sum_z[np - p10 + 1] - st.sum_z[p10]) /
+                                (np - 2 * p10 + 1);
+
+    complex<double> Z_g;
+    double gamma_e, N_s;
+    InitializePointToPoint(in.f__mhz, h_sys__meter, in.N_0, in.pol,
+                           in.epsilon, in.sigma, &Z_g, &gamma_e, &N_s);
+
+    double theta_hzn[2], d_hzn__meter[2], h_e__meter[2];
+    double delta_h__meter, d__meter;
+    radial_quick_pfl(st, np, xi, gamma_e, h__meter, theta_hzn, d_hzn__meter,
+                     h_e__meter, &delta_h__meter, &d__meter);
+
+    double A_ref__db = 0;
+    int propmode = MODE__NOT_SET;
+    const int rtn = LongleyRice(theta_hzn, in.f__mhz, Z_g, d_hzn__meter,
+                                h_e__meter, gamma_e, N_s, delta_h__meter,
+                                h__meter, d__meter, MODE__P2P, &A_ref__db,
+                                &warnings, &propmode);
+    if (rtn != SUCCESS) {
+      out.status[k] = rtn;
+      out.warnings[k] = warnings;
+      continue;
+    }
+
+    out.A__db[k] = Variability(in.time, in.location, in.situation, h_e__meter,
+                               delta_h__meter, in.f__mhz, d__meter, A_ref__db,
+                               in.climate, in.mdvar, &warnings) +
+                   FreeSpaceLoss(d__meter, in.f__mhz);
+    out.warnings[k] = warnings;
+    out.status[k] = warnings != NO_WARNINGS ? SUCCESS_WITH_WARNINGS : SUCCESS;
+  }
+}
+
+} // namespace
+
+void itm_p2p_radial_sweep(const RadialSweepInputs &in, int n_threads,
+                          const RadialSweepOutputs &out) {
+  const std::size_t n_cells =
+      static_cast<std::size_t>(in.n_radials) * in.n_steps;
+
+  long base_warnings = NO_WARNINGS;
+  const int rtn = ValidateInputs(in.h_tx__meter, in.h_rx__meter, in.climate,
+                                 in.time, in.location, in.situation, in.N_0,
+                                 in.f__mhz, in.pol, in.epsilon, in.sigma,
+                                 in.mdvar, &base_warnings);
+  if (rtn != SUCCESS) {
+    for (std::size_t k = 0; k < n_cells; k++) {
+      out.A__db[k] = NAN;
+      out.status[k] = rtn;
+      out.warnings[k] = base_warnings;
+      out.lat[k] = NAN;
+      out.lon[k] = NAN;
+    }
+    return;
+  }
+
+  // one radial per chunk for balance; the state is reused across radials
+  parallel_for_scratch<RadialState>(
+      static_cast<std::size_t>(in.n_radials), n_threads, 1,
+      [&](RadialState &st, std::size_t begin, std::size_t end) {
+        for (std::size_t r = begin; r < end; r++)
+          sweep_radial(in, static_cast<int>(r), base_warnings, st, out);
+      });
+}
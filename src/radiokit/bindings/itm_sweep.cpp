@@ -0,0 +1,123 @@
+#include "itm_sweep.h"
+#include "Enums.h"
+#include "Errors.h"
+
+void itm_p2p_sweep(const P2PSweepInputs &in, QuantileMode quantiles,
+                   const P2PSweepOutputs &out) {
+  const double *pfl = in.pfl;
+  const int np = int(pfl[0]);
+
+  // average path height, ignoring the first and last 10%, as ITM_P2P_TLS_Ex
+  const int p10 = int(0.1 * np);
+  double h_sys__meter = 0;
+  for (int i = p10; i <= np - p10; i++)
+    h_sys__meter += pfl[i + 2];
+  h_sys__meter = h_sys__meter / (np - 2 * p10 + 1);
+
+  // N_s and gamma_e do not depend on frequency; Z_g does and is redone below
+  complex<double> Z_g;
+  double gamma_e, N_s;
+  InitializePointToPoint(in.f__mhz[0], h_sys__meter, in.N_0, in.pol,
+                         in.epsilon, in.sigma, &Z_g, &gamma_e, &N_s);
+
+  const double h__meter[2] = {in.h_tx__meter, in.h_rx__meter};
+  double theta_hzn[2], d_hzn__meter[2], h_e__meter[2];
+  double delta_h__meter, d__meter;
+  QuickPfl(pfl, gamma_e, h__meter, theta_hzn, d_hzn__meter, h_e__meter,
+           &delta_h__meter, &d__meter);
+
+  IntermediateValues &geometry = *out.geometry;
+  for (int i = 0; i < 2; i++) {
+    geometry.theta_hzn[i] = theta_hzn[i];
+    geometry.d_hzn__meter[i] = d_hzn__meter[i];
+    geometry.h_e__meter[i] = h_e__meter[i];
+  }
+  geometry.N_s = N_s;
+  geometry.delta_h__meter = delta_h__meter;
+  geometry.d__km = (pfl[0] * pfl[1]) / 1000;
+  geometry.A_ref__db = NAN;
+  geometry.A_fs__db = NAN;
+  geometry.mode = MODE__NOT_SET;
+
+  const std::size_t width = quantiles == QuantileMode::CR ? 2 : 3;
+
+  for (std::size_t f = 0; f < in.n_freqs; f++) {
+    const double f__mhz = in.f__mhz[f];
+    InitializePointToPoint(f__mhz, h_sys__meter, in.N_0, in.pol, in.epsilon,
+                           in.sigma, &Z_g, &gamma_e, &N_s);
+
+    // LongleyRice runs on the first quantile that passes validation
+    bool have_ref = false;
+    int ref_rtn = SUCCESS;
+    long ref_warnings = NO_WARNINGS;
+    double A_ref__db = 0;
+    double A_fs__db = NAN;
+    int propmode = MODE__NOT_SET;
+
+    out.A_ref__db[f] = NAN;
+    out.A_fs__db[f] = NAN;
+    out.mode[f] = MODE__NOT_SET;
+
+    for (std::size_t q = 0; q < in.n_quantiles; q++) {
+      const double *row = in.quantiles + q * width;
+      double time, location, situation;
+      if (quantiles == QuantileMode::CR) {
+        time = row[1];
+        location = 50;
+        situation = row[0];
+      } else {
+        time = row[0];
+        location = row[1];
+        situation = row[2];
+      }
+
+      const std::size_t k = f * in.n_quantiles + q;
+      double A__db = NAN;
+      long warnings = NO_WARNINGS;
+
+      int rtn = ValidateInputs(in.h_tx__meter, in.h_rx__meter, in.climate,
+                               time, location, situation, in.N_0, f__mhz,
+                               in.pol, in.epsilon, in.sigma, in.mdvar,
+                               &warnings);
+      if (rtn == SUCCESS) {
+        if (!have_ref) {
+          ref_rtn = LongleyRice(theta_hzn, f__mhz, Z_g, d_hzn__meter,
+                                h_e__meter, gamma_e, N_s, delta_h__meter,
+                                h__meter, d__meter, MODE__P2P, &A_ref__db,
+                                &ref_warnings, &propmode);
+          have_ref = true;
+
+          if (ref_rtn == SUCCESS) {
+            A_fs__db = FreeSpaceLoss(d__meter, f__mhz);
+            out.A_ref__db[f] = A_ref__db;
+            out.A_fs__db[f] = A_fs__db;
+            out.mode[f] = propmode;
+          }
+        }
+
+        warnings |= ref_warnings;
+        if (ref_rtn != SUCCESS)
+          rtn = ref_rtn;
+        else {
+          A__db = Variability(time, location, situation, h_e__meter,
+                              delta_h__meter, f__mhz, d__meter, A_ref__db,
+                              in.climate, in.mdvar, &warnings) +
+                  A_fs__db;
+          rtn = warnings != NO_WARNINGS ? SUCCESS_WITH_WARNINGS : SUCCESS;
+        }
+      }
+
+      // report CR inputs under their own error codes, as ITM_P2P_CR_Ex does
+      if (quantiles == QuantileMode::CR) {
+        if (rtn == ERROR__INVALID_TIME)
+          rtn = ERROR__INVALID_RELIABILITY;
+        else if (rtn == ERROR__INVALID_SITUATION)
+          rtn = ERROR__INVALID_CONFIDENCE;
+      }
+
+      out.A__db[k] = A__db;
+      out.status[k] = rtn;
+      out.warnings[k] = warnings;
+    }
+  }
+}
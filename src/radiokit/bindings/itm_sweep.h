@@ -0,0 +1,49 @@
+#pragma once
+
+#include "itm.h"
+#include "itm_batch.h"
+#include <cstddef>
+#include <cstdint>
+
+// One profile evaluated at several frequencies and several variability
+// quantiles. In TLS mode each quantile row is (time, location, situation);
+// in CR mode it is (confidence, reliability).
+struct P2PSweepInputs {
+  const double *pfl;
+  double h_tx__meter;
+  double h_rx__meter;
+  int climate;
+  double N_0;
+  int pol;
+  double epsilon;
+  double sigma;
+  int mdvar;
+
+  std::size_t n_freqs;
+  const double *f__mhz;
+
+  std::size_t n_quantiles;
+  const double *quantiles;
+};
+
+// Preallocated outputs. Loss, status and warnings are [n_freqs][n_quantiles];
+// the reference attenuation, free space loss and mode are per frequency.
+// geometry receives the frequency-independent intermediate values.
+struct P2PSweepOutputs {
+  double *A__db;
+  std::int32_t *status;
+  std::int64_t *warnings;
+
+  double *A_ref__db;
+  double *A_fs__db;
+  std::int32_t *mode;
+
+  IntermediateValues *geometry;
+};
+
+// Loss matrix for one profile. The terrain geometry (QuickPfl) and the
+// effective earth are computed once, LongleyRice once per frequency and
+// Variability once per (frequency, quantile). Each cell matches the
+// corresponding ITM_P2P_TLS_Ex / ITM_P2P_CR_Ex call exactly.
+void itm_p2p_sweep(const P2PSweepInputs &in, QuantileMode quantiles,
+                   const P2PSweepOutputs &out);
@@ -0,0 +1,451 @@
+#include "link_cache.h"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char kLinkCacheMagic[8] = {'R', 'K', 'L', 'I', 'N', 'K', 0, 0};
+
+// One stored link. The check word covers every other field and is written
+// last; it is zero only in slots that were never filled.
+struct LinkCacheRecord {
+  std::uint64_t key[2];
+  std::uint64_t check;
+  std::int32_t status;
+  std::int32_t mode;
+  std::int64_t warnings;
+  double A__db;
+  double theta_hzn[2];
+  double d_hzn__meter[2];
+  double h_e__meter[2];
+  double N_s;
+  double delta_h__meter;
+  double A_ref__db;
+  double A_fs__db;
+  double d__km;
+};
+
+static_assert(sizeof(LinkCacheRecord) == 136,
+              "LinkCacheRecord must keep its on-disk size");
+
+static const std::size_t kSegmentBytes =
+    kLinkCacheSegmentRecords * sizeof(LinkCacheRecord);
+
+// Slot of record index within the mapped segments
+static LinkCacheRecord *record_at(const std::vector<char *> &segments,
+                                  std::uint64_t index) {
+  return reinterpret_cast<LinkCacheRecord *>(
+             segments[index / kLinkCacheSegmentRecords]) +
+         index % kLinkCacheSegmentRecords;
+}
+
+static std::uint64_t rotl(std::uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+// splitmix64 finalizer
+static std::uint64_t mix(std::uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+// Two multiply-rotate lanes with different seeds over a sequence of 64-bit
+// words. Plenty to tell links apart; not meant to resist inputs built to
+// collide.
+class KeyHasher {
+public:
+  KeyHasher() : a_(0x9E3779B97F4A7C15ULL), b_(0xC2B2AE3D27D4EB4FULL), n_(0) {}
+
+  void add(std::uint64_t word) {
+    a_ = rotl(a_ ^ word, 31) * 0x87C37B91114253D5ULL;
+    b_ = (rotl(b_, 27) + word) * 0x4CF5AD432745937FULL;
+    n_++;
+  }
+
+  void add(double x) {
+    // -0 and +0 hash alike
+    if (x == 0)
+      x = 0;
+    std::uint64_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    add(bits);
+  }
+
+  void add(double x, double step) {
+    add(step > 0 ? std::round(x / step) : x);
+  }
+
+  // n values bit for bit, spread over four independent lanes so long
+  // profiles hash at memory speed rather than at one multiply latency per
+  // sample
+  void add(const double *x, std::size_t n) {
+    std::uint64_t lane[4] = {a_, b_, ~a_, ~b_};
+    std::size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+      std::uint64_t words[4];
+      std::memcpy(words, x + k, sizeof(words));
+      for (int l = 0; l < 4; l++)
+        lane[l] = rotl(lane[l] ^ words[l], 31) * 0x87C37B91114253D5ULL;
+    }
+    for (int l = 0; l < 4; l++)
+      add(lane[l]);
+    for (; k < n; k++) {
+      std::uint64_t word;
+      std::memcpy(&word, x + k, sizeof(word));
+      add(word);
+    }
+    add(static_cast<std::uint64_t>(n));
+  }
+
+  LinkKey finish() const {
+    LinkKey key;
+    key.hi = mix(a_ ^ n_);
+    key.lo = mix(b_ + a_);
+    return key;
+  }
+
+private:
+  std::uint64_t a_;
+  std::uint64_t b_;
+  std::uint64_t n_;
+};
+
+static std::uint64_t record_check(const LinkCacheRecord &record) {
+  std::uint64_t words[sizeof(LinkCacheRecord) / 8];
+  std::memcpy(words, &record, sizeof(record));
+  KeyHasher hasher;
+  for (std::size_t k = 0; k < sizeof(words) / 8; k++)
+    if (k != 2)
+      hasher.add(words[k]);
+  const std::uint64_t check = hasher.finish().hi;
+  return check ? check : 1;
+}
+
+LinkKey LinkCache::key(QuantileMode quantiles, bool vectorized,
+                       double h_tx__meter, double h_rx__meter,
+                       const double *pfl, int climate, double N_0,
+                       double f__mhz, int pol, double epsilon, double sigma,
+                       int mdvar, double time, double location,
+                       double situation) const {
+  KeyHasher hasher;
+  hasher.add(static_cast<std::uint64_t>(quantiles == QuantileMode::CR) |
+             static_cast<std::uint64_t>(vectorized) << 1);
+  hasher.add(h_tx__meter, quanta_.height__meter);
+  hasher.add(h_rx__meter, quanta_.height__meter);
+  hasher.add(static_cast<std::uint64_t>(climate));
+  hasher.add(N_0, quanta_.N_0);
+  hasher.add(f__mhz, quanta_.f__mhz);
+  hasher.add(static_cast<std::uint64_t>(pol));
+  hasher.add(epsilon, quanta_.ground);
+  hasher.add(sigma, quanta_.ground);
+  hasher.add(static_cast<std::uint64_t>(mdvar));
+  hasher.add(time, quanta_.percent);
+  // ITM_P2P_CR_Ex has no location input
+  if (quantiles == QuantileMode::TLS)
+    hasher.add(location, quanta_.percent);
+  hasher.add(situation, quanta_.percent);
+
+  hasher.add(pfl, static_cast<std::size_t>(pfl[0]) + 3);
+  return hasher.finish();
+}
+
+LinkCache::LinkCache(const std::string &path, bool writable,
+                     const LinkCacheQuanta &quanta)
+    : writable_(writable), quanta_(quanta),
+      segments_(kLinkCacheMaxSegments, nullptr), n_segments_(0), records_(0),
+      hits_(0), misses_(0), inserts_(0) {
+  LinkCacheFileHeader header;
+  std::uint64_t file_size;
+  bool read_ok;
+
+#ifdef _WIN32
+  // a writer shares the file with readers only, so a second writer fails to
+  // open it
+  file_ = CreateFileA(path.c_str(),
+                      writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                      writable ? FILE_SHARE_READ
+                               : FILE_SHARE_READ | FILE_SHARE_WRITE,
+                      NULL, writable ? OPEN_ALWAYS : OPEN_EXISTING,
+                      FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file_ == INVALID_HANDLE_VALUE)
+    throw std::runtime_error(writable && GetLastError() ==
+                                     ERROR_SHARING_VIOLATION
+                                 ? "link cache " + path +
+                                       " is open for writing elsewhere"
+                                 : "cannot open link cache " + path);
+
+  LARGE_INTEGER size;
+  read_ok = GetFileSizeEx(file_, &size) != 0;
+  file_size = read_ok ? static_cast<std::uint64_t>(size.QuadPart) : 0;
+#else
+  fd_ = open(path.c_str(), writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+  if (fd_ < 0)
+    throw std::runtime_error("cannot open link cache " + path);
+  if (writable && flock(fd_, LOCK_EX | LOCK_NB) != 0) {
+    close(fd_);
+    throw std::runtime_error("link cache " + path +
+                             " is open for writing elsewhere");
+  }
+
+  struct stat st;
+  read_ok = fstat(fd_, &st) == 0;
+  file_size = read_ok ? static_cast<std::uint64_t>(st.st_size) : 0;
+#endif
+
+  // a new cache starts as a bare header
+  if (read_ok && writable && file_size == 0) {
+    std::vector<char> bytes(kLinkCacheHeaderBytes, 0);
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kLinkCacheMagic, sizeof(kLinkCacheMagic));
+    header.version = kLinkCacheFormatVersion;
+    header.record_size = sizeof(LinkCacheRecord);
+    header.quanta = quanta;
+    std::memcpy(bytes.data(), &header, sizeof(header));
+#ifdef _WIN32
+    DWORD written = 0;
+    read_ok = WriteFile(file_, bytes.data(), DWORD(bytes.size()), &written,
+                        NULL) &&
+              written == bytes.size();
+#else
+    read_ok = pwrite(fd_, bytes.data(), bytes.size(), 0) ==
+              static_cast<ssize_t>(bytes.size());
+#endif
+    file_size = kLinkCacheHeaderBytes;
+  }
+
+  if (read_ok) {
+#ifdef _WIN32
+    LARGE_INTEGER start;
+    start.QuadPart = 0;
+    DWORD read = 0;
+    read_ok = SetFilePointerEx(file_, start, NULL, FILE_BEGIN) &&
+              ReadFile(file_, &header, sizeof(header), &read, NULL) &&
+              read == sizeof(header);
+#else
+    read_ok = pread(fd_, &header, sizeof(header), 0) ==
+              static_cast<ssize_t>(sizeof(header));
+#endif
+  }
+
+  const char *problem = nullptr;
+  if (!read_ok)
+    problem = " cannot be read";
+  else if (std::memcmp(header.magic, kLinkCacheMagic,
+                       sizeof(kLinkCacheMagic)) != 0)
+    problem = " is not a link cache";
+  else if (header.version != kLinkCacheFormatVersion ||
+           header.record_size != sizeof(LinkCacheRecord))
+    problem = " has an unsupported format version";
+  else if (file_size < kLinkCacheHeaderBytes ||
+           (file_size - kLinkCacheHeaderBytes) % kSegmentBytes != 0 ||
+           (file_size - kLinkCacheHeaderBytes) / kSegmentBytes >
+               kLinkCacheMaxSegments)
+    problem = " has a corrupt size";
+
+  if (!problem) {
+    quanta_ = header.quanta;
+    const std::size_t n_segments = static_cast<std::size_t>(
+        (file_size - kLinkCacheHeaderBytes) / kSegmentBytes);
+    for (; n_segments_ < n_segments; n_segments_++) {
+      segments_[n_segments_] = map_segment(n_segments_);
+      if (!segments_[n_segments_]) {
+        problem = " cannot be mapped";
+        break;
+      }
+    }
+  }
+
+  // index every complete record up to the first slot that is not
+  if (!problem) {
+    const std::uint64_t capacity =
+        static_cast<std::uint64_t>(n_segments_) * kLinkCacheSegmentRecords;
+    for (; records_ < capacity; records_++) {
+      const LinkCacheRecord *record = record_at(segments_, records_);
+      if (record->check == 0 || record->check != record_check(*record))
+        break;
+      const LinkKey key = {record->key[0], record->key[1]};
+      shard(key).index.emplace(key, records_);
+    }
+  }
+
+  if (problem) {
+    release();
+    throw std::runtime_error("link cache " + path + problem);
+  }
+}
+
+LinkCache::~LinkCache() { release(); }
+
+void LinkCache::release() {
+  for (std::size_t s = 0; s < n_segments_; s++) {
+#ifdef _WIN32
+    UnmapViewOfFile(segments_[s]);
+#else
+    munmap(segments_[s], kSegmentBytes);
+#endif
+  }
+  n_segments_ = 0;
+
+  // closing the file also releases the writer's lock
+#ifdef _WIN32
+  CloseHandle(file_);
+#else
+  close(fd_);
+#endif
+}
+
+LinkCacheStats LinkCache::stats() const {
+  LinkCacheStats result;
+  result.hits = hits_.load();
+  result.misses = misses_.load();
+  result.inserts = inserts_.load();
+  std::lock_guard<std::mutex> lock(mutex_);
+  result.records = records_;
+  return result;
+}
+
+char *LinkCache::map_segment(std::size_t segment) {
+  const std::uint64_t offset =
+      kLinkCacheHeaderBytes +
+      static_cast<std::uint64_t>(segment) * kSegmentBytes;
+#ifdef _WIN32
+  // a writable mapping sized past the end of the file extends it
+  const std::uint64_t end = offset + kSegmentBytes;
+  HANDLE mapping = CreateFileMappingA(
+      file_, NULL, writable_ ? PAGE_READWRITE : PAGE_READONLY,
+      DWORD(end >> 32), DWORD(end & 0xFFFFFFFF), NULL);
+  if (!mapping)
+    return nullptr;
+  void *data =
+      MapViewOfFile(mapping, writable_ ? FILE_MAP_WRITE : FILE_MAP_READ,
+                    DWORD(offset >> 32), DWORD(offset & 0xFFFFFFFF),
+                    kSegmentBytes);
+  // the view keeps the mapping alive
+  CloseHandle(mapping);
+  return static_cast<char *>(data);
+#else
+  void *data = mmap(nullptr, kSegmentBytes,
+                    writable_ ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED,
+                    fd_, static_cast<off_t>(offset));
+  return data == MAP_FAILED ? nullptr : static_cast<char *>(data);
+#endif
+}
+
+// Add a zero-filled segment to the end of the file; called with mutex_ held
+bool LinkCache::grow() {
+  if (n_segments_ == kLinkCacheMaxSegments)
+    return false;
+#ifndef _WIN32
+  const off_t size = static_cast<off_t>(
+      kLinkCacheHeaderBytes +
+      static_cast<std::uint64_t>(n_segments_ + 1) * kSegmentBytes);
+  if (ftruncate(fd_, size) != 0)
+    return false;
+#endif
+  char *data = map_segment(n_segments_);
+  if (!data)
+    return false;
+  segments_[n_segments_++] = data;
+  return true;
+}
+
+bool LinkCache::lookup(const LinkKey &key, LinkResult *result) const {
+  Shard &s = shard(key);
+  std::uint64_t index;
+  {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    const auto found = s.index.find(key);
+    if (found == s.index.end()) {
+      misses_++;
+      return false;
+    }
+    index = found->second;
+  }
+  hits_++;
+
+  // records never change once indexed
+  const LinkCacheRecord &record = *record_at(segments_, index);
+  result->status = record.status;
+  result->A__db = record.A__db;
+  result->warnings = static_cast<long>(record.warnings);
+  IntermediateValues &values = result->values;
+  for (int t = 0; t < 2; t++) {
+    values.theta_hzn[t] = record.theta_hzn[t];
+    values.d_hzn__meter[t] = record.d_hzn__meter[t];
+    values.h_e__meter[t] = record.h_e__meter[t];
+  }
+  values.N_s = record.N_s;
+  values.delta_h__meter = record.delta_h__meter;
+  values.A_ref__db = record.A_ref__db;
+  values.A_fs__db = record.A_fs__db;
+  values.d__km = record.d__km;
+  values.mode = record.mode;
+  return true;
+}
+
+bool LinkCache::insert(const LinkKey &key, const LinkResult &result) {
+  if (!writable_)
+    return false;
+
+  LinkCacheRecord fields;
+  std::memset(&fields, 0, sizeof(fields));
+  fields.key[0] = key.hi;
+  fields.key[1] = key.lo;
+  fields.status = result.status;
+  fields.mode = result.values.mode;
+  fields.warnings = result.warnings;
+  fields.A__db = result.A__db;
+  for (int t = 0; t < 2; t++) {
+    fields.theta_hzn[t] = result.values.theta_hzn[t];
+    fields.d_hzn__meter[t] = result.values.d_hzn__meter[t];
+    fields.h_e__meter[t] = result.values.h_e__meter[t];
+  }
+  fields.N_s = result.values.N_s;
+  fields.delta_h__meter = result.values.delta_h__meter;
+  fields.A_ref__db = result.values.A_ref__db;
+  fields.A_fs__db = result.values.A_fs__db;
+  fields.d__km = result.values.d__km;
+  const std::uint64_t check = record_check(fields);
+
+  // holding the shard across the append keeps two workers that missed on
+  // the same link from storing it twice
+  Shard &s = shard(key);
+  std::lock_guard<std::mutex> shard_lock(s.mutex);
+  if (s.index.count(key))
+    return false;
+
+  std::uint64_t index;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::uint64_t capacity =
+        static_cast<std::uint64_t>(n_segments_) * kLinkCacheSegmentRecords;
+    if (records_ == capacity && !grow())
+      return false;
+    index = records_;
+
+    // the check word goes in last, so a reader in another process never
+    // takes a half-written slot for a record
+    LinkCacheRecord *record = record_at(segments_, index);
+    std::memcpy(record, &fields, sizeof(fields));
+    std::atomic_thread_fence(std::memory_order_release);
+    record->check = check;
+    records_++;
+  }
+
+  s.index.emplace(key, index);
+  inserts_++;
+  return true;
+}
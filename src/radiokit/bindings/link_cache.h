@@ -0,0 +1,152 @@
+#pragma once
+
+#include "itm.h"
+#include "itm_batch.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Persistent store of point-to-point link results, appended to as links are
+// evaluated and read back through memory-mapped segments. The layout is
+//
+//   [0, kLinkCacheHeaderBytes)   LinkCacheFileHeader, zero padded
+//   segment s                    kLinkCacheSegmentRecords LinkCacheRecords at
+//                                kLinkCacheHeaderBytes + s * segment bytes
+//
+// Records are only ever added after the last complete one. The file grows a
+// whole zero-filled segment at a time, and a record counts once its check
+// word matches its contents, so a reader that opens the file while it is
+// being written, or after a writer was interrupted, stops at the last
+// complete record. Segments, like DEM tiles, start on a mapping boundary on
+// both POSIX and Windows.
+const std::size_t kLinkCacheHeaderBytes = 65536;
+const std::size_t kLinkCacheSegmentRecords = 65536;
+const std::size_t kLinkCacheMaxSegments = 4096;
+const std::uint32_t kLinkCacheFormatVersion = 1;
+
+// Steps the link parameters are rounded to before hashing, so values that
+// differ by float noise share an entry; zero hashes a parameter exactly.
+// Terrain profiles are always hashed bit for bit. The steps a cache file was
+// created with are stored in its header and used from then on.
+struct LinkCacheQuanta {
+  double height__meter; // h_tx, h_rx
+  double N_0;
+  double f__mhz;
+  double ground;  // epsilon, sigma
+  double percent; // time, location, situation
+};
+
+const LinkCacheQuanta kDefaultLinkCacheQuanta = {1e-3, 1e-3, 1e-6, 1e-6, 1e-6};
+
+struct LinkCacheFileHeader {
+  char magic[8]; // "RKLINK\0\0"
+  std::uint32_t version;
+  std::uint32_t record_size;
+  LinkCacheQuanta quanta;
+};
+
+// 128-bit hash of a link's terrain profile and quantized parameters
+struct LinkKey {
+  std::uint64_t hi;
+  std::uint64_t lo;
+
+  bool operator==(const LinkKey &o) const { return hi == o.hi && lo == o.lo; }
+};
+
+struct LinkKeyHash {
+  std::size_t operator()(const LinkKey &key) const {
+    return static_cast<std::size_t>(key.lo);
+  }
+};
+
+// What ITM_P2P_TLS_Ex returns for one link
+struct LinkResult {
+  int status;
+  double A__db;
+  long warnings;
+  IntermediateValues values;
+};
+
+// Lookups since the cache was opened
+struct LinkCacheStats {
+  std::uint64_t hits;
+  std::uint64_t misses;
+  std::uint64_t inserts; // records appended since opening
+  std::uint64_t records; // complete records in the file
+};
+
+// Link results keyed by LinkKey. Any number of processes may open the same
+// file read-only while one process holds it open for writing; readers see
+// the records that were complete when they opened it. Within a process all
+// member functions are safe to call from several threads at once, and
+// lookups of different keys rarely contend. Errors opening a cache throw
+// std::runtime_error.
+class LinkCache {
+public:
+  // Open the cache at path, creating it with quanta when it does not exist
+  // and writable is set
+  LinkCache(const std::string &path, bool writable = true,
+            const LinkCacheQuanta &quanta = kDefaultLinkCacheQuanta);
+  ~LinkCache();
+
+  LinkCache(const LinkCache &) = delete;
+  LinkCache &operator=(const LinkCache &) = delete;
+
+  bool writable() const { return writable_; }
+  const LinkCacheQuanta &quanta() const { return quanta_; }
+  LinkCacheStats stats() const;
+
+  // Key of a link as itm_p2p_link takes it. Results of the vectorized batch
+  // path differ from the single-link functions by rounding, so they are
+  // keyed apart.
+  LinkKey key(QuantileMode quantiles, bool vectorized, double h_tx__meter,
+              double h_rx__meter, const double *pfl, int climate, double N_0,
+              double f__mhz, int pol, double epsilon, double sigma, int mdvar,
+              double time, double location, double situation) const;
+
+  // Copy the result stored under key into result; false when there is none
+  bool lookup(const LinkKey &key, LinkResult *result) const;
+
+  // Append result under key. Returns false when the key is already stored,
+  // the cache is read-only or the file cannot grow.
+  bool insert(const LinkKey &key, const LinkResult &result);
+
+private:
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<LinkKey, std::uint64_t, LinkKeyHash> index;
+  };
+  static const int kShards = 16;
+
+  Shard &shard(const LinkKey &key) const {
+    return shards_[key.hi % kShards];
+  }
+  char *map_segment(std::size_t segment);
+  bool grow();
+  void release();
+
+  bool writable_;
+  LinkCacheQuanta quanta_;
+
+#ifdef _WIN32
+  void *file_;
+#else
+  int fd_;
+#endif
+
+  // segments_[s] stays fixed once mapped, so readers use it without mutex_
+  // after finding a record through its shard
+  std::vector<char *> segments_;
+  std::size_t n_segments_;
+  std::uint64_t records_;
+  mutable std::mutex mutex_; // n_segments_, records_ and appends
+
+  mutable Shard shards_[kShards];
+  mutable std::atomic<std::uint64_t> hits_;
+  mutable std::atomic<std::uint64_t> misses_;
+  std::atomic<std::uint64_t> inserts_;
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Resolve a requested worker count; zero or negative means "one per core"
+inline int resolve_thread_count(int n_threads) {
+  if (n_threads > 0)
+    return n_threads;
+  const unsigned hw = std::thread::hardware_concurrency();
+  return hw == 0 ? 1 : static_cast<int>(hw);
+}
+
+// Run fn(scratch, begin, end) over [0, n) in chunks pulled from a shared
+// counter by a pool of worker threads. Each worker default-constructs one
+// Scratch and hands it to every chunk it runs, so buffers kept in it are
+// allocated once per worker rather than once per chunk. The calling thread
+// takes part in the work, so a single-thread request never spawns anything.
+// fn must not throw.
+template <typename Scratch, typename Fn>
+void parallel_for_scratch(std::size_t n, int n_threads, std::size_t chunk,
+                          Fn fn) {
+  if (n == 0)
+    return;
+  chunk = std::max<std::size_t>(chunk, 1);
+
+  const std::size_t n_chunks = (n + chunk - 1) / chunk;
+  const std::size_t n_workers = std::min<std::size_t>(
+      static_cast<std::size_t>(resolve_thread_count(n_threads)), n_chunks);
+
+  if (n_workers <= 1) {
+    Scratch scratch;
+    fn(scratch, std::size_t(0), n);
+    return;
+  }
+
+  std::atomic<std::size_t> next(0);
+  auto work = [&]() {
+    Scratch scratch;
+    for (;;) {
+      const std::size_t begin = next.fetch_add(chunk);
+      if (begin >= n)
+        break;
+      fn(scratch, begin, std::min(begin + chunk, n));
+    }
+  };
+
+  std::vector<std::thread> workers;
+  workers.reserve(n_workers - 1);
+  for (std::size_t t = 1; t < n_workers; t++)
+    workers.emplace_back(work);
+  work();
+  for (std::size_t t = 0; t < workers.size(); t++)
+    workers[t].join();
+}
+
+// Run fn(begin, end) over [0, n), as parallel_for_scratch without scratch
+template <typename Fn>
+void parallel_for(std::size_t n, int n_threads, std::size_t chunk, Fn fn) {
+  struct NoScratch {};
+  parallel_for_scratch<NoScratch>(
+      n, n_threads, chunk,
+      [&](NoScratch &, std::size_t begin, std::size_t end) {
+        fn(begin, end);
+      });
+}
@@ -1,4 +1,5 @@
-from typing import List, Literal
+from typing import List, Literal, Tuple
+import numpy as np
 from pydantic import BaseModel, Field, model_validator
 from radiokit.bindings import itm_bindings
 
@@ -47,8 +48,9 @@ class PointToPointModel(BaseModel):
         if not pfl or not distance_km:
             raise ValueError("Both 'pfl' and 'distance_km' must be provided.")
 
+        # ITM takes the number of intervals, one less than the samples
         spacing = distance_km * 1000 / (len(pfl) - 1)
-        pfl_with_spacing = [len(pfl), spacing, *pfl]
+        pfl_with_spacing = [len(pfl) - 1, spacing, *pfl]
         values["pfl"] = pfl_with_spacing
         return values
 
@@ -80,7 +82,15 @@ def point_to_point(
     time: float,
     location: float,
     situation: float,
+    cache=None,
 ) -> dict:
+    """
+    Point-to-point loss for one link.
+
+    Args:
+        cache: An itm_bindings.LinkCache. A link it already holds skips ITM,
+            and any other link is added to it.
+    """
     if climate not in CLIMATE_MAPPING:
         raise ValueError(
             f"Invalid climate: {climate}. Must be one of {list(CLIMATE_MAPPING.keys())}"
@@ -105,8 +115,7 @@ def point_to_point(
         situation=situation,
     )
 
-    # Call the C++ binding
-    status, loss_db, warnings = itm_bindings.itm_p2p_tls(
+    args = (
         inputs.h_tx,
         inputs.h_rx,
         inputs.pfl,
@@ -122,8 +131,511 @@ def point_to_point(
         inputs.situation,
     )
 
+    # Call the C++ binding
+    if cache is None:
+        status, loss_db, warnings = itm_bindings.itm_p2p_tls(*args)
+    else:
+        status, loss_db, warnings, _ = itm_bindings.itm_p2p_tls_ex(*args, cache=cache)
+
+    return {
+        "status": status,
+        "loss_db": loss_db,
+        "warnings": warnings,
+    }
+
+
+def point_to_point_batch(
+    h_tx,
+    h_rx,
+    elevations,
+    distance_km,
+    climate: str,
+    N_0,
+    f_mhz,
+    pol,
+    epsilon,
+    sigma,
+    mdvar,
+    time,
+    location,
+    situation,
+    n_threads: int = 0,
+    vectorized: bool = False,
+    cache=None,
+) -> dict:
+    """
+    Point-to-point loss for many links of equal sample count in one native call.
+
+    Args:
+        elevations: Array of shape (n_links, n_points) with one terrain profile per row.
+        distance_km: Path distance of each link (scalar or one value per link).
+        n_threads: Worker threads to use, 0 for one per core.
+        vectorized: Evaluate the links several at a time in SIMD registers.
+            Losses then match point_to_point to within rounding, not exactly.
+        cache: An itm_bindings.LinkCache. Links it already holds skip ITM,
+            and the others are added to it.
+
+        The remaining parameters match point_to_point and may each be a scalar
+        or an array with one value per link.
+
+    Returns:
+        dict: Arrays of status codes, losses, warning bitmasks and intermediate values.
+    """
+    if climate not in CLIMATE_MAPPING:
+        raise ValueError(
+            f"Invalid climate: {climate}. Must be one of {list(CLIMATE_MAPPING.keys())}"
+        )
+
+    elevations = np.atleast_2d(np.asarray(elevations, dtype=np.float64))
+    n_links, n_points = elevations.shape
+    if n_points < 2:
+        raise ValueError("Each profile needs at least two elevation samples.")
+
+    distance_km = np.broadcast_to(np.asarray(distance_km, dtype=np.float64), (n_links,))
+
+    pfl = np.empty((n_links, n_points + 2))
+    pfl[:, 0] = n_points - 1
+    pfl[:, 1] = distance_km * 1000 / (n_points - 1)
+    pfl[:, 2:] = elevations
+
+    status, loss_db, warnings, values = itm_bindings.itm_p2p_tls_batch(
+        h_tx,
+        h_rx,
+        pfl,
+        CLIMATE_MAPPING[climate],
+        N_0,
+        f_mhz,
+        pol,
+        epsilon,
+        sigma,
+        mdvar,
+        time,
+        location,
+        situation,
+        n_threads=n_threads,
+        vectorized=vectorized,
+        cache=cache,
+    )
+
+    return {
+        "status": status,
+        "loss_db": loss_db,
+        "warnings": warnings,
+        "intermediate_values": values,
+    }
+
+
+def point_to_point_dem(
+    store,
+    tx_lat,
+    tx_lon,
+    rx_lat,
+    rx_lon,
+    h_tx,
+    h_rx,
+    climate: str,
+    N_0,
+    f_mhz,
+    pol,
+    epsilon,
+    sigma,
+    mdvar,
+    time,
+    location,
+    situation,
+    spacing_m: float = 30.0,
+    n_threads: int = 0,
+    vectorized: bool = False,
+    cache=None,
+) -> dict:
+    """
+    Point-to-point loss for many links with terrain read from a DEM tile store.
+
+    Each profile follows the great circle between its endpoints and is sampled
+    bilinearly every spacing_m meters (or slightly less, so the samples divide
+    the path evenly).
+
+    Args:
+        store: An itm_bindings.DemStore, e.g. from opentopography.fetch_dem.
+        tx_lat, tx_lon, rx_lat, rx_lon: Link endpoints in degrees (scalars or
+            one value per link).
+        spacing_m: Terrain sample spacing in meters.
+        n_threads: Worker threads to use, 0 for one per core.
+        vectorized: Evaluate the links several at a time in SIMD registers.
+            Losses then match point_to_point to within rounding, not exactly.
+        cache: An itm_bindings.LinkCache. Links it already holds skip ITM,
+            and the others are added to it.
+
+        The remaining parameters match point_to_point and may each be a scalar
+        or an array with one value per link.
+
+    Returns:
+        dict: Arrays of status codes, losses, warning bitmasks and intermediate
+        values. Links whose path leaves the DEM or crosses nodata are not
+        evaluated: they get status -1, a NaN loss and NaN intermediate values.
+        Endpoints that are not finite or coincide raise ValueError.
+    """
+    if climate not in CLIMATE_MAPPING:
+        raise ValueError(
+            f"Invalid climate: {climate}. Must be one of {list(CLIMATE_MAPPING.keys())}"
+        )
+
+    endpoints = np.broadcast_arrays(
+        *(
+            np.atleast_1d(np.asarray(v, dtype=np.float64))
+            for v in (tx_lat, tx_lon, rx_lat, rx_lon)
+        )
+    )
+    pfl, offsets, missing = store.profiles(
+        *(np.ascontiguousarray(v) for v in endpoints), spacing_m, n_threads
+    )
+
+    # links with terrain missing never reach ITM or the cache
+    n_links = len(offsets)
+    on_dem = missing == 0
+
+    def on_dem_links(v):
+        v = np.asarray(v)
+        return v[on_dem] if v.ndim == 1 and v.size == n_links else v
+
+    h_tx, h_rx, N_0, f_mhz, pol, epsilon, sigma, mdvar, time, location, situation = (
+        on_dem_links(v)
+        for v in (h_tx, h_rx, N_0, f_mhz, pol, epsilon, sigma, mdvar, time, location, situation)
+    )
+
+    batch_status, batch_loss_db, batch_warnings, batch_values = itm_bindings.itm_p2p_tls_batch(
+        h_tx,
+        h_rx,
+        pfl,
+        CLIMATE_MAPPING[climate],
+        N_0,
+        f_mhz,
+        pol,
+        epsilon,
+        sigma,
+        mdvar,
+        time,
+        location,
+        situation,
+        offsets=offsets[on_dem],
+        n_threads=n_threads,
+        vectorized=vectorized,
+        cache=cache,
+    )
+
+    status = np.full(n_links, -1, dtype=batch_status.dtype)
+    loss_db = np.full(n_links, np.nan)
+    warnings = np.zeros(n_links, dtype=batch_warnings.dtype)
+    status[on_dem] = batch_status
+    loss_db[on_dem] = batch_loss_db
+    warnings[on_dem] = batch_warnings
+
+    values = {}
+    for name, v in batch_values.items():
+        values[name] = np.full(
+            (n_links,) + v.shape[1:], np.nan if v.dtype.kind == "f" else 0, dtype=v.dtype
+        )
+        values[name][on_dem] = v
+
+    return {
+        "status": status,
+        "loss_db": loss_db,
+        "warnings": warnings,
+        "intermediate_values": values,
+    }
+
+
+def best_server(
+    store,
+    tx_lat,
+    tx_lon,
+    h_tx,
+    eirp_dbm,
+    f_mhz,
+    rx_lat,
+    rx_lon,
+    h_rx,
+    sensitivity_dbm: float,
+    climate: str,
+    N_0: float,
+    pol: int,
+    epsilon: float,
+    sigma: float,
+    mdvar: int,
+    time: float,
+    location: float,
+    situation: float,
+    spacing_m: float = 30.0,
+    n_threads: int = 0,
+) -> dict:
+    """
+    Best and second-best serving transmitter for every receiver.
+
+    Links are ranked by a terrain-free lower bound on their loss, and the
+    full model only runs for transmitters that could still reach the
+    receiver's sensitivity and beat the servers already found. The result is
+    the same as evaluating every link.
+
+    Args:
+        store: An itm_bindings.DemStore, e.g. from opentopography.fetch_dem.
+        tx_lat, tx_lon: Transmitter sites in degrees.
+        h_tx, eirp_dbm, f_mhz: Per-transmitter height, EIRP and frequency
+            (scalars or one value per site).
+        rx_lat, rx_lon: Receiver locations in degrees.
+        h_rx: Receiver height (scalar or one value per receiver).
+        sensitivity_dbm: Minimum received power for a transmitter to serve.
+        spacing_m: Terrain sample spacing in meters.
+        n_threads: Worker threads to use, 0 for one per core.
+
+        The remaining parameters match point_to_point.
+
+    Returns:
+        dict: Per-receiver best and second-best transmitter indices (-1 where
+        none reaches the sensitivity), their received powers, the margin of
+        the best server above the sensitivity, and counts of pruned and
+        evaluated links.
+    """
+    if climate not in CLIMATE_MAPPING:
+        raise ValueError(
+            f"Invalid climate: {climate}. Must be one of {list(CLIMATE_MAPPING.keys())}"
+        )
+
+    best, margin_db, second, values = itm_bindings.itm_best_server_tls(
+        store,
+        np.atleast_1d(tx_lat),
+        np.atleast_1d(tx_lon),
+        h_tx,
+        eirp_dbm,
+        f_mhz,
+        np.atleast_1d(rx_lat),
+        np.atleast_1d(rx_lon),
+        h_rx,
+        sensitivity_dbm,
+        CLIMATE_MAPPING[climate],
+        N_0,
+        pol,
+        epsilon,
+        sigma,
+        mdvar,
+        time,
+        location,
+        situation,
+        spacing_m=spacing_m,
+        n_threads=n_threads,
+    )
+
+    return {
+        "best": best,
+        "best_dbm": values["best__dbm"],
+        "margin_db": margin_db,
+        "second": second,
+        "second_dbm": values["second__dbm"],
+        "links": values["links"],
+    }
+
+
+def radial_sweep(
+    elevation,
+    geotransform,
+    lat: float,
+    lon: float,
+    h_tx: float,
+    h_rx: float,
+    n_radials: int,
+    step_m: float,
+    n_steps: int,
+    climate: str,
+    N_0: float,
+    f_mhz: float,
+    pol: int,
+    epsilon: float,
+    sigma: float,
+    mdvar: int,
+    time: float,
+    location: float,
+    situation: float,
+    nodata: float = float("nan"),
+    n_threads: int = 0,
+) -> dict:
+    """
+    Point-to-point loss from one transmitter to receivers along evenly spaced radials.
+
+    Args:
+        elevation: 2-D elevation grid in meters, e.g. rasterio's dataset.read(1).
+        geotransform: GDAL-style geotransform of the grid in degrees,
+            e.g. dataset.transform.to_gdal().
+        lat, lon: Transmitter location in degrees.
+        n_radials: Number of radials, evenly spaced in bearing from north.
+        step_m: Receiver spacing along each radial in meters.
+        n_steps: Number of receivers per radial.
+        nodata: Elevation value marking missing data.
+
+    Returns:
+        dict: [n_radials, n_steps] arrays of status codes, losses and warning
+        bitmasks, plus the receiver coordinates.
+    """
+    if climate not in CLIMATE_MAPPING:
+        raise ValueError(
+            f"Invalid climate: {climate}. Must be one of {list(CLIMATE_MAPPING.keys())}"
+        )
+
+    status, loss_db, warnings, values = itm_bindings.itm_p2p_tls_radials(
+        elevation,
+        list(geotransform),
+        lat,
+        lon,
+        h_tx,
+        h_rx,
+        n_radials,
+        step_m,
+        n_steps,
+        CLIMATE_MAPPING[climate],
+        N_0,
+        f_mhz,
+        pol,
+        epsilon,
+        sigma,
+        mdvar,
+        time,
+        location,
+        situation,
+        nodata=nodata,
+        n_threads=n_threads,
+    )
+
+    return {
+        "status": status,
+        "loss_db": loss_db,
+        "warnings": warnings,
+        **values,
+    }
+
+
+def point_to_point_sweep(
+    h_tx: float,
+    h_rx: float,
+    pfl: List[float],
+    distance_km: float,
+    climate: str,
+    N_0: float,
+    f_mhz: List[float],
+    pol: int,
+    epsilon: float,
+    sigma: float,
+    mdvar: int,
+    quantiles: List[Tuple[float, float, float]],
+) -> dict:
+    """
+    Point-to-point loss for one path at several frequencies and reliabilities.
+
+    The terrain geometry is computed once and reused for every combination.
+
+    Args:
+        pfl: Terrain profile, a list of elevation samples in meters.
+        f_mhz: Frequencies in MHz.
+        quantiles: (time, location, situation) percentages to evaluate.
+
+        The remaining parameters match point_to_point.
+
+    Returns:
+        dict: [len(f_mhz), len(quantiles)] arrays of status codes, losses and
+        warning bitmasks, plus the intermediate values.
+    """
+    if climate not in CLIMATE_MAPPING:
+        raise ValueError(
+            f"Invalid climate: {climate}. Must be one of {list(CLIMATE_MAPPING.keys())}"
+        )
+    if len(pfl) < 2:
+        raise ValueError("The profile needs at least two elevation samples.")
+
+    spacing = distance_km * 1000 / (len(pfl) - 1)
+    profile = np.array([len(pfl) - 1, spacing, *pfl], dtype=np.float64)
+
+    status, loss_db, warnings, values = itm_bindings.itm_p2p_tls_sweep(
+        h_tx,
+        h_rx,
+        profile,
+        CLIMATE_MAPPING[climate],
+        N_0,
+        np.asarray(f_mhz, dtype=np.float64),
+        pol,
+        epsilon,
+        sigma,
+        mdvar,
+        np.asarray(quantiles, dtype=np.float64).reshape(-1, 3),
+    )
+
+    return {
+        "status": status,
+        "loss_db": loss_db,
+        "warnings": warnings,
+        "intermediate_values": values,
+    }
+
+
+def area(
+    h_tx: float,
+    h_rx: float,
+    tx_site_criteria: int,
+    rx_site_criteria: int,
+    distance_km: List[float],
+    delta_h_meter: float,
+    climate: str,
+    N_0: float,
+    f_mhz: float,
+    pol: int,
+    epsilon: float,
+    sigma: float,
+    mdvar: int,
+    time: float,
+    location: float,
+    situation: float,
+) -> dict:
+    """
+    Area mode loss at every distance of a loss-vs-distance curve.
+
+    The terminal geometry and reference lines are computed once for the whole
+    curve.
+
+    Args:
+        tx_site_criteria: 0 random, 1 careful, 2 very careful.
+        rx_site_criteria: 0 random, 1 careful, 2 very careful.
+        distance_km: Path distances in kilometers.
+        delta_h_meter: Terrain irregularity parameter in meters.
+
+        The remaining parameters match point_to_point.
+
+    Returns:
+        dict: Per-distance arrays of status codes, losses and warning
+        bitmasks, plus the intermediate values.
+    """
+    if climate not in CLIMATE_MAPPING:
+        raise ValueError(
+            f"Invalid climate: {climate}. Must be one of {list(CLIMATE_MAPPING.keys())}"
+        )
+
+    status, loss_db, warnings, values = itm_bindings.itm_area_tls_distances(
+        h_tx,
+        h_rx,
+        tx_site_criteria,
+        rx_site_criteria,
+        np.asarray(distance_km, dtype=np.float64),
+        delta_h_meter,
+        CLIMATE_MAPPING[climate],
+        N_0,
+        f_mhz,
+        pol,
+        epsilon,
+        sigma,
+        mdvar,
+        time,
+        location,
+        situation,
+    )
+
     return {
         "status": status,
         "loss_db": loss_db,
         "warnings": warnings,
+        "intermediate_values": values,
     }
@@ -1,11 +1,14 @@
 import requests
 import math
+import os
+import numpy as np
 from typing import Tuple, Literal
 from pydantic import BaseModel, Field
 from diskcache import Cache
 from rasterio.io import MemoryFile
 from typing import Dict
 import h3
+from radiokit.bindings import itm_bindings
 
 class OpenTopographyRequest(BaseModel):
     demtype: Literal[
@@ -138,6 +141,8 @@ def fetch(
     h3_elevations = {}
     with MemoryFile(geotiff_data) as memfile:
         with memfile.open() as dataset:
+            elevation = dataset.read(1)
+
             # Generate H3 cell IDs within the bounding box
             latitudes = [bbox[0] + i * (bbox[1] - bbox[0]) / 100 for i in range(101)]
             longitudes = [bbox[2] + i * (bbox[3] - bbox[2]) / 100 for i in range(101)]
@@ -149,9 +154,76 @@ def fetch(
                         # Query elevation for the H3 cell center
                         row, col = dataset.index(lon, lat)
                         if 0 <= row < dataset.height and 0 <= col < dataset.width:
-                            h3_elevations[h3_cell] = int(dataset.read(1)[row, col])
+                            h3_elevations[h3_cell] = int(elevation[row, col])
 
     # Cache and return the result
     cache[cache_key] = h3_elevations
     return h3_elevations
 
+
+def fetch_dem(
+        dataset: str,
+        lat: float,
+        lon: float,
+        radius_m: float,
+        api_key: str,
+        cache_dir: str = ".tilecache",
+        max_tiles: int = 256,
+):
+    """
+    Fetch digital elevation data from OpenTopography into a memory-mapped tile store.
+
+    The GeoTIFF is downloaded and converted once; later calls for the same
+    dataset and area open the stored tiles directly.
+
+    Args:
+        dataset (str): The DEM dataset name.
+        lat (float): Latitude of the center point.
+        lon (float): Longitude of the center point.
+        radius_m (float): Radius around the center point in meters.
+        api_key (str): API key for OpenTopography.
+        cache_dir (str): Directory holding the converted tile stores.
+        max_tiles (int): Tiles of 256 x 256 samples to keep mapped at once.
+
+    Returns:
+        itm_bindings.DemStore: Store for native profile extraction, e.g. with
+        itm.point_to_point_dem.
+    """
+    bbox = _calculate_bbox(lat, lon, radius_m)
+
+    request_data = OpenTopographyRequest(
+        demtype=dataset,
+        south=bbox[0],
+        north=bbox[1],
+        west=bbox[2],
+        east=bbox[3],
+        api_key=api_key,
+    )
+
+    os.makedirs(cache_dir, exist_ok=True)
+    path = os.path.join(
+        cache_dir, "{}_{:.6f}_{:.6f}_{:.6f}_{:.6f}.rkdem".format(dataset, *bbox)
+    )
+
+    if not os.path.exists(path):
+        url = "https://portal.opentopography.org/API/globaldem"
+        params = {
+            "demtype": request_data.demtype,
+            "south": request_data.south,
+            "north": request_data.north,
+            "west": request_data.west,
+            "east": request_data.east,
+            "API_Key": request_data.api_key,
+        }
+        response = requests.get(url, params=params, stream=True)
+        response.raise_for_status()
+
+        with MemoryFile(response.content) as memfile:
+            with memfile.open() as raster:
+                elevation = raster.read(1).astype(np.float64)
+                nodata = raster.nodata if raster.nodata is not None else math.nan
+                itm_bindings.DemStore.create(
+                    path, elevation, raster.transform.to_gdal(), nodata
+                )
+
+    return itm_bindings.DemStore(path, max_tiles)
@@ -4,6 +4,7 @@ import random
 from timeit import default_timer as timer
 from dotenv import dotenv_values
 import h3
+import numpy as np
 
 config = dotenv_values(".env")
 
@@ -68,4 +69,28 @@ print("eval time: ", end-start)
 
 with open("loss.csv","w") as f:
     for item in results.items():
-        f.write("{},{}\n".format(item[0], item[1]))
\ No newline at end of file
+        f.write("{},{}\n".format(item[0], item[1]))
+
+print("start dem profile test")
+
+store = ot.fetch_dem(dataset="SRTMGL3", lat=home_geo[0], lon=home_geo[1], radius_m=1000*100, api_key=config["OPENTOPO_API_KEY"])
+
+print("dem tiles: ", store.rows, "x", store.cols, "samples")
+
+# receivers at the H3 cells within about 75 km of home
+cells = h3.grid_disk(h3.latlng_to_cell(home_geo[0], home_geo[1], res=6), 20)
+rx = np.array([h3.cell_to_latlng(cell) for cell in cells])
+
+start = timer()
+result = itm.point_to_point_dem(
+    store, home_geo[0], home_geo[1], rx[:, 0], rx[:, 1], h_tx, h_rx, climate, N_0, f_mhz, pol, epsilon, sigma, mdvar, time, location, situation, spacing_m=90.0
+)
+end = timer()
+
+print("links: ", len(cells), "off dem: ", int((result["status"] == -1).sum()))
+print("eval time: ", end-start)
+print("tile stats: ", store.stats())
+
+with open("loss_dem.csv","w") as f:
+    for cell, loss in zip(cells, result["loss_db"]):
+        f.write("{},{}\n".format(cell, loss))
@@ -0,0 +1,58 @@
+from radiokit.bindings import itm_bindings
+from radiokit.models import itm
+import math
+import os
+import tempfile
+
+# Example parameters
+h_tx = 30.0
+h_rx = 2.0
+climate = "continental_temperate"
+N_0 = 301.0
+f_mhz = 915.0
+pol = 1
+epsilon = 15.0
+sigma = 0.005
+mdvar = 1
+time = 50.0
+location = 50.0
+situation = 50.0
+
+# 40 km of rolling terrain, 401 samples
+distance = 40.0
+pfl = [1500.0 + 80.0 * math.sin(i / 25.0) + 30.0 * math.sin(i / 7.0) for i in range(401)]
+
+print("start link cache test")
+
+with tempfile.TemporaryDirectory() as tmp:
+    cache = itm_bindings.LinkCache(os.path.join(tmp, "links.rklink"))
+
+    first = itm.point_to_point(
+        h_tx, h_rx, pfl, distance, climate, N_0, f_mhz, pol, epsilon, sigma, mdvar, time, location, situation, cache=cache
+    )
+    stats = cache.stats()
+    print("first call: ", first, stats)
+    assert first["status"] in (0, 1)
+    assert stats["misses"] == 1 and stats["hits"] == 0 and stats["inserts"] == 1
+
+    second = itm.point_to_point(
+        h_tx, h_rx, pfl, distance, climate, N_0, f_mhz, pol, epsilon, sigma, mdvar, time, location, situation, cache=cache
+    )
+    stats = cache.stats()
+    print("second call: ", second, stats)
+    assert stats["misses"] == 1 and stats["hits"] == 1
+    assert second["status"] == first["status"]
+    assert second["loss_db"] == first["loss_db"]
+
+    # a hit must stand in for a real run
+    uncached = itm.point_to_point(
+        h_tx, h_rx, pfl, distance, climate, N_0, f_mhz, pol, epsilon, sigma, mdvar, time, location, situation
+    )
+    print("uncached call: ", uncached)
+    assert uncached["status"] == second["status"]
+    assert uncached["loss_db"] == second["loss_db"]
+    assert uncached["warnings"] == second["warnings"]
+
+    del cache
+
+print("link cache ok")
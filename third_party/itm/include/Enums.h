@@ -36,4 +36,18 @@
 #define MDVAR__SINGLE_MESSAGE_MODE              0
 #define MDVAR__ACCIDENTAL_MODE                  1
 #define MDVAR__MOBILE_MODE                      2
-#define MDVAR__BROADCAST_MODE                   3
\ No newline at end of file
+#define MDVAR__BROADCAST_MODE                   3
+
+// List of SIMD instruction sets for the terrain kernels
+#define SIMD__SCALAR                            0
+#define SIMD__AVX2                              1
+#define SIMD__AVX512                            2
+
+// List of stages timed by the opt-in instrumentation
+#define STAGE__QUICK_PFL                        0
+#define STAGE__LONGLEY_RICE                     1
+#define STAGE__DIFFRACTION_LOSS                 2
+#define STAGE__TROPOSCATTER_LOSS                3
+#define STAGE__VARIABILITY                      4
+#define STAGE__LONGLEY_RICE_BATCH               5
+#define STAGE__COUNT                            6
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "itm.h"
+#include <chrono>
+
+//
+// OPT-IN STAGE TIMING
+///////////////////////////////////////////////
+
+// When instrumentation is enabled (EnableInstrumentation), each STAGE__* stage
+// accumulates its call count and wall time, and every reference attenuation
+// is counted by mode of propagation.  Stage times are inclusive, so the
+// LongleyRice time contains the DiffractionLoss and TroposcatterLoss calls it
+// makes.  When disabled, a stage costs one relaxed atomic load.
+
+struct StageTimer
+{
+    explicit StageTimer(const int stage)
+        : stage(stage), active(InstrumentationEnabled())
+    {
+        if (active)
+            start = std::chrono::steady_clock::now();
+    }
+
+    ~StageTimer()
+    {
+        if (active)
+            RecordStage(stage, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    const int stage;
+    const bool active;
+    std::chrono::steady_clock::time_point start;
+};
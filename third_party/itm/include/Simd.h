@@ -0,0 +1,28 @@
+#pragma once
+
+//
+// SIMD DISPATCH SUPPORT
+///////////////////////////////////////////////
+
+// x86 builds compile AVX2 and AVX-512 variants of the terrain kernels next to
+// the scalar code and pick one at runtime (see GetSimdLevel).  Other targets
+// only build the scalar code.
+//
+// FLATTEN inlines everything a kernel entry point calls into it, so generic
+// code templated on a lane type is compiled for the entry point's target.
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define ITM_SIMD_X86
+    #define TARGET_AVX2 __attribute__((target("avx2")))
+    #define TARGET_AVX512 __attribute__((target("avx512f")))
+    #define FLATTEN __attribute__((flatten))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #define ITM_SIMD_X86
+    #define TARGET_AVX2
+    #define TARGET_AVX512
+    #define FLATTEN
+#endif
+
+#ifdef ITM_SIMD_X86
+    #include <immintrin.h>
+#endif
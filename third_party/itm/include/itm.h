@@ -1,3 +1,5 @@
+#pragma once
+
 #include <complex>
 #include <math.h>
 #include <algorithm>
@@ -38,6 +40,51 @@ struct IntermediateValues
     int mode;                   // Mode of propagation value
 };
 
+struct ReferenceLines
+{
+    double a_e__meter;              // Effective earth radius, in meters
+    double theta_los;               // Angular distance of line-of-sight region
+    double d_sML__meter;            // Maximum line-of-sight distance for smooth earth, in meters
+    double d_ML__meter;             // Maximum line-of-sight distance for actual path, in meters
+    double d_min__meter;            // Minimum path distance without a warning, in meters
+    double M_d;                     // Slope of the diffraction line
+    double A_d0__db;                // Intercept of the diffraction line, in dB
+    double A_o__db;                 // Line-of-sight intercept, in dB
+    double kHat_1__db_per_meter;    // Line-of-sight linear coefficient
+    double kHat_2__db_per_meter;    // Line-of-sight logarithmic coefficient
+    double M_s;                     // Slope of the troposcatter line
+    double A_s0__db;                // Intercept of the troposcatter line, in dB
+    double d_x__meter;              // Diffraction-troposcatter transition distance, in meters
+};
+
+// Inputs of LongleyRiceBatch in structure-of-arrays form: element i of every
+// array belongs to link i
+struct LinkGeometry
+{
+    const double *theta_hzn[2];     // Terminal horizon angles
+    const double *d_hzn__meter[2];  // Terminal horizon distances, in meters
+    const double *h_e__meter[2];    // Terminal effective heights, in meters
+    const double *h__meter[2];      // Terminal structural heights, in meters
+    const double *delta_h__meter;   // Terrain irregularity parameter, in meters
+    const double *d__meter;         // Path distance, in meters
+    const double *Z_g_real;         // Ground impedance, real part
+    const double *Z_g_imag;         // Ground impedance, imaginary part
+    const double *gamma_e;          // Curvature of the effective earth
+    const double *N_s;              // Surface refractivity, in N-Units
+    const double *f__mhz;           // Frequency, in MHz
+};
+
+// Outputs of LongleyRiceBatch, one element per link
+struct LinkLosses
+{
+    double *A__db;                  // Basic transmission loss, in dB
+    double *A_ref__db;              // Reference attenuation, in dB
+    double *A_fs__db;               // Free space basic transmission loss, in dB
+    int *mode;                      // Mode of propagation value
+    long *warnings;                 // Warning flags, added to the values on entry
+    int *status;                    // Error code
+};
+
 /////////////////////////////
 // Main ITM Functions
 
@@ -76,26 +123,42 @@ DLLEXPORT double FFunction(const double td);
 DLLEXPORT void FindHorizons(const double pfl[], const double a_e__meter, const double h__meter[2], double theta_hzn[2], double d_hzn__meter[2]);
 DLLEXPORT double FreeSpaceLoss(const double d__meter, const double f__mhz);
 DLLEXPORT double FresnelIntegral(const double v2);
+DLLEXPORT int GetSimdLevel();
 DLLEXPORT double H0Function(const double r, double eta_s);
 DLLEXPORT double HeightFunction(const double x__km, const double K);
 DLLEXPORT void InitializeArea(const int site_criteria[2], const double gamma_e, const double delta_h__meter,
     const double h__meter[2], double h_e__meter[2], double d_hzn__meter[2], double theta_hzn[2]);
+DLLEXPORT int InitializeReferenceLines(const double theta_hzn[2], const double f__mhz, const complex<double> Z_g, const double d_hzn__meter[2],
+    const double h_e__meter[2], const double gamma_e, const double N_s, const double delta_h__meter, const double h__meter[2],
+    const int mode, ReferenceLines *lines, long *warnings);
 DLLEXPORT void InitializePointToPoint(const double f__mhz, const double h_sys__meter, const double N_0, const int pol, const double epsilon, 
     const double sigma, complex<double> *Z_g, double *gamma_e, double *N_s);
+DLLEXPORT int InitializePointToPointPath(const double h_tx__meter, const double h_rx__meter, const double pfl[], const int climate, const double N_0,
+    const double f__mhz, const int pol, const double epsilon, const double sigma, const int mdvar, const double time, const double location,
+    const double situation, complex<double> *Z_g, double *gamma_e, double *N_s, double theta_hzn[2], double d_hzn__meter[2], double h_e__meter[2],
+    double *delta_h__meter, double *d__meter, long *warnings);
 DLLEXPORT double InverseComplementaryCumulativeDistributionFunction(const double q);
 DLLEXPORT double KnifeEdgeDiffraction(const double d__meter, const double f__mhz, const double a_e__meter, const double theta_los, const double d_hzn__meter[2]);
 DLLEXPORT void LinearLeastSquaresFit(const double pfl[], const double d_start, const double d_end, double *fit_y1, double *fit_y2);
 DLLEXPORT double LineOfSightLoss(const double d__meter, const double h_e__meter[2], const complex<double> Z_g, const double delta_h__meter,
     const double M_d, const double A_d0, const double d_sML__meter, const double f__mhz);
+DLLEXPORT void LineOfSightCoefficients(const double h_e__meter[2], const complex<double> Z_g, const double delta_h__meter, const double f__mhz,
+    ReferenceLines *lines);
 DLLEXPORT int LongleyRice(const double theta_hzn[2], const double f__mhz, const complex<double> Z_g, const double d_hzn__meter[2], const double h_e__meter[2], 
     const double gamma_e, const double N_s, const double delta_h__meter, const double h__meter[2], const double d__meter, const int mode, double *A_ref__db, 
     long *warnings, int *propmode);
+DLLEXPORT void LongleyRiceBatch(const int n, const LinkGeometry *links, const int mode, const double time, const double location,
+    const double situation, const int climate, const int mdvar, const LinkLosses *losses);
 DLLEXPORT void QuickPfl(const double pfl[], const double gamma_e, const double h__meter[2], double theta_hzn[2], double d_hzn__meter[2], 
     double h_e__meter[2], double *delta_h__meter, double *d__meter);
+DLLEXPORT double ReferenceAttenuation(const ReferenceLines *lines, const double d__meter, long *warnings, int *propmode);
+DLLEXPORT int SetSimdLevel(const int level);
 DLLEXPORT double SigmaHFunction(const double delta_h__meter);
 DLLEXPORT double SmoothEarthDiffraction(const double d__meter, const double f__mhz, const double a_e__meter, const double theta_los, 
     const double d_hzn__meter[2], const double h_e__meter[2], const complex<double> Z_g);
 DLLEXPORT double TerrainRoughness(const double d__meter, const double delta_h__meter);
+DLLEXPORT void TroposcatterCoefficients(const double theta_hzn[2], const double d_hzn__meter[2], const double h_e__meter[2], const double N_s,
+    const double f__mhz, ReferenceLines *lines);
 DLLEXPORT double TroposcatterLoss(const double d__meter, const double theta_hzn[2], const double d_hzn__meter[2], const double h_e__meter[2], 
     const double a_e__meter, const double N_s, const double f__mhz, const double theta_los, double *h0);
 DLLEXPORT int ValidateInputs(const double h_tx__meter, const double h_rx__meter, const int climate, const double time,
@@ -103,3 +166,16 @@ DLLEXPORT int ValidateInputs(const double h_tx__meter, const double h_rx__meter,
     const double epsilon, const double sigma, const int mdvar, long *warnings);
 DLLEXPORT double Variability(const double time, const double location, const double situation, const double h_e__meter[2], const double delta_h__meter,
     const double f__mhz, const double d__meter, const double A_ref__db, const int climate, const int mdvar, long *warnings);
+DLLEXPORT double VariabilityLowerBound(const double time, const double location, const double situation, const double f__mhz,
+    const double d__meter, const int climate, const int mdvar);
+
+/////////////////////////////
+// Instrumentation Functions
+
+DLLEXPORT void EnableInstrumentation(const bool enable);
+DLLEXPORT bool InstrumentationEnabled();
+DLLEXPORT void ResetInstrumentation();
+DLLEXPORT void GetStageCounters(const int stage, long long *calls, double *seconds);
+DLLEXPORT long long GetModeCount(const int mode);
+DLLEXPORT void RecordStage(const int stage, const long long nanoseconds);
+DLLEXPORT void RecordMode(const int mode);
@@ -1,4 +1,4 @@
-#include "..\include\itm.h"
+#include "../include/itm.h"
 
 /*=============================================================================
  |
@@ -59,20 +59,21 @@ double ComputeDeltaH(const double pfl[], const double d_start__meter, const doub
 
     fit_y2 = (fit_y2 - fit_y1) / np_s;
 
-    std::vector<double> diffs;
-    
+    double diffs[245];                          // n is at most 10 * 25 - 5
+
     // compute the difference between fitted line and actual data
     for (int j = 0; j < n; j++)
     {
-        diffs.push_back(s[j + 2] - fit_y1);
+        diffs[j] = s[j + 2] - fit_y1;
 
         fit_y1 += fit_y2;
     }
 
-    std::nth_element(diffs.begin(), diffs.begin() + p10 - 1, diffs.end(), std::greater<double>());
+    std::nth_element(diffs, diffs + p10 - 1, diffs + n, std::greater<double>());
     const double q10 = diffs[p10 - 1];
 
-    std::nth_element(diffs.begin(), diffs.begin() + p90, diffs.end(), std::greater<double>());
+    // the first p10 values are now the largest, so q90 lies in the rest
+    std::nth_element(diffs + p10, diffs + p90, diffs + n, std::greater<double>());
     const double q90 = diffs[p90];
 
     const double delta_h_d__meter = q10 - q90;
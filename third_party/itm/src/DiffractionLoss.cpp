@@ -1,4 +1,6 @@
-#include "..\include\itm.h"
+#include "../include/itm.h"
+#include "../include/Enums.h"
+#include "../include/Instrumentation.h"
 
 /*=============================================================================
  |
@@ -25,6 +27,8 @@
 double DiffractionLoss(const double d__meter, const double d_hzn__meter[2], const double h_e__meter[2], const complex<double> Z_g, const double a_e__meter, 
     const double delta_h__meter, const double h__meter[2], const int mode, const double theta_los, const double d_sML__meter, const double f__mhz)
 {
+    StageTimer timer(STAGE__DIFFRACTION_LOSS);
+
     const double A_k__db = KnifeEdgeDiffraction(d__meter, f__mhz, a_e__meter, theta_los, d_hzn__meter);
 
     const double A_se__db = SmoothEarthDiffraction(d__meter, f__mhz, a_e__meter, theta_los, d_hzn__meter, h_e__meter, Z_g);
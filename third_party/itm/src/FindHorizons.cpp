@@ -1,4 +1,200 @@
-#include "..\include\itm.h"
+#include "../include/itm.h"
+#include "../include/Enums.h"
+#include "../include/Simd.h"
+
+// Profile points per block; the distances of a block are accumulated serially,
+// exactly as a point-by-point scan would, then the angles are vectorized
+#define HORIZON_BLOCK                           256
+
+// Largest terminal horizon angles within a block and the first point reaching each
+struct HorizonBlock
+{
+    double theta_tx;
+    double theta_rx;
+    int i_tx;
+    int i_rx;
+};
+
+/*=============================================================================
+ |
+ |  Description:  Scan points [begin, end) of a block for the terminal
+ |                horizon angles
+ |
+ |        Input:  z__meter[]        - Terrain elevations of the block
+ |                d_tx__meter[]     - Distances of the points from the TX
+ |                d_rx__meter[]     - Distances of the points from the RX
+ |                begin, end        - Points to scan
+ |                z_tx__meter       - TX antenna elevation
+ |                z_rx__meter       - RX antenna elevation
+ |                a_e__meter        - Effective earth radius, in meters
+ |
+ |      Outputs:  block             - Updated block maxima
+ |
+ |      Returns:  [None]
+ |
+ *===========================================================================*/
+static void HorizonBlock_Scalar(const double z__meter[], const double d_tx__meter[], const double d_rx__meter[], const int begin, const int end,
+    const double z_tx__meter, const double z_rx__meter, const double a_e__meter, HorizonBlock *block)
+{
+    for (int j = begin; j < end; j++)
+    {
+        const double theta_tx = (z__meter[j] - z_tx__meter) / d_tx__meter[j] - d_tx__meter[j] / (2 * a_e__meter);
+        const double theta_rx = -(z_rx__meter - z__meter[j]) / d_rx__meter[j] - d_rx__meter[j] / (2 * a_e__meter);
+
+        if (theta_tx > block->theta_tx)
+        {
+            block->theta_tx = theta_tx;
+            block->i_tx = j;
+        }
+
+        if (theta_rx > block->theta_rx)
+        {
+            block->theta_rx = theta_rx;
+            block->i_rx = j;
+        }
+    }
+}
+
+#ifdef ITM_SIMD_X86
+
+/*=============================================================================
+ |
+ |  Description:  Fold per-lane maxima into the block maxima.  Each lane kept
+ |                the first point reaching its own maximum, so ties between
+ |                lanes go to the lowest index.
+ |
+ *===========================================================================*/
+static void ReduceHorizonLanes(const double theta[], const double index[], const int lanes, double *theta_max, int *i_max)
+{
+    for (int k = 0; k < lanes; k++)
+    {
+        if (index[k] < 0)
+            continue;
+
+        if (theta[k] > *theta_max || (theta[k] == *theta_max && int(index[k]) < *i_max))
+        {
+            *theta_max = theta[k];
+            *i_max = int(index[k]);
+        }
+    }
+}
+
+/*=============================================================================
+ |
+ |  Description:  AVX2 version of HorizonBlock_Scalar over a whole block.
+ |                Uses the same operations in the same order, so the angles
+ |                are bit-identical.
+ |
+ *===========================================================================*/
+TARGET_AVX2 static void HorizonBlock_AVX2(const double z__meter[], const double d_tx__meter[], const double d_rx__meter[], const int n,
+    const double z_tx__meter, const double z_rx__meter, const double a_e__meter, HorizonBlock *block)
+{
+    const __m256d z_tx = _mm256_set1_pd(z_tx__meter);
+    const __m256d z_rx = _mm256_set1_pd(z_rx__meter);
+    const __m256d two_a_e = _mm256_set1_pd(2 * a_e__meter);
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m256d step = _mm256_set1_pd(4.0);
+
+    __m256d index = _mm256_setr_pd(0.0, 1.0, 2.0, 3.0);
+    __m256d theta_tx_max = _mm256_set1_pd(-INFINITY);
+    __m256d theta_rx_max = _mm256_set1_pd(-INFINITY);
+    __m256d i_tx = _mm256_set1_pd(-1.0);
+    __m256d i_rx = _mm256_set1_pd(-1.0);
+
+    int j = 0;
+    for (; j + 4 <= n; j += 4)
+    {
+        const __m256d z = _mm256_loadu_pd(z__meter + j);
+        const __m256d d_tx = _mm256_loadu_pd(d_tx__meter + j);
+        const __m256d d_rx = _mm256_loadu_pd(d_rx__meter + j);
+
+        const __m256d theta_tx = _mm256_sub_pd(_mm256_div_pd(_mm256_sub_pd(z, z_tx), d_tx), _mm256_div_pd(d_tx, two_a_e));
+        const __m256d theta_rx = _mm256_sub_pd(_mm256_xor_pd(_mm256_div_pd(_mm256_sub_pd(z_rx, z), d_rx), sign), _mm256_div_pd(d_rx, two_a_e));
+
+        const __m256d gt_tx = _mm256_cmp_pd(theta_tx, theta_tx_max, _CMP_GT_OQ);
+        const __m256d gt_rx = _mm256_cmp_pd(theta_rx, theta_rx_max, _CMP_GT_OQ);
+
+        theta_tx_max = _mm256_blendv_pd(theta_tx_max, theta_tx, gt_tx);
+        theta_rx_max = _mm256_blendv_pd(theta_rx_max, theta_rx, gt_rx);
+        i_tx = _mm256_blendv_pd(i_tx, index, gt_tx);
+        i_rx = _mm256_blendv_pd(i_rx, index, gt_rx);
+
+        index = _mm256_add_pd(index, step);
+    }
+
+    double theta_tx[4], at_tx[4], theta_rx[4], at_rx[4];
+    _mm256_storeu_pd(theta_tx, theta_tx_max);
+    _mm256_storeu_pd(at_tx, i_tx);
+    _mm256_storeu_pd(theta_rx, theta_rx_max);
+    _mm256_storeu_pd(at_rx, i_rx);
+
+    // leave the upper register halves clean for the SSE code that follows
+    _mm256_zeroupper();
+
+    ReduceHorizonLanes(theta_tx, at_tx, 4, &block->theta_tx, &block->i_tx);
+    ReduceHorizonLanes(theta_rx, at_rx, 4, &block->theta_rx, &block->i_rx);
+
+    HorizonBlock_Scalar(z__meter, d_tx__meter, d_rx__meter, j, n, z_tx__meter, z_rx__meter, a_e__meter, block);
+}
+
+/*=============================================================================
+ |
+ |  Description:  AVX-512 version of HorizonBlock_Scalar over a whole block
+ |
+ *===========================================================================*/
+TARGET_AVX512 static void HorizonBlock_AVX512(const double z__meter[], const double d_tx__meter[], const double d_rx__meter[], const int n,
+    const double z_tx__meter, const double z_rx__meter, const double a_e__meter, HorizonBlock *block)
+{
+    const __m512d z_tx = _mm512_set1_pd(z_tx__meter);
+    const __m512d z_rx = _mm512_set1_pd(z_rx__meter);
+    const __m512d two_a_e = _mm512_set1_pd(2 * a_e__meter);
+    const __m512i sign = _mm512_set1_epi64((long long)0x8000000000000000ULL);
+    const __m512d step = _mm512_set1_pd(8.0);
+
+    __m512d index = _mm512_setr_pd(0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0);
+    __m512d theta_tx_max = _mm512_set1_pd(-INFINITY);
+    __m512d theta_rx_max = _mm512_set1_pd(-INFINITY);
+    __m512d i_tx = _mm512_set1_pd(-1.0);
+    __m512d i_rx = _mm512_set1_pd(-1.0);
+
+    int j = 0;
+    for (; j + 8 <= n; j += 8)
+    {
+        const __m512d z = _mm512_loadu_pd(z__meter + j);
+        const __m512d d_tx = _mm512_loadu_pd(d_tx__meter + j);
+        const __m512d d_rx = _mm512_loadu_pd(d_rx__meter + j);
+
+        const __m512d theta_tx = _mm512_sub_pd(_mm512_div_pd(_mm512_sub_pd(z, z_tx), d_tx), _mm512_div_pd(d_tx, two_a_e));
+        const __m512d q_rx = _mm512_div_pd(_mm512_sub_pd(z_rx, z), d_rx);
+        const __m512d theta_rx = _mm512_sub_pd(_mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(q_rx), sign)), _mm512_div_pd(d_rx, two_a_e));
+
+        const __mmask8 gt_tx = _mm512_cmp_pd_mask(theta_tx, theta_tx_max, _CMP_GT_OQ);
+        const __mmask8 gt_rx = _mm512_cmp_pd_mask(theta_rx, theta_rx_max, _CMP_GT_OQ);
+
+        theta_tx_max = _mm512_mask_blend_pd(gt_tx, theta_tx_max, theta_tx);
+        theta_rx_max = _mm512_mask_blend_pd(gt_rx, theta_rx_max, theta_rx);
+        i_tx = _mm512_mask_blend_pd(gt_tx, i_tx, index);
+        i_rx = _mm512_mask_blend_pd(gt_rx, i_rx, index);
+
+        index = _mm512_add_pd(index, step);
+    }
+
+    double theta_tx[8], at_tx[8], theta_rx[8], at_rx[8];
+    _mm512_storeu_pd(theta_tx, theta_tx_max);
+    _mm512_storeu_pd(at_tx, i_tx);
+    _mm512_storeu_pd(theta_rx, theta_rx_max);
+    _mm512_storeu_pd(at_rx, i_rx);
+
+    // leave the upper register halves clean for the SSE code that follows
+    _mm256_zeroupper();
+
+    ReduceHorizonLanes(theta_tx, at_tx, 8, &block->theta_tx, &block->i_tx);
+    ReduceHorizonLanes(theta_rx, at_rx, 8, &block->theta_rx, &block->i_rx);
+
+    HorizonBlock_Scalar(z__meter, d_tx__meter, d_rx__meter, j, n, z_tx__meter, z_rx__meter, a_e__meter, block);
+}
+
+#endif
 
 /*=============================================================================
  |
@@ -36,26 +232,49 @@ void FindHorizons(const double pfl[], const double a_e__meter, const double h__m
     double d_tx__meter = 0.0;
     double d_rx__meter = d__meter;
 
-    double theta_tx, theta_rx;
+#ifdef ITM_SIMD_X86
+    const int simd = GetSimdLevel();
+#endif
 
-    for (int i = 1; i < np; i++)
+    double d_tx_block__meter[HORIZON_BLOCK];
+    double d_rx_block__meter[HORIZON_BLOCK];
+
+    for (int start = 1; start < np; start += HORIZON_BLOCK)
     {
-        d_tx__meter = d_tx__meter + xi;
-        d_rx__meter = d_rx__meter - xi;
+        const int n = MIN(HORIZON_BLOCK, np - start);
+
+        for (int j = 0; j < n; j++)
+        {
+            d_tx__meter = d_tx__meter + xi;
+            d_rx__meter = d_rx__meter - xi;
+
+            d_tx_block__meter[j] = d_tx__meter;
+            d_rx_block__meter[j] = d_rx__meter;
+        }
+
+        HorizonBlock block = { -INFINITY, -INFINITY, -1, -1 };
+        const double *z__meter = pfl + start + 2;
 
-        theta_tx = (pfl[i + 2] - z_tx__meter) / d_tx__meter - d_tx__meter / (2 * a_e__meter);
-        theta_rx = -(z_rx__meter - pfl[i + 2]) / d_rx__meter - d_rx__meter / (2 * a_e__meter);
+#ifdef ITM_SIMD_X86
+        if (simd == SIMD__AVX512)
+            HorizonBlock_AVX512(z__meter, d_tx_block__meter, d_rx_block__meter, n, z_tx__meter, z_rx__meter, a_e__meter, &block);
+        else if (simd == SIMD__AVX2)
+            HorizonBlock_AVX2(z__meter, d_tx_block__meter, d_rx_block__meter, n, z_tx__meter, z_rx__meter, a_e__meter, &block);
+        else
+#endif
+            HorizonBlock_Scalar(z__meter, d_tx_block__meter, d_rx_block__meter, 0, n, z_tx__meter, z_rx__meter, a_e__meter, &block);
 
-        if (theta_tx > theta_hzn[0])
+        // the first point of the block at its maximum is where a point-by-point scan ends up
+        if (block.i_tx >= 0 && block.theta_tx > theta_hzn[0])
         {
-            theta_hzn[0] = theta_tx;
-            d_hzn__meter[0] = d_tx__meter;
+            theta_hzn[0] = block.theta_tx;
+            d_hzn__meter[0] = d_tx_block__meter[block.i_tx];
         }
 
-        if (theta_rx > theta_hzn[1])
+        if (block.i_rx >= 0 && block.theta_rx > theta_hzn[1])
         {
-            theta_hzn[1] = theta_rx;
-            d_hzn__meter[1] = d_rx__meter;
+            theta_hzn[1] = block.theta_rx;
+            d_hzn__meter[1] = d_rx_block__meter[block.i_rx];
         }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,152 @@
+#include "../include/itm.h"
+#include "../include/Enums.h"
+
+#include <atomic>
+
+// Counters of one stage, kept on their own cache line so that threads timing
+// different stages do not contend
+struct alignas(64) StageCounters
+{
+    std::atomic<long long> calls;
+    std::atomic<long long> nanoseconds;
+};
+
+static std::atomic<bool> enabled(false);
+static StageCounters stages[STAGE__COUNT];
+static std::atomic<long long> modes[MODE__TROPOSCATTER + 1];
+
+/*=============================================================================
+ |
+ |  Description:  Turn the stage timers and mode histogram on or off.  The
+ |                counters keep their values; see ResetInstrumentation().
+ |
+ |        Input:  enable            - True to start recording
+ |
+ |      Outputs:  [None]
+ |
+ |      Returns:  [None]
+ |
+ *===========================================================================*/
+void EnableInstrumentation(const bool enable)
+{
+    enabled.store(enable, std::memory_order_relaxed);
+}
+
+/*=============================================================================
+ |
+ |  Description:  Whether the stage timers and mode histogram are recording
+ |
+ |        Input:  [None]
+ |
+ |      Outputs:  [None]
+ |
+ |      Returns:  enabled           - True if recording
+ |
+ *===========================================================================*/
+bool InstrumentationEnabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+/*=============================================================================
+ |
+ |  Description:  Zero all stage counters and the mode histogram
+ |
+ |        Input:  [None]
+ |
+ |      Outputs:  [None]
+ |
+ |      Returns:  [None]
+ |
+ *===========================================================================*/
+void ResetInstrumentation()
+{
+    for (int i = 0; i < STAGE__COUNT; i++)
+    {
+        stages[i].calls.store(0, std::memory_order_relaxed);
+        stages[i].nanoseconds.store(0, std::memory_order_relaxed);
+    }
+
+    for (int i = 0; i <= MODE__TROPOSCATTER; i++)
+        modes[i].store(0, std::memory_order_relaxed);
+}
+
+/*=============================================================================
+ |
+ |  Description:  Read the cumulative counters of a stage
+ |
+ |        Input:  stage             - One of the STAGE__* values
+ |
+ |      Outputs:  calls             - Number of recorded calls
+ |                seconds           - Total recorded time, in seconds
+ |
+ |      Returns:  [None]
+ |
+ *===========================================================================*/
+void GetStageCounters(const int stage, long long *calls, double *seconds)
+{
+    if (stage < 0 || stage >= STAGE__COUNT)
+    {
+        *calls = 0;
+        *seconds = 0;
+        return;
+    }
+
+    *calls = stages[stage].calls.load(std::memory_order_relaxed);
+    *seconds = stages[stage].nanoseconds.load(std::memory_order_relaxed) * 1e-9;
+}
+
+/*=============================================================================
+ |
+ |  Description:  Number of reference attenuations computed in a mode
+ |
+ |        Input:  mode              - One of the MODE__* propagation values
+ |
+ |      Outputs:  [None]
+ |
+ |      Returns:  count             - Number of recorded predictions
+ |
+ *===========================================================================*/
+long long GetModeCount(const int mode)
+{
+    if (mode < 0 || mode > MODE__TROPOSCATTER)
+        return 0;
+
+    return modes[mode].load(std::memory_order_relaxed);
+}
+
+/*=============================================================================
+ |
+ |  Description:  Add one call of a stage to its counters
+ |
+ |        Input:  stage             - One of the STAGE__* values
+ |                nanoseconds       - Time spent in the call
+ |
+ |      Outputs:  [None]
+ |
+ |      Returns:  [None]
+ |
+ *===========================================================================*/
+void RecordStage(const int stage, const long long nanoseconds)
+{
+    stages[stage].calls.fetch_add(1, std::memory_order_relaxed);
+    stages[stage].nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+/*=============================================================================
+ |
+ |  Description:  Add one prediction to the mode of propagation histogram,
+ |                if instrumentation is enabled
+ |
+ |        Input:  mode              - One of the MODE__* propagation values
+ |
+ |      Outputs:  [None]
+ |
+ |      Returns:  [None]
+ |
+ *===========================================================================*/
+void RecordMode(const int mode)
+{
+    if (InstrumentationEnabled() && mode >= 0 && mode <= MODE__TROPOSCATTER)
+        modes[mode].fetch_add(1, std::memory_order_relaxed);
+}
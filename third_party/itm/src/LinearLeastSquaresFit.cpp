@@ -1,4 +1,179 @@
-#include "..\include\itm.h"
+#include "../include/itm.h"
+#include "../include/Enums.h"
+#include "../include/Simd.h"
+
+// Number of partial sums the interior points are spread over.  Point k of the
+// interior is added to partial sum k % FIT_LANES for every whole group of
+// FIT_LANES points; the partial sums are then combined pairwise and the
+// remaining points added in order.  Every instruction set follows this same
+// order, so as long as multiply-adds are not contracted (-ffp-contract=off)
+// the fit does not depend on the processor it runs on.
+#define FIT_LANES                               8
+
+/*=============================================================================
+ |
+ |  Description:  Combine the partial sums of FitSums_*
+ |
+ *===========================================================================*/
+static double ReduceFitLanes(const double sum[FIT_LANES])
+{
+    double half[4];
+    for (int l = 0; l < 4; l++)
+        half[l] = sum[l] + sum[l + 4];
+
+    return (half[0] + half[2]) + (half[1] + half[3]);
+}
+
+/*=============================================================================
+ |
+ |  Description:  Sum the interior points [begin, end) of a fit in order
+ |
+ |        Input:  y[]               - Interior terrain points
+ |                begin, end        - Points to add
+ |                w_0               - Weight of interior point 0
+ |
+ |      Outputs:  sum_y             - Running sum of the points
+ |                scaled_sum_y      - Running sum of the weighted points
+ |
+ |      Returns:  [None]
+ |
+ *===========================================================================*/
+static void FitTail(const double y[], const int begin, const int end, const double w_0, double *sum_y, double *scaled_sum_y)
+{
+    for (int k = begin; k < end; k++)
+    {
+        const double scaled_y = y[k] * (w_0 + k);
+
+        *sum_y += y[k];
+        *scaled_sum_y += scaled_y;
+    }
+}
+
+/*=============================================================================
+ |
+ |  Description:  Sum and weighted sum of the interior points of a fit, where
+ |                point k has weight w_0 + k
+ |
+ |        Input:  y[]               - Interior terrain points
+ |                n                 - Number of interior points
+ |                w_0               - Weight of interior point 0
+ |
+ |      Outputs:  sum_y             - Sum of the points
+ |                scaled_sum_y      - Sum of the weighted points
+ |
+ |      Returns:  [None]
+ |
+ *===========================================================================*/
+static void FitSums_Scalar(const double y[], const int n, const double w_0, double *sum_y, double *scaled_sum_y)
+{
+    double sum[FIT_LANES] = { 0 };
+    double scaled[FIT_LANES] = { 0 };
+
+    int k = 0;
+    for (; k + FIT_LANES <= n; k += FIT_LANES)
+    {
+        for (int l = 0; l < FIT_LANES; l++)
+        {
+            const double scaled_y = y[k + l] * (w_0 + (k + l));
+
+            sum[l] += y[k + l];
+            scaled[l] += scaled_y;
+        }
+    }
+
+    *sum_y = ReduceFitLanes(sum);
+    *scaled_sum_y = ReduceFitLanes(scaled);
+
+    FitTail(y, k, n, w_0, sum_y, scaled_sum_y);
+}
+
+#ifdef ITM_SIMD_X86
+
+/*=============================================================================
+ |
+ |  Description:  AVX2 version of FitSums_Scalar, with the eight partial sums
+ |                held in two registers
+ |
+ *===========================================================================*/
+TARGET_AVX2 static void FitSums_AVX2(const double y[], const int n, const double w_0, double *sum_y, double *scaled_sum_y)
+{
+    const __m256d step = _mm256_set1_pd(FIT_LANES);
+
+    __m256d w_lo = _mm256_setr_pd(w_0, w_0 + 1, w_0 + 2, w_0 + 3);
+    __m256d w_hi = _mm256_setr_pd(w_0 + 4, w_0 + 5, w_0 + 6, w_0 + 7);
+    __m256d sum_lo = _mm256_setzero_pd();
+    __m256d sum_hi = _mm256_setzero_pd();
+    __m256d scaled_lo = _mm256_setzero_pd();
+    __m256d scaled_hi = _mm256_setzero_pd();
+
+    int k = 0;
+    for (; k + FIT_LANES <= n; k += FIT_LANES)
+    {
+        const __m256d y_lo = _mm256_loadu_pd(y + k);
+        const __m256d y_hi = _mm256_loadu_pd(y + k + 4);
+
+        sum_lo = _mm256_add_pd(sum_lo, y_lo);
+        sum_hi = _mm256_add_pd(sum_hi, y_hi);
+        scaled_lo = _mm256_add_pd(scaled_lo, _mm256_mul_pd(y_lo, w_lo));
+        scaled_hi = _mm256_add_pd(scaled_hi, _mm256_mul_pd(y_hi, w_hi));
+
+        w_lo = _mm256_add_pd(w_lo, step);
+        w_hi = _mm256_add_pd(w_hi, step);
+    }
+
+    double sum[FIT_LANES], scaled[FIT_LANES];
+    _mm256_storeu_pd(sum, sum_lo);
+    _mm256_storeu_pd(sum + 4, sum_hi);
+    _mm256_storeu_pd(scaled, scaled_lo);
+    _mm256_storeu_pd(scaled + 4, scaled_hi);
+
+    // leave the upper register halves clean for the SSE code that follows
+    _mm256_zeroupper();
+
+    *sum_y = ReduceFitLanes(sum);
+    *scaled_sum_y = ReduceFitLanes(scaled);
+
+    FitTail(y, k, n, w_0, sum_y, scaled_sum_y);
+}
+
+/*=============================================================================
+ |
+ |  Description:  AVX-512 version of FitSums_Scalar
+ |
+ *===========================================================================*/
+TARGET_AVX512 static void FitSums_AVX512(const double y[], const int n, const double w_0, double *sum_y, double *scaled_sum_y)
+{
+    const __m512d step = _mm512_set1_pd(FIT_LANES);
+
+    __m512d w = _mm512_setr_pd(w_0, w_0 + 1, w_0 + 2, w_0 + 3, w_0 + 4, w_0 + 5, w_0 + 6, w_0 + 7);
+    __m512d sum_v = _mm512_setzero_pd();
+    __m512d scaled_v = _mm512_setzero_pd();
+
+    int k = 0;
+    for (; k + FIT_LANES <= n; k += FIT_LANES)
+    {
+        const __m512d y_v = _mm512_loadu_pd(y + k);
+
+        sum_v = _mm512_add_pd(sum_v, y_v);
+        scaled_v = _mm512_add_pd(scaled_v, _mm512_mul_pd(y_v, w));
+
+        w = _mm512_add_pd(w, step);
+    }
+
+    double sum[FIT_LANES], scaled[FIT_LANES];
+    _mm512_storeu_pd(sum, sum_v);
+    _mm512_storeu_pd(scaled, scaled_v);
+
+    // leave the upper register halves clean for the SSE code that follows
+    _mm256_zeroupper();
+
+    *sum_y = ReduceFitLanes(sum);
+    *scaled_sum_y = ReduceFitLanes(scaled);
+
+    FitTail(y, k, n, w_0, sum_y, scaled_sum_y);
+}
+
+#endif
 
 /*=============================================================================
  |
@@ -29,24 +204,34 @@ void LinearLeastSquaresFit(const double pfl[], const double d_start, const doubl
 
     const double x_length = i_end - i_start;
 
-    double mid_shifted_index = -0.5 * x_length;
+    const double mid_shifted_index = -0.5 * x_length;
     const double mid_shifted_end = i_end + mid_shifted_index;
 
-    double sum_y = 0.5 * (pfl[i_start + 2] + pfl[i_end + 2]);
-    double scaled_sum_y = 0.5 * (pfl[i_start + 2] - pfl[i_end + 2]) * mid_shifted_index;
+    // the end points carry half weight; the interior points are summed below
+    const int n_interior = MAX(i_end - i_start - 1, 0);
+    const double *interior = pfl + i_start + 3;
 
-    for (int i = 2; i <= x_length; i++)
-    {
-        i_start++;
-        mid_shifted_index++;
+    double sum_y, scaled_sum_y;
 
-        sum_y += pfl[i_start + 2];
-        scaled_sum_y += pfl[i_start + 2] * mid_shifted_index;
-    }
+#ifdef ITM_SIMD_X86
+    const int simd = GetSimdLevel();
+    if (simd == SIMD__AVX512)
+        FitSums_AVX512(interior, n_interior, mid_shifted_index + 1, &sum_y, &scaled_sum_y);
+    else if (simd == SIMD__AVX2)
+        FitSums_AVX2(interior, n_interior, mid_shifted_index + 1, &sum_y, &scaled_sum_y);
+    else
+#endif
+        FitSums_Scalar(interior, n_interior, mid_shifted_index + 1, &sum_y, &scaled_sum_y);
+
+    const double end_sum_y = 0.5 * (pfl[i_start + 2] + pfl[i_end + 2]);
+    const double end_scaled_sum_y = 0.5 * (pfl[i_start + 2] - pfl[i_end + 2]) * mid_shifted_index;
+
+    sum_y = end_sum_y + sum_y;
+    scaled_sum_y = end_scaled_sum_y + scaled_sum_y;
 
     sum_y = sum_y / x_length;
     scaled_sum_y = scaled_sum_y * 12.0 / ((x_length * x_length + 2.0) * x_length);
 
     *fit_y1 = sum_y - scaled_sum_y * mid_shifted_end;
     *fit_y2 = sum_y + scaled_sum_y * (np - mid_shifted_end);
-}
\ No newline at end of file
+}
@@ -1,11 +1,12 @@
-#include "..\include\itm.h"
-#include "..\include\Enums.h"
-#include "..\include\Errors.h"
-#include "..\include\Warnings.h"
+#include "../include/itm.h"
+#include "../include/Enums.h"
+#include "../include/Errors.h"
+#include "../include/Warnings.h"
+#include "../include/Instrumentation.h"
 
 /*=============================================================================
  |
- |  Description:  Compute the reference attenuation, using the 
+ |  Description:  Compute the reference attenuation, using the
  |                Longley-Rice method
  |
  |        Input:  theta_hzn[2]      - Terminal horizon angles
@@ -27,9 +28,57 @@
  |      Returns:  error             - Error code
  |
  *===========================================================================*/
-int LongleyRice(const double theta_hzn[2], const double f__mhz, const complex<double> Z_g, const double d_hzn__meter[2], 
-    const double h_e__meter[2], const double gamma_e, const double N_s, const double delta_h__meter, const double h__meter[2], 
+int LongleyRice(const double theta_hzn[2], const double f__mhz, const complex<double> Z_g, const double d_hzn__meter[2],
+    const double h_e__meter[2], const double gamma_e, const double N_s, const double delta_h__meter, const double h__meter[2],
     const double d__meter, const int mode, double *A_ref__db, long *warnings, int *propmode)
+{
+    StageTimer timer(STAGE__LONGLEY_RICE);
+
+    ReferenceLines lines;
+
+    int rtn = InitializeReferenceLines(theta_hzn, f__mhz, Z_g, d_hzn__meter, h_e__meter, gamma_e, N_s, delta_h__meter, h__meter,
+        mode, &lines, warnings);
+    if (rtn != SUCCESS)
+        return rtn;
+
+    // only the coefficients of the region the path falls in are needed
+    if (d__meter < lines.d_sML__meter)
+        LineOfSightCoefficients(h_e__meter, Z_g, delta_h__meter, f__mhz, &lines);
+    else
+        TroposcatterCoefficients(theta_hzn, d_hzn__meter, h_e__meter, N_s, f__mhz, &lines);
+
+    *A_ref__db = ReferenceAttenuation(&lines, d__meter, warnings, propmode);
+
+    return SUCCESS;
+}
+
+/*=============================================================================
+ |
+ |  Description:  Validate the path geometry and compute the parts of the
+ |                reference attenuation that do not depend on the path
+ |                distance: the smooth earth and actual line-of-sight
+ |                distances and the diffraction line
+ |
+ |        Input:  theta_hzn[2]      - Terminal horizon angles
+ |                f__mhz            - Frequency, in MHz
+ |                Z_g               - Complex surface transfer impedance
+ |                d_hzn__meter[2]   - Terminal horizon distances, in meters
+ |                h_e__meter[2]     - Effective terminal heights, in meters
+ |                gamma_e           - Curvature of the effective earth
+ |                N_s               - Surface refractivity, in N-Units
+ |                delta_h__meter    - Terrain irregularity parameter
+ |                h__meter[2]       - Terminal structural heights, in meters
+ |                mode              - Mode of operation (P2P or Area)
+ |
+ |      Outputs:  lines             - Reference line coefficients
+ |                warnings          - Warning flags
+ |
+ |      Returns:  error             - Error code
+ |
+ *===========================================================================*/
+int InitializeReferenceLines(const double theta_hzn[2], const double f__mhz, const complex<double> Z_g, const double d_hzn__meter[2],
+    const double h_e__meter[2], const double gamma_e, const double N_s, const double delta_h__meter, const double h__meter[2],
+    const int mode, ReferenceLines *lines, long *warnings)
 {
     // effective earth radius
     const double a_e__meter = 1 / gamma_e;
@@ -94,132 +143,222 @@ int LongleyRice(const double theta_hzn[2], const double f__mhz, const complex<do
     const double M_d = (A_4__db - A_3__db) / (d_4__meter - d_3__meter);
     const double A_d0__db = A_3__db - M_d * d_3__meter;
 
-    const double d_min__meter = abs(h_e__meter[0] - h_e__meter[1]) / 200e-3;
+    lines->a_e__meter = a_e__meter;
+    lines->theta_los = theta_los;
+    lines->d_sML__meter = d_sML__meter;
+    lines->d_ML__meter = d_ML__meter;
+    lines->d_min__meter = abs(h_e__meter[0] - h_e__meter[1]) / 200e-3;
+    lines->M_d = M_d;
+    lines->A_d0__db = A_d0__db;
 
-    if (d__meter < d_min__meter)
-        *warnings |= WARN__PATH_DISTANCE_TOO_SMALL_1;
-    if (d__meter < 1e3)
-        *warnings |= WARN__PATH_DISTANCE_TOO_SMALL_2;
-    if (d__meter > 1000e3)
-        *warnings |= WARN__PATH_DISTANCE_TOO_BIG_1;
-    if (d__meter > 2000e3)
-        *warnings |= WARN__PATH_DISTANCE_TOO_BIG_2;
+    return SUCCESS;
+}
 
-    // if the path distance is less than the maximum smooth earth line of sight distance...
-    if (d__meter < d_sML__meter)
-    {
-        // Compute the diffraction loss at the maximum smooth earth line of sight distance
-        const double A_sML__db = d_sML__meter * M_d + A_d0__db;
+/*=============================================================================
+ |
+ |  Description:  Compute the coefficients of the line-of-sight reference
+ |                attenuation curve, A_ref = A_o + kHat_1 * d + kHat_2 * ln(d)
+ |
+ |        Input:  h_e__meter[2]     - Effective terminal heights, in meters
+ |                Z_g               - Complex surface transfer impedance
+ |                delta_h__meter    - Terrain irregularity parameter
+ |                f__mhz            - Frequency, in MHz
+ |                lines             - Reference line coefficients, from
+ |                                    InitializeReferenceLines()
+ |
+ |      Outputs:  lines             - Line-of-sight coefficients filled in
+ |
+ |      Returns:  [None]
+ |
+ *===========================================================================*/
+void LineOfSightCoefficients(const double h_e__meter[2], const complex<double> Z_g, const double delta_h__meter, const double f__mhz,
+    ReferenceLines *lines)
+{
+    const double d_sML__meter = lines->d_sML__meter;
+    const double d_ML__meter = lines->d_ML__meter;
+    const double M_d = lines->M_d;
+    const double A_d0__db = lines->A_d0__db;
 
-        // [ERL 79-ITS 67, Eqn 3.16a], in meters instead of km and with MIN() part below
-        double d_0__meter = 0.04 * f__mhz * h_e__meter[0] * h_e__meter[1];
+    // Compute the diffraction loss at the maximum smooth earth line of sight distance
+    const double A_sML__db = d_sML__meter * M_d + A_d0__db;
 
-        double d_1__meter;
-        if (A_d0__db >= 0.0)
-        {
-            d_0__meter = MIN(d_0__meter, 0.5 * d_ML__meter);                // other part of [ERL 79-ITS 67, Eqn 3.16a]
-            d_1__meter = d_0__meter + 0.25 * (d_ML__meter - d_0__meter);    // [ERL 79-ITS 67, Eqn 3.16d]
-        }
-        else
-            d_1__meter = MAX(-A_d0__db / M_d, 0.25 * d_ML__meter);
+    // [ERL 79-ITS 67, Eqn 3.16a], in meters instead of km and with MIN() part below
+    double d_0__meter = 0.04 * f__mhz * h_e__meter[0] * h_e__meter[1];
 
-        const double A_1__db = LineOfSightLoss(d_1__meter, h_e__meter, Z_g, delta_h__meter, M_d, A_d0__db, d_sML__meter, f__mhz);
+    double d_1__meter;
+    if (A_d0__db >= 0.0)
+    {
+        d_0__meter = MIN(d_0__meter, 0.5 * d_ML__meter);                // other part of [ERL 79-ITS 67, Eqn 3.16a]
+        d_1__meter = d_0__meter + 0.25 * (d_ML__meter - d_0__meter);    // [ERL 79-ITS 67, Eqn 3.16d]
+    }
+    else
+        d_1__meter = MAX(-A_d0__db / M_d, 0.25 * d_ML__meter);
 
-        bool flag = false;
+    const double A_1__db = LineOfSightLoss(d_1__meter, h_e__meter, Z_g, delta_h__meter, M_d, A_d0__db, d_sML__meter, f__mhz);
 
-        double kHat_1__db_per_meter = 0;
-        double kHat_2__db_per_meter = 0;
+    bool flag = false;
 
-        if (d_0__meter < d_1__meter)
-        {
-            const double A_0__db = LineOfSightLoss(d_0__meter, h_e__meter, Z_g, delta_h__meter, M_d, A_d0__db, d_sML__meter, f__mhz);
+    double kHat_1__db_per_meter = 0;
+    double kHat_2__db_per_meter = 0;
 
-            const double q = log(d_sML__meter / d_0__meter);
+    if (d_0__meter < d_1__meter)
+    {
+        const double A_0__db = LineOfSightLoss(d_0__meter, h_e__meter, Z_g, delta_h__meter, M_d, A_d0__db, d_sML__meter, f__mhz);
 
-            // [ERL 79-ITS 67, Eqn 3.20]
-            kHat_2__db_per_meter = MAX(0.0, ((d_sML__meter - d_0__meter) * (A_1__db - A_0__db) - (d_1__meter - d_0__meter) * (A_sML__db - A_0__db)) / ((d_sML__meter - d_0__meter) * log(d_1__meter / d_0__meter) - (d_1__meter - d_0__meter) * q));
+        const double q = log(d_sML__meter / d_0__meter);
 
-            flag = A_d0__db > 0.0 || kHat_2__db_per_meter > 0.0;
+        // [ERL 79-ITS 67, Eqn 3.20]
+        kHat_2__db_per_meter = MAX(0.0, ((d_sML__meter - d_0__meter) * (A_1__db - A_0__db) - (d_1__meter - d_0__meter) * (A_sML__db - A_0__db)) / ((d_sML__meter - d_0__meter) * log(d_1__meter / d_0__meter) - (d_1__meter - d_0__meter) * q));
 
-            if (flag)
-            {
-                // [ERL 79-ITS 67, Eqn 3.21]
-                kHat_1__db_per_meter = (A_sML__db - A_0__db - kHat_2__db_per_meter * q) / (d_sML__meter - d_0__meter);
+        flag = A_d0__db > 0.0 || kHat_2__db_per_meter > 0.0;
+
+        if (flag)
+        {
+            // [ERL 79-ITS 67, Eqn 3.21]
+            kHat_1__db_per_meter = (A_sML__db - A_0__db - kHat_2__db_per_meter * q) / (d_sML__meter - d_0__meter);
 
-                if (kHat_1__db_per_meter < 0.0)
-                {
-                    kHat_1__db_per_meter = 0.0;
-                    kHat_2__db_per_meter = DIM(A_sML__db, A_0__db) / q;
+            if (kHat_1__db_per_meter < 0.0)
+            {
+                kHat_1__db_per_meter = 0.0;
+                kHat_2__db_per_meter = DIM(A_sML__db, A_0__db) / q;
 
-                    if (kHat_2__db_per_meter == 0.0)
-                        kHat_1__db_per_meter = M_d;
-                }
+                if (kHat_2__db_per_meter == 0.0)
+                    kHat_1__db_per_meter = M_d;
             }
         }
+    }
 
-        if (!flag)
-        {
-            kHat_1__db_per_meter = DIM(A_sML__db, A_1__db) / (d_sML__meter - d_1__meter);
-            kHat_2__db_per_meter = 0.0;
+    if (!flag)
+    {
+        kHat_1__db_per_meter = DIM(A_sML__db, A_1__db) / (d_sML__meter - d_1__meter);
+        kHat_2__db_per_meter = 0.0;
 
-            if (kHat_1__db_per_meter == 0.0)
-                kHat_1__db_per_meter = M_d;
-        }
+        if (kHat_1__db_per_meter == 0.0)
+            kHat_1__db_per_meter = M_d;
+    }
 
-        const double A_o__db = A_sML__db - kHat_1__db_per_meter * d_sML__meter - kHat_2__db_per_meter * log(d_sML__meter);
+    lines->A_o__db = A_sML__db - kHat_1__db_per_meter * d_sML__meter - kHat_2__db_per_meter * log(d_sML__meter);
+    lines->kHat_1__db_per_meter = kHat_1__db_per_meter;
+    lines->kHat_2__db_per_meter = kHat_2__db_per_meter;
+}
 
-        // [ERL 79-ITS 67, Eqn 3.19]
-        *A_ref__db = A_o__db + kHat_1__db_per_meter * d__meter + kHat_2__db_per_meter * log(d__meter);
-        *propmode = MODE__LINE_OF_SIGHT;
-    }
-    else // this is a trans-horizon path
+/*=============================================================================
+ |
+ |  Description:  Compute the troposcatter line and the distance at which
+ |                it takes over from the diffraction line
+ |
+ |        Input:  theta_hzn[2]      - Terminal horizon angles
+ |                d_hzn__meter[2]   - Terminal horizon distances, in meters
+ |                h_e__meter[2]     - Effective terminal heights, in meters
+ |                N_s               - Surface refractivity, in N-Units
+ |                f__mhz            - Frequency, in MHz
+ |                lines             - Reference line coefficients, from
+ |                                    InitializeReferenceLines()
+ |
+ |      Outputs:  lines             - Troposcatter coefficients filled in
+ |
+ |      Returns:  [None]
+ |
+ *===========================================================================*/
+void TroposcatterCoefficients(const double theta_hzn[2], const double d_hzn__meter[2], const double h_e__meter[2], const double N_s,
+    const double f__mhz, ReferenceLines *lines)
+{
+    const double a_e__meter = lines->a_e__meter;
+    const double theta_los = lines->theta_los;
+    const double d_sML__meter = lines->d_sML__meter;
+    const double d_ML__meter = lines->d_ML__meter;
+    const double M_d = lines->M_d;
+    const double A_d0__db = lines->A_d0__db;
+
+    // select to points far into the troposcatter region
+    const double d_5__meter = d_ML__meter + 200e3;
+    const double d_6__meter = d_ML__meter + 400e3;
+
+    // Compute the troposcatter loss at the two distances
+    double h0 = -1;
+    const double A_6__db = TroposcatterLoss(d_6__meter, theta_hzn, d_hzn__meter, h_e__meter, a_e__meter, N_s, f__mhz, theta_los, &h0);
+    const double A_5__db = TroposcatterLoss(d_5__meter, theta_hzn, d_hzn__meter, h_e__meter, a_e__meter, N_s, f__mhz, theta_los, &h0);
+
+    double M_s, A_s0__db, d_x__meter;
+
+    // if we got a reasonable prediction value back...
+    if (A_5__db < 1000.0)
     {
-        // select to points far into the troposcatter region
-        const double d_5__meter = d_ML__meter + 200e3;
-        const double d_6__meter = d_ML__meter + 400e3;
+        // Compute the slope of the troposcatter line
+        M_s = (A_6__db - A_5__db) / 200e3;
 
-        // Compute the troposcatter loss at the two distances
-        double h0 = -1;
-        const double A_6__db = TroposcatterLoss(d_6__meter, theta_hzn, d_hzn__meter, h_e__meter, a_e__meter, N_s, f__mhz, theta_los, &h0);
-        const double A_5__db = TroposcatterLoss(d_5__meter, theta_hzn, d_hzn__meter, h_e__meter, a_e__meter, N_s, f__mhz, theta_los, &h0);
+        // Find the diffraction-troposcatter transition distance
+        d_x__meter = MAX(MAX(d_sML__meter, d_ML__meter + 1.088 * pow(pow(a_e__meter, 2) / f__mhz, 1.0 / 3.0) * log(f__mhz)), (A_5__db - A_d0__db - M_s * d_5__meter) / (M_d - M_s));
 
-        double M_s, A_s0__db, d_x__meter;
+        // Compute the intercept of the troposcatter line
+        A_s0__db = (M_d - M_s) * d_x__meter + A_d0__db;
+    }
+    else
+    {
+        // troposcatter gives no real results - so use diffraction line parameters for tropo line
+        M_s = M_d;
+        A_s0__db = A_d0__db;
+        d_x__meter = 10e6;
+    }
 
-        // if we got a reasonable prediction value back...
-        if (A_5__db < 1000.0)
-        {
-            // Compute the slope of the troposcatter line
-            M_s = (A_6__db - A_5__db) / 200e3;
+    lines->M_s = M_s;
+    lines->A_s0__db = A_s0__db;
+    lines->d_x__meter = d_x__meter;
+}
 
-            // Find the diffraction-troposcatter transition distance
-            d_x__meter = MAX(MAX(d_sML__meter, d_ML__meter + 1.088 * pow(pow(a_e__meter, 2) / f__mhz, 1.0 / 3.0) * log(f__mhz)), (A_5__db - A_d0__db - M_s * d_5__meter) / (M_d - M_s));
+/*=============================================================================
+ |
+ |  Description:  Evaluate the reference attenuation at a path distance from
+ |                precomputed reference line coefficients.  The line-of-sight
+ |                coefficients must be set for distances below d_sML__meter
+ |                and the troposcatter coefficients for all others.
+ |
+ |        Input:  lines             - Reference line coefficients
+ |                d__meter          - Path distance, in meters
+ |
+ |      Outputs:  warnings          - Warning flags
+ |                propmode          - Mode of propagation value
+ |
+ |      Returns:  A_ref__db         - Reference attenuation, in dB
+ |
+ *===========================================================================*/
+double ReferenceAttenuation(const ReferenceLines *lines, const double d__meter, long *warnings, int *propmode)
+{
+    if (d__meter < lines->d_min__meter)
+        *warnings |= WARN__PATH_DISTANCE_TOO_SMALL_1;
+    if (d__meter < 1e3)
+        *warnings |= WARN__PATH_DISTANCE_TOO_SMALL_2;
+    if (d__meter > 1000e3)
+        *warnings |= WARN__PATH_DISTANCE_TOO_BIG_1;
+    if (d__meter > 2000e3)
+        *warnings |= WARN__PATH_DISTANCE_TOO_BIG_2;
 
-            // Compute the intercept of the troposcatter line
-            A_s0__db = (M_d - M_s) * d_x__meter + A_d0__db;
-        }
-        else
-        {
-            // troposcatter gives no real results - so use diffraction line parameters for tropo line
-            M_s = M_d;
-            A_s0__db = A_d0__db;
-            d_x__meter = 10e6;
-        }
+    double A_ref__db;
 
+    // if the path distance is less than the maximum smooth earth line of sight distance...
+    if (d__meter < lines->d_sML__meter)
+    {
+        // [ERL 79-ITS 67, Eqn 3.19]
+        A_ref__db = lines->A_o__db + lines->kHat_1__db_per_meter * d__meter + lines->kHat_2__db_per_meter * log(d__meter);
+        *propmode = MODE__LINE_OF_SIGHT;
+    }
+    else // this is a trans-horizon path
+    {
         // Determine if its diffraction or troposcatter and compute the loss
-        if (d__meter > d_x__meter)
+        if (d__meter > lines->d_x__meter)
         {
-            *A_ref__db = M_s * d__meter + A_s0__db;
+            A_ref__db = lines->M_s * d__meter + lines->A_s0__db;
             *propmode = MODE__TROPOSCATTER;
         }
         else
         {
-            *A_ref__db = M_d * d__meter + A_d0__db;
+            A_ref__db = lines->M_d * d__meter + lines->A_d0__db;
             *propmode = MODE__DIFFRACTION;
         }
     }
 
-    // Don't allow a negative loss
-    *A_ref__db = MAX(*A_ref__db, 0.0);
+    RecordMode(*propmode);
 
-    return SUCCESS;
-}
\ No newline at end of file
+    // Don't allow a negative loss
+    return MAX(A_ref__db, 0.0);
+}
@@ -0,0 +1,1069 @@
+#include "../include/itm.h"
+#include "../include/Enums.h"
+#include "../include/Errors.h"
+#include "../include/Warnings.h"
+#include "../include/Instrumentation.h"
+#include "../include/Simd.h"
+#include "../include/VariabilityCurves.h"
+
+// LongleyRiceBatch evaluates LongleyRice, Variability and FreeSpaceLoss for
+// many links at once.  The x86 kernels process 4 (AVX2) or 8 (AVX-512) links
+// per block, one link per register lane.  Every lane computes both the
+// line-of-sight and the trans-horizon lines and the propagation mode is then
+// picked with a masked select, except that a line no lane of the block needs
+// is skipped.  exp and log are evaluated with polynomials accurate to a few
+// units in the last place, so the losses agree with the scalar functions to
+// within rounding; both x86 kernels use the same operations and agree with
+// each other exactly.  Without SIMD support, the scalar functions are called
+// link by link.
+
+/*=============================================================================
+ |
+ |  Description:  Link-by-link version of LongleyRiceBatch, made of the same
+ |                calls as ITM_P2P_TLS_Ex
+ |
+ *===========================================================================*/
+static void LongleyRiceBatch_Scalar(const int n, const LinkGeometry *links, const int mode, const double time, const double location,
+    const double situation, const int climate, const int mdvar, const LinkLosses *losses)
+{
+    for (int i = 0; i < n; i++)
+    {
+        const double theta_hzn[2] = { links->theta_hzn[0][i], links->theta_hzn[1][i] };
+        const double d_hzn__meter[2] = { links->d_hzn__meter[0][i], links->d_hzn__meter[1][i] };
+        const double h_e__meter[2] = { links->h_e__meter[0][i], links->h_e__meter[1][i] };
+        const double h__meter[2] = { links->h__meter[0][i], links->h__meter[1][i] };
+        const complex<double> Z_g(links->Z_g_real[i], links->Z_g_imag[i]);
+        const double d__meter = links->d__meter[i];
+        const double f__mhz = links->f__mhz[i];
+
+        long warnings = losses->warnings[i];
+        double A_ref__db = 0;
+        int propmode = MODE__NOT_SET;
+        const int rtn = LongleyRice(theta_hzn, f__mhz, Z_g, d_hzn__meter, h_e__meter, links->gamma_e[i], links->N_s[i], links->delta_h__meter[i],
+            h__meter, d__meter, mode, &A_ref__db, &warnings, &propmode);
+        if (rtn != SUCCESS)
+        {
+            losses->warnings[i] = warnings;
+            losses->status[i] = rtn;
+            continue;
+        }
+
+        const double A_fs__db = FreeSpaceLoss(d__meter, f__mhz);
+
+        losses->A__db[i] = Variability(time, location, situation, h_e__meter, links->delta_h__meter[i], f__mhz, d__meter, A_ref__db, climate,
+            mdvar, &warnings) + A_fs__db;
+        losses->A_ref__db[i] = A_ref__db;
+        losses->A_fs__db[i] = A_fs__db;
+        losses->mode[i] = propmode;
+        losses->warnings[i] = warnings;
+        losses->status[i] = warnings != NO_WARNINGS ? SUCCESS_WITH_WARNINGS : SUCCESS;
+    }
+}
+
+#ifdef ITM_SIMD_X86
+
+/*=============================================================================
+ |
+ |  Description:  Variability inputs shared by every link of a batch
+ |
+ *===========================================================================*/
+struct VariabilityParameters
+{
+    int climate_idx;            // 0-based radio climate
+    int mdvar;                  // Mode of variability, without the +10 / +20 flags
+    bool plus10;                // Location variability is eliminated
+    bool plus20;                // Direct situation variability is eliminated
+    double z_T;                 // Standard normal deviates, after the mode of variability
+    double z_L;
+    double z_S;
+    long warnings;              // Warning flags
+};
+
+/*=============================================================================
+ |
+ |  Description:  The link-independent part of Variability
+ |
+ *===========================================================================*/
+static VariabilityParameters InitializeVariability(const double time, const double location, const double situation, const int climate,
+    const int mdvar)
+{
+    VariabilityParameters var;
+
+    var.z_T = InverseComplementaryCumulativeDistributionFunction(time / 100);
+    var.z_L = InverseComplementaryCumulativeDistributionFunction(location / 100);
+    var.z_S = InverseComplementaryCumulativeDistributionFunction(situation / 100);
+
+    var.climate_idx = climate - 1;
+
+    var.mdvar = mdvar;
+    var.plus20 = var.mdvar >= 20;
+    if (var.plus20)
+        var.mdvar -= 20;
+    var.plus10 = var.mdvar >= 10;
+    if (var.plus10)
+        var.mdvar -= 10;
+
+    if (var.mdvar == SINGLE_MESSAGE_MODE)
+    {
+        var.z_T = var.z_S;
+        var.z_L = var.z_S;
+    }
+    else if (var.mdvar == ACCIDENTAL_MODE)
+        var.z_L = var.z_S;
+    else if (var.mdvar == MOBILE_MODE)
+        var.z_L = var.z_T;
+
+    var.warnings = NO_WARNINGS;
+    if (fabs(var.z_T) > 3.10 || fabs(var.z_L) > 3.10 || fabs(var.z_S) > 3.10)
+        var.warnings |= WARN__EXTREME_VARIABILITIES;
+
+    return var;
+}
+
+/*=============================================================================
+ |
+ |  Description:  The error InitializeReferenceLines returns for a link, if
+ |                any
+ |
+ *===========================================================================*/
+static int ReferenceLinesError(const double N_s, const double gamma_e, const double Z_g_real, const double Z_g_imag)
+{
+    if (N_s < 150)
+        return ERROR__SURFACE_REFRACTIVITY_SMALL;
+    if (N_s > 400)
+        return ERROR__SURFACE_REFRACTIVITY_LARGE;
+
+    const double a_e__meter = 1 / gamma_e;
+    if (a_e__meter < 4000000 || a_e__meter > 13333333)
+        return ERROR__EFFECTIVE_EARTH;
+
+    if (Z_g_real <= fabs(Z_g_imag))
+        return ERROR__GROUND_IMPEDANCE;
+
+    return SUCCESS;
+}
+
+//
+// LANE TYPES
+///////////////////////////////////////////////
+
+// Each lane type holds one double per link of a block and converts
+// implicitly from a double, which is broadcast to every lane.  Comparisons
+// give a mask, and Select(mask, a, b) takes a where the mask is set and b
+// elsewhere.  Min and Max behave exactly as the MIN and MAX macros, also for
+// NaN arguments.
+
+struct Avx2Mask
+{
+    __m256d m;
+};
+
+struct Avx2Lanes
+{
+    enum { size = 4 };
+    typedef Avx2Mask Mask;
+
+    __m256d v;
+
+    Avx2Lanes() {}
+    TARGET_AVX2 Avx2Lanes(const double x) : v(_mm256_set1_pd(x)) {}
+    TARGET_AVX2 explicit Avx2Lanes(const __m256d v) : v(v) {}
+
+    TARGET_AVX2 static Avx2Lanes Load(const double p[]) { return Avx2Lanes(_mm256_loadu_pd(p)); }
+};
+
+TARGET_AVX2 static inline Avx2Lanes operator+(const Avx2Lanes a, const Avx2Lanes b) { return Avx2Lanes(_mm256_add_pd(a.v, b.v)); }
+TARGET_AVX2 static inline Avx2Lanes operator-(const Avx2Lanes a, const Avx2Lanes b) { return Avx2Lanes(_mm256_sub_pd(a.v, b.v)); }
+TARGET_AVX2 static inline Avx2Lanes operator*(const Avx2Lanes a, const Avx2Lanes b) { return Avx2Lanes(_mm256_mul_pd(a.v, b.v)); }
+TARGET_AVX2 static inline Avx2Lanes operator/(const Avx2Lanes a, const Avx2Lanes b) { return Avx2Lanes(_mm256_div_pd(a.v, b.v)); }
+TARGET_AVX2 static inline Avx2Lanes operator-(const Avx2Lanes a) { return Avx2Lanes(_mm256_xor_pd(a.v, _mm256_set1_pd(-0.0))); }
+
+TARGET_AVX2 static inline Avx2Mask operator<(const Avx2Lanes a, const Avx2Lanes b) { Avx2Mask r = { _mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ) }; return r; }
+TARGET_AVX2 static inline Avx2Mask operator<=(const Avx2Lanes a, const Avx2Lanes b) { Avx2Mask r = { _mm256_cmp_pd(a.v, b.v, _CMP_LE_OQ) }; return r; }
+TARGET_AVX2 static inline Avx2Mask operator>(const Avx2Lanes a, const Avx2Lanes b) { Avx2Mask r = { _mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ) }; return r; }
+TARGET_AVX2 static inline Avx2Mask operator>=(const Avx2Lanes a, const Avx2Lanes b) { Avx2Mask r = { _mm256_cmp_pd(a.v, b.v, _CMP_GE_OQ) }; return r; }
+TARGET_AVX2 static inline Avx2Mask operator==(const Avx2Lanes a, const Avx2Lanes b) { Avx2Mask r = { _mm256_cmp_pd(a.v, b.v, _CMP_EQ_OQ) }; return r; }
+TARGET_AVX2 static inline Avx2Mask operator!=(const Avx2Lanes a, const Avx2Lanes b) { Avx2Mask r = { _mm256_cmp_pd(a.v, b.v, _CMP_NEQ_UQ) }; return r; }
+
+TARGET_AVX2 static inline Avx2Mask operator&(const Avx2Mask a, const Avx2Mask b) { Avx2Mask r = { _mm256_and_pd(a.m, b.m) }; return r; }
+TARGET_AVX2 static inline Avx2Mask operator|(const Avx2Mask a, const Avx2Mask b) { Avx2Mask r = { _mm256_or_pd(a.m, b.m) }; return r; }
+TARGET_AVX2 static inline Avx2Mask operator!(const Avx2Mask a) { Avx2Mask r = { _mm256_xor_pd(a.m, _mm256_castsi256_pd(_mm256_set1_epi64x(-1))) }; return r; }
+TARGET_AVX2 static inline bool Any(const Avx2Mask a) { return _mm256_movemask_pd(a.m) != 0; }
+TARGET_AVX2 static inline int Bits(const Avx2Mask a) { return _mm256_movemask_pd(a.m); }
+
+TARGET_AVX2 static inline Avx2Lanes Select(const Avx2Mask m, const Avx2Lanes a, const Avx2Lanes b) { return Avx2Lanes(_mm256_blendv_pd(b.v, a.v, m.m)); }
+TARGET_AVX2 static inline Avx2Lanes Min(const Avx2Lanes a, const Avx2Lanes b) { return Avx2Lanes(_mm256_min_pd(a.v, b.v)); }
+TARGET_AVX2 static inline Avx2Lanes Max(const Avx2Lanes a, const Avx2Lanes b) { return Avx2Lanes(_mm256_max_pd(a.v, b.v)); }
+TARGET_AVX2 static inline Avx2Lanes Abs(const Avx2Lanes a) { return Avx2Lanes(_mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v)); }
+TARGET_AVX2 static inline Avx2Lanes Sqrt(const Avx2Lanes a) { return Avx2Lanes(_mm256_sqrt_pd(a.v)); }
+TARGET_AVX2 static inline Avx2Lanes Floor(const Avx2Lanes a) { return Avx2Lanes(_mm256_round_pd(a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)); }
+TARGET_AVX2 static inline Avx2Lanes Round(const Avx2Lanes a) { return Avx2Lanes(_mm256_round_pd(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)); }
+TARGET_AVX2 static inline void Store(double p[], const Avx2Lanes a) { _mm256_storeu_pd(p, a.v); }
+
+// a * 2^k for integral k in [-1022, 1023]
+TARGET_AVX2 static inline Avx2Lanes Ldexp(const Avx2Lanes a, const Avx2Lanes k)
+{
+    // 2^52 + 1023 + k holds the biased exponent in its low mantissa bits
+    const __m256d biased = _mm256_add_pd(k.v, _mm256_set1_pd(4503599627370496.0 + 1023.0));
+    return Avx2Lanes(_mm256_mul_pd(a.v, _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_castpd_si256(biased), 52))));
+}
+
+// Unbiased exponent of a positive normal number, as a double
+TARGET_AVX2 static inline Avx2Lanes Logb(const Avx2Lanes a)
+{
+    const __m256i e = _mm256_srli_epi64(_mm256_and_si256(_mm256_castpd_si256(a.v), _mm256_set1_epi64x(0x7ff0000000000000LL)), 52);
+    const __m256d two52 = _mm256_set1_pd(4503599627370496.0);
+    return Avx2Lanes(_mm256_sub_pd(_mm256_or_pd(_mm256_castsi256_pd(e), two52), _mm256_set1_pd(4503599627370496.0 + 1023.0)));
+}
+
+// Significand of a positive normal number, in [1, 2)
+TARGET_AVX2 static inline Avx2Lanes Significand(const Avx2Lanes a)
+{
+    const __m256i m = _mm256_and_si256(_mm256_castpd_si256(a.v), _mm256_set1_epi64x(0x000fffffffffffffLL));
+    return Avx2Lanes(_mm256_castsi256_pd(_mm256_or_si256(m, _mm256_set1_epi64x(0x3ff0000000000000LL))));
+}
+
+// GCC 12 reports the undefined pass-through operand of the unmasked AVX-512
+// intrinsics as maybe uninitialized, so the wrappers below use the masked
+// forms with every lane selected and a zero pass-through, which compile to
+// the same instructions.
+static const __mmask8 kAvx512AllLanes = 0xFF;
+
+struct Avx512Mask
+{
+    __mmask8 m;
+};
+
+struct Avx512Lanes
+{
+    enum { size = 8 };
+    typedef Avx512Mask Mask;
+
+    __m512d v;
+
+    Avx512Lanes() {}
+    TARGET_AVX512 Avx512Lanes(const double x) : v(_mm512_set1_pd(x)) {}
+    TARGET_AVX512 explicit Avx512Lanes(const __m512d v) : v(v) {}
+
+    TARGET_AVX512 static Avx512Lanes Load(const double p[]) { return Avx512Lanes(_mm512_loadu_pd(p)); }
+};
+
+TARGET_AVX512 static inline Avx512Lanes operator+(const Avx512Lanes a, const Avx512Lanes b) { return Avx512Lanes(_mm512_add_pd(a.v, b.v)); }
+TARGET_AVX512 static inline Avx512Lanes operator-(const Avx512Lanes a, const Avx512Lanes b) { return Avx512Lanes(_mm512_sub_pd(a.v, b.v)); }
+TARGET_AVX512 static inline Avx512Lanes operator*(const Avx512Lanes a, const Avx512Lanes b) { return Avx512Lanes(_mm512_mul_pd(a.v, b.v)); }
+TARGET_AVX512 static inline Avx512Lanes operator/(const Avx512Lanes a, const Avx512Lanes b) { return Avx512Lanes(_mm512_div_pd(a.v, b.v)); }
+TARGET_AVX512 static inline Avx512Lanes operator-(const Avx512Lanes a)
+{
+    const __m512i sign = _mm512_set1_epi64((long long)0x8000000000000000ULL);
+    return Avx512Lanes(_mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a.v), sign)));
+}
+
+TARGET_AVX512 static inline Avx512Mask operator<(const Avx512Lanes a, const Avx512Lanes b) { Avx512Mask r = { _mm512_cmp_pd_mask(a.v, b.v, _CMP_LT_OQ) }; return r; }
+TARGET_AVX512 static inline Avx512Mask operator<=(const Avx512Lanes a, const Avx512Lanes b) { Avx512Mask r = { _mm512_cmp_pd_mask(a.v, b.v, _CMP_LE_OQ) }; return r; }
+TARGET_AVX512 static inline Avx512Mask operator>(const Avx512Lanes a, const Avx512Lanes b) { Avx512Mask r = { _mm512_cmp_pd_mask(a.v, b.v, _CMP_GT_OQ) }; return r; }
+TARGET_AVX512 static inline Avx512Mask operator>=(const Avx512Lanes a, const Avx512Lanes b) { Avx512Mask r = { _mm512_cmp_pd_mask(a.v, b.v, _CMP_GE_OQ) }; return r; }
+TARGET_AVX512 static inline Avx512Mask operator==(const Avx512Lanes a, const Avx512Lanes b) { Avx512Mask r = { _mm512_cmp_pd_mask(a.v, b.v, _CMP_EQ_OQ) }; return r; }
+TARGET_AVX512 static inline Avx512Mask operator!=(const Avx512Lanes a, const Avx512Lanes b) { Avx512Mask r = { _mm512_cmp_pd_mask(a.v, b.v, _CMP_NEQ_UQ) }; return r; }
+
+TARGET_AVX512 static inline Avx512Mask operator&(const Avx512Mask a, const Avx512Mask b) { Avx512Mask r = { (__mmask8)(a.m & b.m) }; return r; }
+TARGET_AVX512 static inline Avx512Mask operator|(const Avx512Mask a, const Avx512Mask b) { Avx512Mask r = { (__mmask8)(a.m | b.m) }; return r; }
+TARGET_AVX512 static inline Avx512Mask operator!(const Avx512Mask a) { Avx512Mask r = { (__mmask8)~a.m }; return r; }
+TARGET_AVX512 static inline bool Any(const Avx512Mask a) { return a.m != 0; }
+TARGET_AVX512 static inline int Bits(const Avx512Mask a) { return a.m; }
+
+TARGET_AVX512 static inline Avx512Lanes Select(const Avx512Mask m, const Avx512Lanes a, const Avx512Lanes b) { return Avx512Lanes(_mm512_mask_blend_pd(m.m, b.v, a.v)); }
+TARGET_AVX512 static inline Avx512Lanes Min(const Avx512Lanes a, const Avx512Lanes b) { return Avx512Lanes(_mm512_mask_min_pd(_mm512_setzero_pd(), kAvx512AllLanes, a.v, b.v)); }
+TARGET_AVX512 static inline Avx512Lanes Max(const Avx512Lanes a, const Avx512Lanes b) { return Avx512Lanes(_mm512_mask_max_pd(_mm512_setzero_pd(), kAvx512AllLanes, a.v, b.v)); }
+TARGET_AVX512 static inline Avx512Lanes Abs(const Avx512Lanes a) { return Avx512Lanes(_mm512_abs_pd(a.v)); }
+TARGET_AVX512 static inline Avx512Lanes Sqrt(const Avx512Lanes a) { return Avx512Lanes(_mm512_mask_sqrt_pd(_mm512_setzero_pd(), kAvx512AllLanes, a.v)); }
+TARGET_AVX512 static inline Avx512Lanes Floor(const Avx512Lanes a) { return Avx512Lanes(_mm512_mask_roundscale_pd(_mm512_setzero_pd(), kAvx512AllLanes, a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)); }
+TARGET_AVX512 static inline Avx512Lanes Round(const Avx512Lanes a) { return Avx512Lanes(_mm512_mask_roundscale_pd(_mm512_setzero_pd(), kAvx512AllLanes, a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)); }
+TARGET_AVX512 static inline void Store(double p[], const Avx512Lanes a) { _mm512_storeu_pd(p, a.v); }
+
+TARGET_AVX512 static inline Avx512Lanes Ldexp(const Avx512Lanes a, const Avx512Lanes k) { return Avx512Lanes(_mm512_mask_scalef_pd(_mm512_setzero_pd(), kAvx512AllLanes, a.v, k.v)); }
+TARGET_AVX512 static inline Avx512Lanes Logb(const Avx512Lanes a) { return Avx512Lanes(_mm512_mask_getexp_pd(_mm512_setzero_pd(), kAvx512AllLanes, a.v)); }
+TARGET_AVX512 static inline Avx512Lanes Significand(const Avx512Lanes a) { return Avx512Lanes(_mm512_mask_getmant_pd(_mm512_setzero_pd(), kAvx512AllLanes, a.v, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_zero)); }
+
+//
+// LANE MATH
+///////////////////////////////////////////////
+
+// Taylor coefficients, highest degree first
+static const double EXP_COEFFICIENTS[] = { 1.6059043836821613e-10, 2.08767569878681e-09, 2.505210838544172e-08, 2.755731922398589e-07,
+    2.7557319223985893e-06, 2.48015873015873e-05, 0.0001984126984126984, 0.001388888888888889, 0.008333333333333333, 0.041666666666666664,
+    0.16666666666666666, 0.5, 1.0, 1.0 };
+static const double LOG_COEFFICIENTS[] = { 1.0 / 21, 1.0 / 19, 1.0 / 17, 1.0 / 15, 1.0 / 13, 1.0 / 11, 1.0 / 9, 1.0 / 7, 1.0 / 5, 1.0 / 3,
+    1.0 };
+static const double COS_COEFFICIENTS[] = { -8.896791392450574e-22, 4.110317623312165e-19, -1.5619206968586225e-16, 4.779477332387385e-14,
+    -1.1470745597729725e-11, 2.08767569878681e-09, -2.755731922398589e-07, 2.48015873015873e-05, -0.001388888888888889, 0.041666666666666664,
+    -0.5, 1.0 };
+static const double SIN_COEFFICIENTS[] = { 1.9572941063391263e-20, -8.22063524662433e-18, 2.8114572543455206e-15, -7.647163731819816e-13,
+    1.6059043836821613e-10, -2.505210838544172e-08, 2.7557319223985893e-06, -0.0001984126984126984, 0.008333333333333333, -0.16666666666666666,
+    1.0 };
+
+// ln(2) split so that k * LN2_HI is exact for |k| < 2^11
+#define LN2_HI                                  6.93147180369123816490e-01
+#define LN2_LO                                  1.90821492927058770002e-10
+
+template <typename V> static V Polynomial(const V &x, const double c[], const int n)
+{
+    V p = c[0];
+    for (int i = 1; i < n; i++)
+        p = p * x + c[i];
+    return p;
+}
+
+/*=============================================================================
+ |
+ |  Description:  exp(x).  Arguments are clamped to [-708, 709], so the
+ |                result is always a normal number.
+ |
+ *===========================================================================*/
+template <typename V> static V Exp(const V &x)
+{
+    // written so that NaN passes through the clamp
+    const V y = Min(709.0, Max(-708.0, x));
+
+    const V k = Round(y * 1.4426950408889634);
+    const V r = (y - k * LN2_HI) - k * LN2_LO;
+
+    return Ldexp(Polynomial(r, EXP_COEFFICIENTS, 14), k);
+}
+
+/*=============================================================================
+ |
+ |  Description:  Natural logarithm, with -infinity at zero and NaN for
+ |                negative arguments
+ |
+ *===========================================================================*/
+template <typename V> static V Log(const V &x)
+{
+    // bring subnormal arguments into the normal range
+    const typename V::Mask tiny = x < 2.2250738585072014e-308;
+    const V x_n = Select(tiny, x * 18014398509481984.0, x);
+
+    // x = m * 2^e with m in [sqrt(2) / 2, sqrt(2)]
+    V m = Significand(x_n);
+    V e = Logb(x_n) - Select(tiny, 54.0, 0.0);
+    const typename V::Mask high = m > 1.4142135623730951;
+    m = Select(high, m * 0.5, m);
+    e = Select(high, e + 1.0, e);
+
+    // log(m) = 2 atanh(s)
+    const V f = m - 1.0;
+    const V s = f / (2.0 + f);
+    const V log_m = 2.0 * s * Polynomial(s * s, LOG_COEFFICIENTS, 11);
+    const V result = e * LN2_HI + (log_m + e * LN2_LO);
+
+    return Select(x > 0.0, Select(x == INFINITY, x, result), Select(x == 0.0, -INFINITY, NAN));
+}
+
+template <typename V> static V Log10(const V &x)
+{
+    return Log(x) * 0.43429448190325176;
+}
+
+// x^y for x > 0
+template <typename V> static V Pow(const V &x, const double y)
+{
+    return Exp(Log(x) * y);
+}
+
+/*=============================================================================
+ |
+ |  Description:  sin(x) and cos(x) for 0 <= x <= PI
+ |
+ *===========================================================================*/
+template <typename V> static void SinCos(const V &x, V *sin_x, V *cos_x)
+{
+    // with t = x - PI / 2 in [-PI / 2, PI / 2], sin(x) = cos(t) and cos(x) = -sin(t)
+    const V t = (x - 1.5707963267948966) - 6.123233995736766e-17;
+    const V t2 = t * t;
+
+    *sin_x = Polynomial(t2, COS_COEFFICIENTS, 12);
+    *cos_x = -(t * Polynomial(t2, SIN_COEFFICIENTS, 11));
+}
+
+// Add flag to the warnings of every lane set in bits
+static void FlagLanes(int bits, const long flag, long warnings[])
+{
+    for (int k = 0; bits != 0; k++, bits >>= 1)
+        if (bits & 1)
+            warnings[k] |= flag;
+}
+
+template <typename V> static V LoadLanes(const double values[], const int i, const int count)
+{
+    if (count == V::size)
+        return V::Load(values + i);
+
+    // repeat the last link into the unused lanes of a partial block
+    double padded[V::size];
+    for (int k = 0; k < V::size; k++)
+        padded[k] = values[i + MIN(k, count - 1)];
+    return V::Load(padded);
+}
+
+//
+// LANE VERSIONS OF THE ITM FUNCTIONS
+///////////////////////////////////////////////
+
+// The functions below follow the scalar functions of the same name
+// operation for operation, with branches replaced by selects.  pow() with an
+// integer exponent becomes products.
+
+// Per-link inputs of a block
+template <typename V> struct PathLanes
+{
+    V theta_hzn[2];
+    V d_hzn__meter[2];
+    V h_e__meter[2];
+    V h__meter[2];
+    V delta_h__meter;
+    V d__meter;
+    V Z_g_real;
+    V Z_g_imag;
+    V abs_Z_g;
+    V gamma_e;
+    V N_s;
+    V f__mhz;
+    V wn;                       // wavenumber, k
+};
+
+// ReferenceLines of a block, plus values shared between its members
+template <typename V> struct ReferenceLinesLanes
+{
+    V a_e__meter;
+    V theta_los;
+    V d_sML__meter;
+    V d_ML__meter;
+    V d_min__meter;
+    V M_d;
+    V A_d0__db;
+    V A_o__db;
+    V kHat_1__db_per_meter;
+    V kHat_2__db_per_meter;
+    V M_s;
+    V A_s0__db;
+    V d_x__meter;
+    V d_scale__meter;           // (a_e^2 / f)^(1/3)
+};
+
+// The terms of DiffractionLoss that do not depend on the path distance
+template <typename V> struct DiffractionTermsLanes
+{
+    V C_0[2];                   // C_0[1] and C_0[2] of SmoothEarthDiffraction
+    V x__km[2];                 // x__km[1] and x__km[2] of SmoothEarthDiffraction
+    V F_x__db[2];               // Height gain functions
+    V f_third;                  // f__mhz^(1/3)
+    V f_minus_third;            // f__mhz^(-1/3)
+    V A_fo__db;                 // Clutter factor
+    V term1;                    // Square root term in [ERL 79-ITS 67, Eqn 3.23]
+};
+
+template <typename V> static V TerrainRoughnessLanes(const V &d__meter, const V &delta_h__meter)
+{
+    return delta_h__meter * (1.0 - 0.8 * Exp(-d__meter / 50e3));
+}
+
+template <typename V> static V SigmaHFunctionLanes(const V &delta_h__meter)
+{
+    return 0.78 * delta_h__meter * Exp(-0.5 * Sqrt(Sqrt(delta_h__meter)));
+}
+
+template <typename V> static V FresnelIntegralLanes(const V &v2)
+{
+    return Select(v2 < 5.76, 6.02 + 9.11 * Sqrt(v2) - 1.27 * v2, 12.953 + 10 * Log10(v2));
+}
+
+template <typename V> static V HeightFunctionLanes(const V &x__km, const V &K)
+{
+    const V w = -Log(K);
+    const V log_x = Log(x__km);
+
+    V low = Select(x__km > 1.0, 17.372 * log_x + -117.0, -117.0);
+    low = Select((K < 1e-5) | (x__km * (w * w * w) > 5495.0), low, 2.5e-5 * (x__km * x__km) / K - 8.686 * w - 15.0);
+
+    V high = 0.05751 * x__km - 4.343 * log_x;
+    const V w_high = 0.0134 * x__km * Exp(-0.005 * x__km);
+    high = Select(x__km < 2000, (1.0 - w_high) * high + w_high * (17.372 * log_x - 117.0), high);
+
+    return Select(x__km < 200.0, low, high);
+}
+
+template <typename V> static V KnifeEdgeDiffractionLanes(const V &d__meter, const PathLanes<V> &p, const ReferenceLinesLanes<V> &lines)
+{
+    const V theta_nlos = d__meter / lines.a_e__meter - lines.theta_los;
+    const V d_nlos__meter = d__meter - lines.d_ML__meter;
+
+    const V v_1 = 0.0795775 * (p.f__mhz / 47.7) * (theta_nlos * theta_nlos) * p.d_hzn__meter[0] * d_nlos__meter / (d_nlos__meter + p.d_hzn__meter[0]);
+    const V v_2 = 0.0795775 * (p.f__mhz / 47.7) * (theta_nlos * theta_nlos) * p.d_hzn__meter[1] * d_nlos__meter / (d_nlos__meter + p.d_hzn__meter[1]);
+
+    return FresnelIntegralLanes(v_1) + FresnelIntegralLanes(v_2);
+}
+
+template <typename V> static V SmoothEarthDiffractionLanes(const V &d__meter, const PathLanes<V> &p, const ReferenceLinesLanes<V> &lines,
+    const DiffractionTermsLanes<V> &terms)
+{
+    const V theta_nlos = d__meter / lines.a_e__meter - lines.theta_los;
+
+    const V a__meter = (d__meter - lines.d_ML__meter) / (d__meter / lines.a_e__meter - lines.theta_los);
+    const V d__km = (a__meter * theta_nlos) / 1000.0;
+
+    const V C_0 = Pow((4.0 / 3.0) * a_0__meter / a__meter, THIRD);
+    const V K = 0.017778 * C_0 * terms.f_minus_third / p.abs_Z_g;
+    const V B_0 = 1.607 - K;
+    const V x__km = B_0 * (C_0 * C_0) * terms.f_third * d__km + terms.x__km[0] + terms.x__km[1];
+
+    const V G_x__db = 0.05751 * x__km - 10.0 * Log10(x__km);
+    return G_x__db - terms.F_x__db[0] - terms.F_x__db[1] - 20;
+}
+
+template <typename V> static void InitializeDiffractionTermsLanes(const PathLanes<V> &p, const int mode, const ReferenceLinesLanes<V> &lines,
+    DiffractionTermsLanes<V> *terms)
+{
+    terms->f_third = Pow(p.f__mhz, THIRD);
+    terms->f_minus_third = Pow(p.f__mhz, -THIRD);
+
+    for (int i = 0; i < 2; i++)
+    {
+        const V a__meter = 0.5 * (p.d_hzn__meter[i] * p.d_hzn__meter[i]) / p.h_e__meter[i];
+        const V d__km = p.d_hzn__meter[i] / 1000.0;
+
+        terms->C_0[i] = Pow((4.0 / 3.0) * a_0__meter / a__meter, THIRD);
+        const V K = 0.017778 * terms->C_0[i] * terms->f_minus_third / p.abs_Z_g;
+        const V B_0 = 1.607 - K;
+
+        terms->x__km[i] = B_0 * (terms->C_0[i] * terms->C_0[i]) * terms->f_third * d__km;
+        terms->F_x__db[i] = HeightFunctionLanes(terms->x__km[i], K);
+    }
+
+    const V delta_h_dsML__meter = TerrainRoughnessLanes(lines.d_sML__meter, p.delta_h__meter);
+    const V sigma_h_d__meter = SigmaHFunctionLanes(delta_h_dsML__meter);
+    terms->A_fo__db = Min(15.0, 5 * Log10(1.0 + 1e-5 * p.h__meter[0] * p.h__meter[1] * p.f__mhz * sigma_h_d__meter));
+
+    V q = p.h__meter[0] * p.h__meter[1];
+    const V qk = p.h_e__meter[0] * p.h_e__meter[1] - q;
+    if (mode == MODE__P2P)
+        q = q + 10.0;
+    terms->term1 = Sqrt(1.0 + qk / q);
+}
+
+template <typename V> static V DiffractionLossLanes(const V &d__meter, const PathLanes<V> &p, const ReferenceLinesLanes<V> &lines,
+    const DiffractionTermsLanes<V> &terms)
+{
+    const V A_k__db = KnifeEdgeDiffractionLanes(d__meter, p, lines);
+    const V A_se__db = SmoothEarthDiffractionLanes(d__meter, p, lines, terms);
+
+    const V delta_h_d__meter = TerrainRoughnessLanes(d__meter, p.delta_h__meter);
+    const V q = (terms.term1 + (-lines.theta_los * lines.a_e__meter + lines.d_ML__meter) / d__meter) * Min(delta_h_d__meter * p.f__mhz / 47.7, 6283.2);
+    const V w = 25.1 / (25.1 + Sqrt(q));
+
+    return w * A_se__db + (1.0 - w) * A_k__db + terms.A_fo__db;
+}
+
+template <typename V> static void InitializeReferenceLinesLanes(const PathLanes<V> &p, const int mode, ReferenceLinesLanes<V> *lines,
+    long warnings[])
+{
+    const V a_e__meter = 1 / p.gamma_e;
+
+    V d_hzn_s__meter[2];
+    for (int i = 0; i < 2; i++)
+        d_hzn_s__meter[i] = Sqrt(2.0 * p.h_e__meter[i] * a_e__meter);
+
+    lines->a_e__meter = a_e__meter;
+    lines->d_sML__meter = d_hzn_s__meter[0] + d_hzn_s__meter[1];
+    lines->d_ML__meter = p.d_hzn__meter[0] + p.d_hzn__meter[1];
+    lines->theta_los = -Max(p.theta_hzn[0] + p.theta_hzn[1], -lines->d_ML__meter / a_e__meter);
+    lines->d_min__meter = Abs(p.h_e__meter[0] - p.h_e__meter[1]) / 200e-3;
+
+    FlagLanes(Bits(Abs(p.theta_hzn[0]) > 200e-3), WARN__TX_HORIZON_ANGLE, warnings);
+    FlagLanes(Bits(Abs(p.theta_hzn[1]) > 200e-3), WARN__RX_HORIZON_ANGLE, warnings);
+    FlagLanes(Bits(p.d_hzn__meter[0] < 0.1 * d_hzn_s__meter[0]), WARN__TX_HORIZON_DISTANCE_1, warnings);
+    FlagLanes(Bits(p.d_hzn__meter[1] < 0.1 * d_hzn_s__meter[1]), WARN__RX_HORIZON_DISTANCE_1, warnings);
+    FlagLanes(Bits(p.d_hzn__meter[0] > 3.0 * d_hzn_s__meter[0]), WARN__TX_HORIZON_DISTANCE_2, warnings);
+    FlagLanes(Bits(p.d_hzn__meter[1] > 3.0 * d_hzn_s__meter[1]), WARN__RX_HORIZON_DISTANCE_2, warnings);
+    // a surface refractivity below 150 is an error instead
+    FlagLanes(Bits((p.N_s >= 150) & (p.N_s < 250)), WARN__SURFACE_REFRACTIVITY, warnings);
+
+    lines->d_scale__meter = Pow(a_e__meter * a_e__meter / p.f__mhz, 1.0 / 3.0);
+    const V d_3__meter = Max(lines->d_sML__meter, lines->d_ML__meter + 5.0 * lines->d_scale__meter);
+    const V d_4__meter = d_3__meter + 10.0 * lines->d_scale__meter;
+
+    DiffractionTermsLanes<V> terms;
+    InitializeDiffractionTermsLanes(p, mode, *lines, &terms);
+    const V A_3__db = DiffractionLossLanes(d_3__meter, p, *lines, terms);
+    const V A_4__db = DiffractionLossLanes(d_4__meter, p, *lines, terms);
+
+    lines->M_d = (A_4__db - A_3__db) / (d_4__meter - d_3__meter);
+    lines->A_d0__db = A_3__db - lines->M_d * d_3__meter;
+}
+
+template <typename V> static V LineOfSightLossLanes(const V &d__meter, const PathLanes<V> &p, const ReferenceLinesLanes<V> &lines)
+{
+    const V delta_h_d__meter = TerrainRoughnessLanes(d__meter, p.delta_h__meter);
+    const V sigma_h_d__meter = SigmaHFunctionLanes(delta_h_d__meter);
+
+    // [Algorithm, Eqn 4.46]
+    const V h_e_sum__meter = p.h_e__meter[0] + p.h_e__meter[1];
+    const V sin_psi = h_e_sum__meter / Sqrt(d__meter * d__meter + h_e_sum__meter * h_e_sum__meter);
+
+    // R_e = (sin_psi - Z_g) / (sin_psi + Z_g) * exp(...), [Algorithm, Eqn 4.47]
+    const V num_real = sin_psi - p.Z_g_real;
+    const V num_imag = -p.Z_g_imag;
+    const V den_real = sin_psi + p.Z_g_real;
+    const V den_imag = p.Z_g_imag;
+    const V den = den_real * den_real + den_imag * den_imag;
+    const V attenuation = Exp(-Min(10.0, p.wn * sigma_h_d__meter * sin_psi));
+    V R_e_real = (num_real * den_real + num_imag * den_imag) / den * attenuation;
+    V R_e_imag = (num_imag * den_real - num_real * den_imag) / den * attenuation;
+
+    // [Algorithm, Eqn 4.48]
+    const V q = R_e_real * R_e_real + R_e_imag * R_e_imag;
+    const V scale = Select((q < 0.25) | (q < sin_psi), Sqrt(sin_psi / q), 1.0);
+    R_e_real = R_e_real * scale;
+    R_e_imag = R_e_imag * scale;
+
+    // [Algorithm, Eqn 4.49 & 4.50]
+    V delta_phi = p.wn * 2.0 * p.h_e__meter[0] * p.h_e__meter[1] / d__meter;
+    delta_phi = Select(delta_phi > PI / 2.0, PI - (PI / 2.0) * (PI / 2.0) / delta_phi, delta_phi);
+
+    V sin_phi, cos_phi;
+    SinCos(delta_phi, &sin_phi, &cos_phi);
+    const V rr_real = cos_phi + R_e_real;
+    const V rr_imag = -sin_phi + R_e_imag;
+    const V A_t__db = -10 * Log10(rr_real * rr_real + rr_imag * rr_imag);
+
+    const V A_d__db = lines.M_d * d__meter + lines.A_d0__db;
+
+    const V w = 1 / (1 + p.f__mhz * p.delta_h__meter / Max(10e3, lines.d_sML__meter));
+    return w * A_t__db + (1 - w) * A_d__db;
+}
+
+template <typename V> static void LineOfSightCoefficientsLanes(const PathLanes<V> &p, ReferenceLinesLanes<V> *lines)
+{
+    const V d_sML__meter = lines->d_sML__meter;
+    const V d_ML__meter = lines->d_ML__meter;
+    const V M_d = lines->M_d;
+    const V A_d0__db = lines->A_d0__db;
+
+    const V A_sML__db = d_sML__meter * M_d + A_d0__db;
+
+    // [ERL 79-ITS 67, Eqn 3.16a & 3.16d]
+    const typename V::Mask positive = A_d0__db >= 0.0;
+    V d_0__meter = 0.04 * p.f__mhz * p.h_e__meter[0] * p.h_e__meter[1];
+    d_0__meter = Select(positive, Min(d_0__meter, 0.5 * d_ML__meter), d_0__meter);
+    const V d_1__meter = Select(positive, d_0__meter + 0.25 * (d_ML__meter - d_0__meter), Max(-A_d0__db / M_d, 0.25 * d_ML__meter));
+
+    const V A_1__db = LineOfSightLossLanes(d_1__meter, p, *lines);
+    const V A_0__db = LineOfSightLossLanes(d_0__meter, p, *lines);
+    const V q = Log(d_sML__meter / d_0__meter);
+
+    // [ERL 79-ITS 67, Eqn 3.20]
+    const V kHat_2__db_per_meter = Max(0.0, ((d_sML__meter - d_0__meter) * (A_1__db - A_0__db) - (d_1__meter - d_0__meter) * (A_sML__db - A_0__db))
+        / ((d_sML__meter - d_0__meter) * Log(d_1__meter / d_0__meter) - (d_1__meter - d_0__meter) * q));
+    const typename V::Mask flag = (d_0__meter < d_1__meter) & ((A_d0__db > 0.0) | (kHat_2__db_per_meter > 0.0));
+
+    // [ERL 79-ITS 67, Eqn 3.21]
+    const V kHat_1_flag = (A_sML__db - A_0__db - kHat_2__db_per_meter * q) / (d_sML__meter - d_0__meter);
+    const typename V::Mask negative = kHat_1_flag < 0.0;
+    const V kHat_2_negative = Select(A_sML__db > A_0__db, A_sML__db - A_0__db, 0.0) / q;
+    const V kHat_1_negative = Select(kHat_2_negative == 0.0, M_d, 0.0);
+
+    V kHat_1_other = Select(A_sML__db > A_1__db, A_sML__db - A_1__db, 0.0) / (d_sML__meter - d_1__meter);
+    kHat_1_other = Select(kHat_1_other == 0.0, M_d, kHat_1_other);
+
+    const V kHat_1__db_per_meter = Select(flag, Select(negative, kHat_1_negative, kHat_1_flag), kHat_1_other);
+    const V kHat_2 = Select(flag, Select(negative, kHat_2_negative, kHat_2__db_per_meter), 0.0);
+
+    lines->A_o__db = A_sML__db - kHat_1__db_per_meter * d_sML__meter - kHat_2 * Log(d_sML__meter);
+    lines->kHat_1__db_per_meter = kHat_1__db_per_meter;
+    lines->kHat_2__db_per_meter = kHat_2;
+}
+
+template <typename V> static V H0CurveLanes(const V &a, const V &b, const V &r)
+{
+    const V u_2 = (1.0 / r) * (1.0 / r);
+    return 10 * Log10(1 + a * (u_2 * u_2) + b * u_2);
+}
+
+template <typename V> static V H0FunctionLanes(const V &r, const V &eta_s)
+{
+    static const double a[] = { 25.0, 80.0, 177.0, 395.0, 705.0 };
+    static const double b[] = { 24.0, 45.0, 68.0, 80.0, 105.0 };
+
+    const V eta = Min(Max(eta_s, 1.0), 5.0);
+    const V i = Floor(eta);
+    const V q = eta - i;
+
+    // coefficients of curves i - 1 and i
+    V a_lo = a[0], b_lo = b[0], a_hi = a[1], b_hi = b[1];
+    for (int j = 2; j <= 4; j++)
+    {
+        const typename V::Mask at = i == double(j);
+        a_lo = Select(at, a[j - 1], a_lo);
+        b_lo = Select(at, b[j - 1], b_lo);
+        a_hi = Select(at, a[j], a_hi);
+        b_hi = Select(at, b[j], b_hi);
+    }
+    const typename V::Mask last = i == 5.0;
+    a_lo = Select(last, a[4], a_lo);
+    b_lo = Select(last, b[4], b_lo);
+
+    const V result = H0CurveLanes(a_lo, b_lo, r);
+    return Select(q != 0.0, (1.0 - q) * result + q * H0CurveLanes(a_hi, b_hi, r), result);
+}
+
+template <typename V> static V FFunctionLanes(const V &td)
+{
+    const typename V::Mask near = td <= 10e3;
+    const typename V::Mask middle = td <= 70e3;
+
+    const V a = Select(near, 133.4, Select(middle, 104.6, 71.8));
+    const V b = Select(near, 0.332e-3, Select(middle, 0.212e-3, 0.157e-3));
+    const V c = Select(near, -10.0, Select(middle, -2.5, 5.0));
+
+    return a + b * td + c * Log10(td);
+}
+
+/*=============================================================================
+ |
+ |  Description:  H_0 of TroposcatterLoss when computed at d__meter, rather
+ |                than carried over from the previous call
+ |
+ *===========================================================================*/
+template <typename V> static V TroposcatterH0Lanes(const V &d__meter, const PathLanes<V> &p, const ReferenceLinesLanes<V> &lines,
+    typename V::Mask *undefined)
+{
+    V ad = p.d_hzn__meter[0] - p.d_hzn__meter[1];
+    V rr = p.h_e__meter[1] / p.h_e__meter[0];
+    const typename V::Mask swap = ad < 0.0;
+    ad = Select(swap, -ad, ad);
+    rr = Select(swap, 1.0 / rr, rr);
+
+    const V theta = p.theta_hzn[0] + p.theta_hzn[1] + d__meter / lines.a_e__meter;
+
+    // [TN101, Eqn 9.4a]
+    const V r_1 = 2.0 * p.wn * theta * p.h_e__meter[0];
+    const V r_2 = 2.0 * p.wn * theta * p.h_e__meter[1];
+    *undefined = (r_1 < 0.2) & (r_2 < 0.2);
+
+    V s = (d__meter - ad) / (d__meter + ad);
+    const V q = Min(Max(0.1, rr / s), 10.0);
+    s = Max(0.1, s);
+
+    const V h_0__meter = (d__meter - ad) * (d__meter + ad) * theta * 0.25 / d__meter;
+    const V x = Min(1.7, h_0__meter / 8.0e3);
+    const V x_2 = x * x;
+    const V eta_s = (h_0__meter / 1.7556e3) * (1.0 + (0.031 - p.N_s * 2.32e-3 + (p.N_s * p.N_s) * 5.67e-6) * Exp(-(x_2 * x_2 * x_2)));
+
+    const V H_00 = (H0FunctionLanes(r_1, eta_s) + H0FunctionLanes(r_2, eta_s)) / 2;
+    const V Delta_H_0 = Min(H_00, 6.0 * (0.6 - Log10(Max(eta_s, 1.0))) * Log10(s) * Log10(q));
+    const V H_0 = Max(H_00 + Delta_H_0, 0.0);
+
+    const V g = (1.0 + SQRT2 / r_1) * (1.0 + SQRT2 / r_2);
+    const V H_0_low = eta_s * H_0 + (1.0 - eta_s) * 10 * Log10((g * g) * (r_1 + r_2) / (r_1 + r_2 + 2 * SQRT2));
+    return Select(eta_s < 1.0, H_0_low, H_0);
+}
+
+template <typename V> static V TroposcatterLossLanes(const V &d__meter, const PathLanes<V> &p, const ReferenceLinesLanes<V> &lines, const V &H_0)
+{
+    const V th = d__meter / lines.a_e__meter - lines.theta_los;
+    const V th_2 = th * th;
+
+    // [Algorithm, 4.63]
+    return FFunctionLanes(th * d__meter) + 10 * Log10(p.wn * 47.7 * (th_2 * th_2)) - 0.1 * (p.N_s - 301.0) * Exp(-th * d__meter / 40e3) + H_0;
+}
+
+template <typename V> static void TroposcatterCoefficientsLanes(const PathLanes<V> &p, ReferenceLinesLanes<V> *lines)
+{
+    const V d_5__meter = lines->d_ML__meter + 200e3;
+    const V d_6__meter = lines->d_ML__meter + 400e3;
+
+    // first call at d_6, starting from h0 = -1
+    typename V::Mask undefined;
+    const V H_0_6 = TroposcatterH0Lanes(d_6__meter, p, *lines, &undefined);
+    const V A_6__db = Select(undefined, 1001.0, TroposcatterLossLanes(d_6__meter, p, *lines, H_0_6));
+    const V h0 = Select(undefined, -1.0, H_0_6);
+
+    // second call at d_5, reusing H_0 from d_6 where it exceeded 15 dB
+    const typename V::Mask reuse = h0 > 15.0;
+    V H_0_5 = TroposcatterH0Lanes(d_5__meter, p, *lines, &undefined);
+    H_0_5 = Select((H_0_5 > 15.0) & (h0 >= 0.0), h0, H_0_5);
+    H_0_5 = Select(reuse, h0, H_0_5);
+    const V A_5__db = Select((!reuse) & undefined, 1001.0, TroposcatterLossLanes(d_5__meter, p, *lines, H_0_5));
+
+    const typename V::Mask valid = A_5__db < 1000.0;
+    const V M_s = (A_6__db - A_5__db) / 200e3;
+    const V d_x__meter = Max(Max(lines->d_sML__meter, lines->d_ML__meter + 1.088 * lines->d_scale__meter * Log(p.f__mhz)),
+        (A_5__db - lines->A_d0__db - M_s * d_5__meter) / (lines->M_d - M_s));
+
+    lines->M_s = Select(valid, M_s, lines->M_d);
+    lines->A_s0__db = Select(valid, (lines->M_d - M_s) * d_x__meter + lines->A_d0__db, lines->A_d0__db);
+    lines->d_x__meter = Select(valid, d_x__meter, 10e6);
+}
+
+template <typename V> static V ReferenceAttenuationLanes(const PathLanes<V> &p, const ReferenceLinesLanes<V> &lines, V *propmode,
+    long warnings[])
+{
+    const V d__meter = p.d__meter;
+
+    FlagLanes(Bits(d__meter < lines.d_min__meter), WARN__PATH_DISTANCE_TOO_SMALL_1, warnings);
+    FlagLanes(Bits(d__meter < 1e3), WARN__PATH_DISTANCE_TOO_SMALL_2, warnings);
+    FlagLanes(Bits(d__meter > 1000e3), WARN__PATH_DISTANCE_TOO_BIG_1, warnings);
+    FlagLanes(Bits(d__meter > 2000e3), WARN__PATH_DISTANCE_TOO_BIG_2, warnings);
+
+    const typename V::Mask line_of_sight = d__meter < lines.d_sML__meter;
+    const typename V::Mask troposcatter = d__meter > lines.d_x__meter;
+
+    const V A_los__db = lines.A_o__db + lines.kHat_1__db_per_meter * d__meter + lines.kHat_2__db_per_meter * Log(d__meter);
+    const V A_trans__db = Select(troposcatter, lines.M_s * d__meter + lines.A_s0__db, lines.M_d * d__meter + lines.A_d0__db);
+
+    *propmode = Select(line_of_sight, double(MODE__LINE_OF_SIGHT), Select(troposcatter, double(MODE__TROPOSCATTER), double(MODE__DIFFRACTION)));
+    return Max(Select(line_of_sight, A_los__db, A_trans__db), 0.0);
+}
+
+template <typename V> static V CurveLanes(const double c1, const double c2, const double x1, const double x2, const double x3, const V &d_e__meter)
+{
+    const V r = (d_e__meter - x2) / x3;
+    const V s = d_e__meter / x1;
+    return (c1 + c2 / (1.0 + r * r)) * (s * s) / (1.0 + (s * s));
+}
+
+template <typename V> static V VariabilityLanes(const PathLanes<V> &p, const V &A_ref__db, const VariabilityParameters &var)
+{
+    const int c = var.climate_idx;
+    const double z_T = var.z_T, z_L = var.z_L, z_S = var.z_S;
+
+    // [Algorithm, Eqn 5.3]
+    const V d_ex__meter = Sqrt(2 * a_9000__meter * p.h_e__meter[0]) + Sqrt(2 * a_9000__meter * p.h_e__meter[1]) + Pow(575.7e12 / p.wn, THIRD);
+    const V d_e__meter = Select(p.d__meter < d_ex__meter, 130e3 * p.d__meter / d_ex__meter, 130e3 + p.d__meter - d_ex__meter);
+
+    // [Algorithm, Eqn 5.10]
+    const V sigma_S = var.plus20 ? V(0.0) : 5.0 + 3.0 * Exp(-d_e__meter / 100e3);
+
+    const V V_med__db = CurveLanes(all_year[0][c], all_year[1][c], all_year[2][c], all_year[3][c], all_year[4][c], d_e__meter);
+
+    V sigma_L = 0.0;
+    if (!var.plus10)
+    {
+        const V delta_h_d__meter = TerrainRoughnessLanes(p.d__meter, p.delta_h__meter);
+        sigma_L = 10.0 * p.wn * delta_h_d__meter / (p.wn * delta_h_d__meter + 13.0);
+    }
+    const V Y_L = sigma_L * z_L;
+
+    const V q = Log(0.133 * p.wn);
+
+    V sigma_T;
+    if (z_T < 0.0)
+    {
+        const V g_minus = bfm1[c] + bfm2[c] / ((bfm3[c] * q) * (bfm3[c] * q) + 1.0);
+        sigma_T = CurveLanes(bsm1[c], bsm2[c], xsm1[c], xsm2[c], xsm3[c], d_e__meter) * g_minus;
+    }
+    else
+    {
+        const V g_plus = bfp1[c] + bfp2[c] / ((bfp3[c] * q) * (bfp3[c] * q) + 1.0);
+        const V sigma_T_plus = CurveLanes(bsp1[c], bsp2[c], xsp1[c], xsp2[c], xsp3[c], d_e__meter) * g_plus;
+        if (z_T <= z_D[c])
+            sigma_T = sigma_T_plus;
+        else
+        {
+            const V sigma_TD = C_D[c] * sigma_T_plus;
+            const V tgtd = (sigma_T_plus - sigma_TD) * z_D[c];
+            sigma_T = sigma_TD + tgtd / z_T;
+        }
+    }
+    const V Y_T = sigma_T * z_T;
+
+    // Part of [Algorithm, Eqn 5.11]
+    const V Y_S_temp = sigma_S * sigma_S + Y_T * Y_T / (7.8 + z_S * z_S) + Y_L * Y_L / (24.0 + z_S * z_S);
+
+    V Y_R, Y_S;
+    if (var.mdvar == SINGLE_MESSAGE_MODE)
+    {
+        Y_R = 0.0;
+        Y_S = Sqrt(sigma_T * sigma_T + sigma_L * sigma_L + Y_S_temp) * z_S;
+    }
+    else if (var.mdvar == ACCIDENTAL_MODE)
+    {
+        Y_R = Y_T;
+        Y_S = Sqrt(sigma_L * sigma_L + Y_S_temp) * z_S;
+    }
+    else if (var.mdvar == MOBILE_MODE)
+    {
+        Y_R = Sqrt(sigma_T * sigma_T + sigma_L * sigma_L) * z_T;
+        Y_S = Sqrt(Y_S_temp) * z_S;
+    }
+    else // BROADCAST_MODE
+    {
+        Y_R = Y_T + Y_L;
+        Y_S = Sqrt(Y_S_temp) * z_S;
+    }
+
+    const V result = A_ref__db - V_med__db - Y_R - Y_S;
+
+    // [Algorithm, Eqn 52]
+    return Select(result < 0.0, result * (29.0 - result) / (29.0 - 10.0 * result), result);
+}
+
+/*=============================================================================
+ |
+ |  Description:  LongleyRiceBatch for links [i, i + count) of the batch, in
+ |                one block of V::size lanes
+ |
+ *===========================================================================*/
+template <typename V> static void LongleyRiceBlock(const LinkGeometry *links, const int i, const int count, const int mode,
+    const VariabilityParameters &var, const LinkLosses *losses)
+{
+    PathLanes<V> p;
+    for (int t = 0; t < 2; t++)
+    {
+        p.theta_hzn[t] = LoadLanes<V>(links->theta_hzn[t], i, count);
+        p.d_hzn__meter[t] = LoadLanes<V>(links->d_hzn__meter[t], i, count);
+        p.h_e__meter[t] = LoadLanes<V>(links->h_e__meter[t], i, count);
+        p.h__meter[t] = LoadLanes<V>(links->h__meter[t], i, count);
+    }
+    p.delta_h__meter = LoadLanes<V>(links->delta_h__meter, i, count);
+    p.d__meter = LoadLanes<V>(links->d__meter, i, count);
+    p.Z_g_real = LoadLanes<V>(links->Z_g_real, i, count);
+    p.Z_g_imag = LoadLanes<V>(links->Z_g_imag, i, count);
+    p.abs_Z_g = Sqrt(p.Z_g_real * p.Z_g_real + p.Z_g_imag * p.Z_g_imag);
+    p.gamma_e = LoadLanes<V>(links->gamma_e, i, count);
+    p.N_s = LoadLanes<V>(links->N_s, i, count);
+    p.f__mhz = LoadLanes<V>(links->f__mhz, i, count);
+    p.wn = p.f__mhz / 47.7;
+
+    // warnings raised before and after the InitializeReferenceLines error checks
+    long early[V::size], late[V::size];
+    for (int k = 0; k < V::size; k++)
+    {
+        early[k] = NO_WARNINGS;
+        late[k] = var.warnings;
+    }
+
+    ReferenceLinesLanes<V> lines;
+    InitializeReferenceLinesLanes(p, mode, &lines, early);
+
+    // compute only the lines some lane of the block falls in
+    const typename V::Mask line_of_sight = p.d__meter < lines.d_sML__meter;
+    lines.A_o__db = lines.kHat_1__db_per_meter = lines.kHat_2__db_per_meter = 0.0;
+    lines.M_s = lines.A_s0__db = lines.d_x__meter = 0.0;
+    if (Any(line_of_sight))
+        LineOfSightCoefficientsLanes(p, &lines);
+    if (Any(!line_of_sight))
+        TroposcatterCoefficientsLanes(p, &lines);
+
+    V propmode;
+    const V A_ref__db = ReferenceAttenuationLanes(p, lines, &propmode, late);
+    const V A_fs__db = 32.45 + 20.0 * Log10(p.f__mhz) + 20.0 * Log10(p.d__meter / 1000.0);
+    const V A__db = VariabilityLanes(p, A_ref__db, var) + A_fs__db;
+
+    double A__db_k[V::size], A_ref__db_k[V::size], A_fs__db_k[V::size], mode_k[V::size];
+    Store(A__db_k, A__db);
+    Store(A_ref__db_k, A_ref__db);
+    Store(A_fs__db_k, A_fs__db);
+    Store(mode_k, propmode);
+
+    for (int k = 0; k < count; k++)
+    {
+        const int link = i + k;
+        const int rtn = ReferenceLinesError(links->N_s[link], links->gamma_e[link], links->Z_g_real[link], links->Z_g_imag[link]);
+        if (rtn != SUCCESS)
+        {
+            losses->warnings[link] |= early[k];
+            losses->status[link] = rtn;
+            continue;
+        }
+
+        const long warnings = losses->warnings[link] | early[k] | late[k];
+        RecordMode(int(mode_k[k]));
+
+        losses->A__db[link] = A__db_k[k];
+        losses->A_ref__db[link] = A_ref__db_k[k];
+        losses->A_fs__db[link] = A_fs__db_k[k];
+        losses->mode[link] = int(mode_k[k]);
+        losses->warnings[link] = warnings;
+        losses->status[link] = warnings != NO_WARNINGS ? SUCCESS_WITH_WARNINGS : SUCCESS;
+    }
+}
+
+/*=============================================================================
+ |
+ |  Description:  LongleyRiceBatch in blocks of 4 links
+ |
+ *===========================================================================*/
+TARGET_AVX2 FLATTEN static void LongleyRiceBatch_AVX2(const int n, const LinkGeometry *links, const int mode, const VariabilityParameters &var,
+    const LinkLosses *losses)
+{
+    for (int i = 0; i < n; i += Avx2Lanes::size)
+        LongleyRiceBlock<Avx2Lanes>(links, i, MIN(int(Avx2Lanes::size), n - i), mode, var, losses);
+
+    // leave the upper register halves clean for the SSE code that follows
+    _mm256_zeroupper();
+}
+
+/*=============================================================================
+ |
+ |  Description:  LongleyRiceBatch in blocks of 8 links
+ |
+ *===========================================================================*/
+TARGET_AVX512 FLATTEN static void LongleyRiceBatch_AVX512(const int n, const LinkGeometry *links, const int mode, const VariabilityParameters &var,
+    const LinkLosses *losses)
+{
+    for (int i = 0; i < n; i += Avx512Lanes::size)
+        LongleyRiceBlock<Avx512Lanes>(links, i, MIN(int(Avx512Lanes::size), n - i), mode, var, losses);
+
+    // leave the upper register halves clean for the SSE code that follows
+    _mm256_zeroupper();
+}
+
+#endif
+
+/*=============================================================================
+ |
+ |  Description:  Reference attenuation, variability and free space loss of
+ |                many links, as computed by ITM_P2P_TLS_Ex (or
+ |                ITM_AREA_TLS_Ex) once the path parameters are known.  The
+ |                links share the variability inputs.  On an x86 processor
+ |                with AVX2 or AVX-512, the links are evaluated 4 or 8 at a
+ |                time and the results agree with the scalar functions to
+ |                within rounding; otherwise (or at SIMD__SCALAR) they are
+ |                identical.  Outputs of links that fail keep their values.
+ |
+ |        Input:  n                 - Number of links
+ |                links             - Per-link path parameters
+ |                mode              - Mode of the prediction
+ |                                      + 0 : MODE__P2P
+ |                                      + 1 : MODE__AREA
+ |                time              - Time percentage, 0 < time < 100
+ |                location          - Location percentage, 0 < location < 100
+ |                situation         - Situation percentage, 0 < situation < 100
+ |                climate           - Radio climate enum, already validated
+ |                mdvar             - Mode of variability
+ |
+ |      Outputs:  losses            - Per-link losses, mode of propagation,
+ |                                    warning flags and error code
+ |
+ |      Returns:  [None]
+ |
+ *===========================================================================*/
+void LongleyRiceBatch(const int n, const LinkGeometry *links, const int mode, const double time, const double location,
+    const double situation, const int climate, const int mdvar, const LinkLosses *losses)
+{
+    StageTimer timer(STAGE__LONGLEY_RICE_BATCH);
+
+#ifdef ITM_SIMD_X86
+    const int simd = GetSimdLevel();
+    if (simd != SIMD__SCALAR)
+    {
+        const VariabilityParameters var = InitializeVariability(time, location, situation, climate, mdvar);
+        if (simd == SIMD__AVX512)
+            LongleyRiceBatch_AVX512(n, links, mode, var, losses);
+        else
+            LongleyRiceBatch_AVX2(n, links, mode, var, losses);
+        return;
+    }
+#endif
+
+    LongleyRiceBatch_Scalar(n, links, mode, time, location, situation, climate, mdvar, losses);
+}
@@ -1,4 +1,6 @@
-#include "..\include\itm.h"
+#include "../include/itm.h"
+#include "../include/Enums.h"
+#include "../include/Instrumentation.h"
 
 /*=============================================================================
  |
@@ -20,6 +22,8 @@
 void QuickPfl(const double pfl[], const double gamma_e, const double h__meter[2], double theta_hzn[2], 
     double d_hzn__meter[2], double h_e__meter[2], double *delta_h__meter, double *d__meter)
 {
+    StageTimer timer(STAGE__QUICK_PFL);
+
     double fit_tx, fit_rx, q;
     double d_start__meter;
     double d_end__meter;
@@ -1,4 +1,4 @@
-#include "..\include\itm.h"
+#include "../include/itm.h"
 
 /*=============================================================================
  |
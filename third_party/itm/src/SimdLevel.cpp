@@ -0,0 +1,103 @@
+#include "../include/itm.h"
+#include "../include/Enums.h"
+#include "../include/Simd.h"
+
+#include <atomic>
+
+#if defined(ITM_SIMD_X86) && defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+/*=============================================================================
+ |
+ |  Description:  Determine the widest instruction set supported by both the
+ |                processor and the operating system
+ |
+ |        Input:  [None]
+ |
+ |      Outputs:  [None]
+ |
+ |      Returns:  level             - SIMD__SCALAR, SIMD__AVX2 or SIMD__AVX512
+ |
+ *===========================================================================*/
+static int DetectSimdLevel()
+{
+#if defined(ITM_SIMD_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return SIMD__SCALAR;
+
+    // the OS must save the extended register state for the wider registers
+    __cpuid(info, 1);
+    if (!(info[2] & (1 << 27)))
+        return SIMD__SCALAR;
+    const unsigned long long xcr0 = _xgetbv(0);
+
+    __cpuidex(info, 7, 0);
+    if ((info[1] & (1 << 16)) && (xcr0 & 0xE6) == 0xE6)
+        return SIMD__AVX512;
+    if ((info[1] & (1 << 5)) && (xcr0 & 0x6) == 0x6)
+        return SIMD__AVX2;
+    return SIMD__SCALAR;
+#elif defined(ITM_SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return SIMD__AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return SIMD__AVX2;
+    return SIMD__SCALAR;
+#else
+    return SIMD__SCALAR;
+#endif
+}
+
+static int SupportedSimdLevel()
+{
+    static const int supported = DetectSimdLevel();
+    return supported;
+}
+
+static std::atomic<int> &ActiveSimdLevel()
+{
+    static std::atomic<int> active(SupportedSimdLevel());
+    return active;
+}
+
+/*=============================================================================
+ |
+ |  Description:  Instruction set used by the terrain kernels (FindHorizons,
+ |                LinearLeastSquaresFit)
+ |
+ |        Input:  [None]
+ |
+ |      Outputs:  [None]
+ |
+ |      Returns:  level             - SIMD__SCALAR, SIMD__AVX2 or SIMD__AVX512
+ |
+ *===========================================================================*/
+int GetSimdLevel()
+{
+    return ActiveSimdLevel().load(std::memory_order_relaxed);
+}
+
+/*=============================================================================
+ |
+ |  Description:  Restrict the terrain kernels to an instruction set, e.g. to
+ |                compare the vectorized and scalar code paths.  Levels the
+ |                processor does not support are lowered to the widest one
+ |                that it does.
+ |
+ |        Input:  level             - SIMD__SCALAR, SIMD__AVX2 or SIMD__AVX512
+ |
+ |      Outputs:  [None]
+ |
+ |      Returns:  level             - Instruction set now in use
+ |
+ *===========================================================================*/
+int SetSimdLevel(const int level)
+{
+    const int used = MAX(SIMD__SCALAR, MIN(level, SupportedSimdLevel()));
+    ActiveSimdLevel().store(used, std::memory_order_relaxed);
+    return used;
+}
@@ -1,4 +1,6 @@
-#include "..\include\itm.h"
+#include "../include/itm.h"
+#include "../include/Enums.h"
+#include "../include/Instrumentation.h"
 
 /*=============================================================================
  |
@@ -54,6 +56,8 @@ double FFunction(const double td)
 double TroposcatterLoss(const double d__meter, const double theta_hzn[2], const double d_hzn__meter[2], const double h_e__meter[2], 
     const double a_e__meter, const double N_s, const double f__mhz, const double theta_los, double *h0)
 {
+    StageTimer timer(STAGE__TROPOSCATTER_LOSS);
+
     double H_0;
 
     // wavenumber, k
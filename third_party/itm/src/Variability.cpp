@@ -1,6 +1,8 @@
-#include "..\include\itm.h"
-#include "..\include\Enums.h"
-#include "..\include\Warnings.h"
+#include "../include/itm.h"
+#include "../include/Enums.h"
+#include "../include/Warnings.h"
+#include "../include/Instrumentation.h"
+#include "../include/VariabilityCurves.h"
 
 /*=============================================================================
  |
@@ -49,40 +51,7 @@ double Curve(const double c1, const double c2, const double x1, const double x2,
 double Variability(const double time, const double location, const double situation, const double h_e__meter[2], const double delta_h__meter, 
     const double f__mhz, const double d__meter, const double A_ref__db, const int climate, const int mdvar, long *warnings)
 {
-    // Asymptotic values from TN101, Fig 10.13
-    // -> approximate to TN101v2 Eqn III.69 & III.70
-    // -> to describe the curves for each climate
-    constexpr double all_year[5][7] =
-    {
-        {  -9.67,   -0.62,    1.26,   -9.21,   -0.62,   -0.39,      3.15 },
-        {  12.7,     9.19,   15.5,     9.05,    9.19,    2.86,   857.9   },
-        { 144.9e3, 228.9e3, 262.6e3,  84.1e3, 228.9e3, 141.7e3, 2222.e3  },
-        { 190.3e3, 205.2e3, 185.2e3, 101.1e3, 205.2e3, 315.9e3,  164.8e3 },
-        { 133.8e3, 143.6e3,  99.8e3,  98.6e3, 143.6e3, 167.4e3,  116.3e3 }
-    };
-
-    constexpr double bsm1[] = { 2.13,      2.66,    6.11,     1.98,   2.68,    6.86,    8.51 };
-    constexpr double bsm2[] = { 159.5,     7.67,    6.65,    13.11,   7.16,   10.38,  169.8 };
-    constexpr double xsm1[] = { 762.2e3, 100.4e3, 138.2e3, 139.1e3,  93.7e3, 187.8e3, 609.8e3 };
-    constexpr double xsm2[] = { 123.6e3, 172.5e3, 242.2e3, 132.7e3, 186.8e3, 169.6e3, 119.9e3 };
-    constexpr double xsm3[] = { 94.5e3,  136.4e3, 178.6e3, 193.5e3, 133.5e3, 108.9e3, 106.6e3 };
-
-    constexpr double bsp1[] = { 2.11, 6.87, 10.08, 3.68, 4.75, 8.58, 8.43 };
-    constexpr double bsp2[] = { 102.3, 15.53, 9.60, 159.3, 8.12, 13.97, 8.19 };
-    constexpr double xsp1[] = { 636.9e3, 138.7e3, 165.3e3, 464.4e3, 93.2e3, 216.0e3, 136.2e3 };
-    constexpr double xsp2[] = { 134.8e3, 143.7e3, 225.7e3, 93.1e3, 135.9e3, 152.0e3, 188.5e3 };
-    constexpr double xsp3[] = { 95.6e3, 98.6e3, 129.7e3, 94.2e3, 113.4e3, 122.7e3, 122.9e3 };
-
-    constexpr double C_D[] = { 1.224, 0.801, 1.380, 1.000, 1.224, 1.518, 1.518 };	// [Algorithm, Table 5.1], C_d
-    constexpr double z_D[] = { 1.282, 2.161, 1.282, 20.0, 1.282, 1.282, 1.282 };	// [Algorithm, Table 5.1], z_d
-
-    constexpr double bfm1[] = { 1.0, 1.0, 1.0, 1.0, 0.92, 1.0, 1.0 };
-    constexpr double bfm2[] = { 0.0, 0.0, 0.0, 0.0, 0.25, 0.0, 0.0 };
-    constexpr double bfm3[] = { 0.0, 0.0, 0.0, 0.0, 1.77, 0.0, 0.0 };
-
-    constexpr double bfp1[] = { 1.0, 0.93, 1.0, 0.93, 0.93, 1.0, 1.0 };
-    constexpr double bfp2[] = { 0.0, 0.31, 0.0, 0.19, 0.31, 0.0, 0.0 };
-    constexpr double bfp3[] = { 0.0, 2.00, 0.0, 1.79, 2.00, 0.0, 0.0 };
+    StageTimer timer(STAGE__VARIABILITY);
 
     double z_T = InverseComplementaryCumulativeDistributionFunction(time / 100);
     double z_L = InverseComplementaryCumulativeDistributionFunction(location / 100);
@@ -219,4 +188,136 @@ double Variability(const double time, const double location, const double situat
         result = result * (29.0 - result) / (29.0 - 10.0 * result);
 
     return result;
-}
\ No newline at end of file
+}
+
+/*=============================================================================
+ |
+ |  Description:  Upper bound of Curve() over effective distances in
+ |                (0, d_e__meter], given c2 >= 0 as for every curve above
+ |
+ *===========================================================================*/
+static double CurveUpperBound(const double c1, const double c2, const double x1, const double d_e__meter)
+{
+    const double r = pow(d_e__meter / x1, 2);
+    return MAX(c1 + c2, 0.0) * r / (1.0 + r);
+}
+
+/*=============================================================================
+ |
+ |  Description:  Lower bound on the variability loss returned by Variability
+ |                for a path of length d__meter, over all effective antenna
+ |                heights, terrain irregularities and (non-negative)
+ |                reference attenuations.  FreeSpaceLoss() plus this bound is
+ |                therefore a lower bound on the point-to-point and area
+ |                mode losses of any path of that length.
+ |
+ |        Input:  time           - Time percentage, 0 < time < 100
+ |                location       - Location percentage, 0 < location < 100
+ |                situation      - Situation percentage, 0 < situation < 100
+ |                f__mhz         - Frequency, in MHz
+ |                d__meter       - Path distance, in meters
+ |                climate        - Radio climate enum
+ |                mdvar          - Mode of variability
+ |
+ |      Outputs:  [None]
+ |
+ |      Returns:  F_min          - in dB, or -infinity for a climate that is
+ |                                 out of range
+ |
+ *===========================================================================*/
+double VariabilityLowerBound(const double time, const double location, const double situation, const double f__mhz,
+    const double d__meter, const int climate, const int mdvar)
+{
+    if (climate < CLIMATE__EQUATORIAL || climate > CLIMATE__MARITIME_TEMPERATE_OVER_SEA)
+        return -INFINITY;
+
+    double z_T = InverseComplementaryCumulativeDistributionFunction(time / 100);
+    double z_L = InverseComplementaryCumulativeDistributionFunction(location / 100);
+    const double z_S = InverseComplementaryCumulativeDistributionFunction(situation / 100);
+
+    const int climate_idx = climate - 1;
+
+    const double wn = f__mhz / 47.7;
+
+    // the effective distance shrinks as the effective heights grow, so it is
+    // largest for antennas at ground level
+    const double d_ex_min__meter = pow((575.7e12 / wn), THIRD);
+    double d_e_max__meter;
+    if (d__meter < d_ex_min__meter)
+        d_e_max__meter = 130e3 * d__meter / d_ex_min__meter;
+    else
+        d_e_max__meter = 130e3 + d__meter - d_ex_min__meter;
+
+    int mdvar_internal = mdvar;
+    const bool plus20 = mdvar_internal >= 20;
+    if (plus20)
+        mdvar_internal -= 20;
+    const bool plus10 = mdvar_internal >= 10;
+    if (plus10)
+        mdvar_internal -= 10;
+
+    if (mdvar_internal == SINGLE_MESSAGE_MODE)
+    {
+        z_T = z_S;
+        z_L = z_S;
+    }
+    else if (mdvar_internal == ACCIDENTAL_MODE)
+        z_L = z_S;
+    else if (mdvar_internal == MOBILE_MODE)
+        z_L = z_T;
+
+    // largest value each standard deviation of Variability can take
+    const double sigma_S = plus20 ? 0.0 : 8.0;
+    const double sigma_L = plus10 ? 0.0 : 10.0;
+
+    const double q = log(0.133 * wn);
+    const double g_minus = bfm1[climate_idx] + bfm2[climate_idx] / (pow(bfm3[climate_idx] * q, 2) + 1.0);
+    const double g_plus = bfp1[climate_idx] + bfp2[climate_idx] / (pow(bfp3[climate_idx] * q, 2) + 1.0);
+    const double sigma_T_plus = CurveUpperBound(bsp1[climate_idx], bsp2[climate_idx], xsp1[climate_idx], d_e_max__meter) * g_plus;
+
+    double sigma_T;
+    if (z_T < 0.0)
+        sigma_T = CurveUpperBound(bsm1[climate_idx], bsm2[climate_idx], xsm1[climate_idx], d_e_max__meter) * g_minus;
+    else if (z_T <= z_D[climate_idx])
+        sigma_T = sigma_T_plus;
+    else
+        sigma_T = sigma_T_plus * (C_D[climate_idx] + (1.0 - C_D[climate_idx]) * z_D[climate_idx] / z_T);
+
+    // each deviate enters as sigma * z with sigma >= 0, so the losses it can
+    // remove are bounded by its positive part
+    const double p_T = MAX(z_T, 0.0);
+    const double p_L = MAX(z_L, 0.0);
+    const double p_S = MAX(z_S, 0.0);
+
+    const double Y_S_temp = pow(sigma_S, 2) + pow(sigma_T * z_T, 2) / (7.8 + pow(z_S, 2)) + pow(sigma_L * z_L, 2) / (24.0 + pow(z_S, 2));
+    double Y_R, Y_S;
+    if (mdvar_internal == SINGLE_MESSAGE_MODE)
+    {
+        Y_R = 0.0;
+        Y_S = sqrt(pow(sigma_T, 2) + pow(sigma_L, 2) + Y_S_temp) * p_S;
+    }
+    else if (mdvar_internal == ACCIDENTAL_MODE)
+    {
+        Y_R = sigma_T * p_T;
+        Y_S = sqrt(pow(sigma_L, 2) + Y_S_temp) * p_S;
+    }
+    else if (mdvar_internal == MOBILE_MODE)
+    {
+        Y_R = sqrt(pow(sigma_T, 2) + pow(sigma_L, 2)) * p_T;
+        Y_S = sqrt(Y_S_temp) * p_S;
+    }
+    else // BROADCAST_MODE
+    {
+        Y_R = sigma_T * p_T + sigma_L * p_L;
+        Y_S = sqrt(Y_S_temp) * p_S;
+    }
+
+    const double V_med__db = CurveUpperBound(all_year[0][climate_idx], all_year[1][climate_idx], all_year[2][climate_idx], d_e_max__meter);
+
+    // A_ref__db >= 0, and [Algorithm, Eqn 52] is increasing
+    double result = -V_med__db - Y_R - Y_S;
+    if (result < 0.0)
+        result = result * (29.0 - result) / (29.0 - 10.0 * result);
+
+    return result;
+}
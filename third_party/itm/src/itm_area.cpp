@@ -1,6 +1,6 @@
-#include "..\include\itm.h"
-#include "..\include\Enums.h"
-#include "..\include\Errors.h"
+#include "../include/itm.h"
+#include "../include/Enums.h"
+#include "../include/Errors.h"
 
 /*=============================================================================
  |
@@ -1,6 +1,6 @@
-#include "..\include\itm.h"
-#include "..\include\Enums.h"
-#include "..\include\Errors.h"
+#include "../include/itm.h"
+#include "../include/Enums.h"
+#include "../include/Errors.h"
 
 /*=============================================================================
  |
@@ -150,6 +150,68 @@ int ITM_P2P_CR_Ex(const double h_tx__meter, const double h_rx__meter, const doub
         return rtn;
 }
 
+/*=============================================================================
+ |
+ |  Description:  Validate the inputs of a point-to-point prediction and
+ |                derive the path parameters from the terrain profile.  This
+ |                is everything ITM_P2P_TLS_Ex does ahead of LongleyRice.
+ |
+ |        Input:  h_tx__meter       - Structural height of the TX, in meters
+ |                h_rx__meter       - Structural height of the RX, in meters
+ |                pfl[2]            - Terrain data, in PFL format
+ |                climate           - Radio climate enum
+ |                N_0               - Refractivity, in N-Units
+ |                f__mhz            - Frequency, in MHz
+ |                pol               - Polarization enum
+ |                epsilon           - Relative permittivity
+ |                sigma             - Conductivity
+ |                mdvar             - Mode of variability
+ |                time              - Time percentage, 0 < time < 100
+ |                location          - Location percentage, 0 < location < 100
+ |                situation         - Situation percentage, 0 < situation < 100
+ |
+ |      Outputs:  Z_g               - Complex ground impedance
+ |                gamma_e           - Curvature of the effective earth
+ |                N_s               - Surface refractivity, in N-Units
+ |                theta_hzn[2]      - Terminal horizon angles
+ |                d_hzn__meter[2]   - Terminal horizon distances, in meters
+ |                h_e__meter[2]     - Terminal effective heights, in meters
+ |                delta_h__meter    - Terrain irregularity parameter
+ |                d__meter          - Path distance, in meters
+ |                warnings          - Warning flags
+ |
+ |      Returns:  error             - Error code
+ |
+ *===========================================================================*/
+int InitializePointToPointPath(const double h_tx__meter, const double h_rx__meter, const double pfl[], const int climate, const double N_0,
+    const double f__mhz, const int pol, const double epsilon, const double sigma, const int mdvar, const double time, const double location,
+    const double situation, complex<double> *Z_g, double *gamma_e, double *N_s, double theta_hzn[2], double d_hzn__meter[2], double h_e__meter[2],
+    double *delta_h__meter, double *d__meter, long *warnings)
+{
+    // initial input validation check - some validation occurs later in calculations
+    int rtn = ValidateInputs(h_tx__meter, h_rx__meter, climate, time, location, situation, N_0, f__mhz, pol, epsilon, sigma, mdvar, warnings);
+    if (rtn != SUCCESS)
+        return rtn;
+
+    const int np = int(pfl[0]);     // number of points in the pfl
+
+    // compute the average path height, ignoring first and last 10%
+    const int p10 = int(0.1 * np);  // 10% of np
+    double h_sys__meter = 0;        // Height of the system above mean sea level
+
+    for (int i = p10; i <= np - p10; i++)
+        h_sys__meter += pfl[i + 2];
+
+    h_sys__meter = h_sys__meter / (np - 2 * p10 + 1);
+
+    InitializePointToPoint(f__mhz, h_sys__meter, N_0, pol, epsilon, sigma, Z_g, gamma_e, N_s);
+
+    const double h__meter[2] = { h_tx__meter, h_rx__meter };
+    QuickPfl(pfl, *gamma_e, h__meter, theta_hzn, d_hzn__meter, h_e__meter, delta_h__meter, d__meter);
+
+    return SUCCESS;
+}
+
 /*=============================================================================
  |
  |  Description: The ITS Irregular Terrain Model (ITM).  This function
@@ -192,28 +254,14 @@ int ITM_P2P_TLS_Ex(const double h_tx__meter, const double h_rx__meter, const dou
 
     *warnings = NO_WARNINGS;    // Initialize to no warnings
 
-    // initial input validation check - some validation occurs later in calculations
-    int rtn = ValidateInputs(h_tx__meter, h_rx__meter, climate, time, location, situation, N_0, f__mhz, pol, epsilon, sigma, mdvar, warnings);
+    int rtn = InitializePointToPointPath(h_tx__meter, h_rx__meter, pfl, climate, N_0, f__mhz, pol, epsilon, sigma, mdvar, time, location, situation,
+        &Z_g, &gamma_e, &N_s, theta_hzn, d_hzn__meter, h_e__meter, &delta_h__meter, &d__meter, warnings);
     if (rtn != SUCCESS)
         return rtn;
 
     interValues->d__km = (pfl[0] * pfl[1]) / 1000;
 
-    const int np = int(pfl[0]);     // number of points in the pfl
-
-    // compute the average path height, ignoring first and last 10%
-    const int p10 = int(0.1 * np);  // 10% of np
-    double h_sys__meter = 0;        // Height of the system above mean sea level
-
-    for (int i = p10; i <= np - p10; i++)
-        h_sys__meter += pfl[i + 2];
-
-    h_sys__meter = h_sys__meter / (np - 2 * p10 + 1);
-
-    InitializePointToPoint(f__mhz, h_sys__meter, N_0, pol, epsilon, sigma, &Z_g, &gamma_e, &N_s);
-
     const double h__meter[2] = { h_tx__meter, h_rx__meter };
-    QuickPfl(pfl, gamma_e, h__meter, theta_hzn, d_hzn__meter, h_e__meter, &delta_h__meter, &d__meter);
 
     // Reference attenuation, in dB
     double A_ref__db = 0;